@@ -3,12 +3,14 @@
 #define PROJECT_ROOT "."  // Fallback
 #endif
 
+#include <array>
 #include <cstddef>
 #include <exception>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <optional>
+#include <span>
 #include <string>
 #include <string_view>
 
@@ -21,6 +23,112 @@
 namespace ggb::bench {
 namespace fs = std::filesystem;
 
+// Which `FeatureStore` read path the query loop exercises.
+enum class QueryApi {
+  Vector,  // get_multi_tensor: one `Value` allocation per key
+  Into,    // get_multi_tensor_into: gather into a reused contiguous buffer
+};
+
+[[nodiscard]] inline auto to_string(QueryApi api) -> std::string_view {
+  switch (api) {
+    case QueryApi::Vector:
+      return "vector";
+    case QueryApi::Into:
+      return "into";
+  }
+  return "unknown";
+}
+
+// Arrival process of the open-loop mode
+enum class Arrival {
+  Fixed,    // Evenly spaced at the target rate
+  Poisson,  // Exponential gaps with the target rate as mean
+};
+
+[[nodiscard]] inline auto to_string(Arrival arrival) -> std::string_view {
+  switch (arrival) {
+    case Arrival::Fixed:
+      return "fixed";
+    case Arrival::Poisson:
+      return "poisson";
+  }
+  return "unknown";
+}
+
+[[nodiscard]] inline auto to_string(IndexKind kind) -> std::string_view {
+  switch (kind) {
+    case IndexKind::Hash:
+      return "hash";
+    case IndexKind::Eytzinger:
+      return "eytzinger";
+    case IndexKind::PerfectHash:
+      return "perfect_hash";
+  }
+  return "unknown";
+}
+
+[[nodiscard]] inline auto to_string(RowOrder order) -> std::string_view {
+  switch (order) {
+    case RowOrder::Insertion:
+      return "insertion";
+    case RowOrder::Degree:
+      return "degree";
+    case RowOrder::Rcm:
+      return "rcm";
+  }
+  return "unknown";
+}
+
+[[nodiscard]] inline auto to_string(CachePolicy policy) -> std::string_view {
+  switch (policy) {
+    case CachePolicy::Clock:
+      return "clock";
+    case CachePolicy::S3Fifo:
+      return "s3fifo";
+    case CachePolicy::Lru:
+      return "lru";
+  }
+  return "unknown";
+}
+
+[[nodiscard]] inline auto to_string(IoBackend backend) -> std::string_view {
+  switch (backend) {
+    case IoBackend::Auto:
+      return "auto";
+    case IoBackend::IoUring:
+      return "io_uring";
+    case IoBackend::Pread:
+      return "pread";
+  }
+  return "unknown";
+}
+
+[[nodiscard]] inline auto to_string(StorageDType dtype) -> std::string_view {
+  switch (dtype) {
+    case StorageDType::F32:
+      return "f32";
+    case StorageDType::F16:
+      return "f16";
+    case StorageDType::BF16:
+      return "bf16";
+    case StorageDType::Int8:
+      return "int8";
+  }
+  return "unknown";
+}
+
+[[nodiscard]] inline auto to_string(HugePages huge_pages) -> std::string_view {
+  switch (huge_pages) {
+    case HugePages::None:
+      return "none";
+    case HugePages::Transparent:
+      return "thp";
+    case HugePages::Explicit:
+      return "hugetlb";
+  }
+  return "unknown";
+}
+
 struct RunConfig {
   using json = nlohmann::json;
 
@@ -31,6 +139,16 @@ struct RunConfig {
     std::size_t fan_out{0};
   };
 
+  struct WorkloadParams {
+    QueryApi api{QueryApi::Vector};
+    std::size_t inflight{1};  // Batches outstanding through the async APIs
+    std::size_t executor_threads{0};
+    std::size_t prefetch_distance{0};  // Batches ahead hinted via `prefetch`
+    std::size_t threads{1};  // Client threads sharing the store
+    double target_qps{0};    // Open loop at this rate when > 0
+    Arrival arrival{Arrival::Fixed};
+  };
+
   std::string dataset_name;
   std::string run_id;
 
@@ -40,6 +158,7 @@ struct RunConfig {
 
   EngineConfig engine;
   SamplingParams sampling;
+  WorkloadParams workload;
 
   [[nodiscard]] static auto load(const std::string_view dataset_name,
                                  const std::string_view run_id)
@@ -57,8 +176,10 @@ struct RunConfig {
     RunConfig cfg;
     cfg.dataset_name = dataset_name;
     cfg.run_id = run_id;
-    cfg.node_feat_path = dataset_dir / node_feat_file_name;
-    cfg.edge_list_path = dataset_dir / edge_list_file_name;
+    cfg.node_feat_path =
+        prefer_existing(dataset_dir, node_feat_file_names, "features");
+    cfg.edge_list_path =
+        prefer_existing(dataset_dir, edge_list_file_names, "edge list");
 
     if (!fs::exists(cfg.node_feat_path)) {
       GGB_LOG_ERROR("Feature file not found: {}", cfg.node_feat_path.string());
@@ -147,8 +268,24 @@ struct RunConfig {
   }
 
  private:
-  constexpr static std::string node_feat_file_name = "node-feat.csv";
-  constexpr static std::string edge_list_file_name = "edge.csv";
+  // Binary inputs skip text parsing, so they win when both exist
+  constexpr static std::array<std::string_view, 2> node_feat_file_names = {
+      "node-feat.npy", "node-feat.csv"};
+  constexpr static std::array<std::string_view, 2> edge_list_file_names = {
+      "edge.bin", "edge.csv"};
+
+  // First of `names` present in `dir`, or the last one if none is
+  static auto prefer_existing(const fs::path& dir,
+                              std::span<const std::string_view> names,
+                              std::string_view what) -> fs::path {
+    for (const auto name : names) {
+      if (fs::exists(dir / name)) {
+        GGB_LOG_INFO("Reading {} from {}", what, name);
+        return dir / name;
+      }
+    }
+    return dir / names.back();
+  }
 };
 
 inline auto to_json(nlohmann::json& j, const RunConfig::SamplingParams& p)
@@ -158,4 +295,15 @@ inline auto to_json(nlohmann::json& j, const RunConfig::SamplingParams& p)
                      {"fan_out", p.fan_out}};
 }
 
+inline auto to_json(nlohmann::json& j, const RunConfig::WorkloadParams& p)
+    -> void {
+  j = nlohmann::json{{"api", to_string(p.api)},
+                     {"inflight", p.inflight},
+                     {"executor_threads", p.executor_threads},
+                     {"prefetch_distance", p.prefetch_distance},
+                     {"threads", p.threads},
+                     {"target_qps", p.target_qps},
+                     {"arrival", to_string(p.arrival)}};
+}
+
 }  // namespace ggb::bench
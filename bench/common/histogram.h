@@ -0,0 +1,139 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Third-party
+#include <nlohmann/json.hpp>
+
+namespace ggb::bench {
+
+// Log-linear latency histogram in the style of HdrHistogram: values below
+// 2^sub_bucket_bits are counted exactly, larger ones in buckets at most
+// 1/2^(sub_bucket_bits - 1) of their value wide (0.8%), over the whole
+// uint64 range in a fixed 58 KiB. Each thread records into its own and
+// `merge` adds them up afterwards, so recording never synchronizes.
+class LatencyHistogram {
+ public:
+  static constexpr unsigned sub_bucket_bits = 8;
+
+  LatencyHistogram() : counts_(num_buckets, 0) {}
+
+  auto record(std::uint64_t value) -> void {
+    ++counts_[bucket_of(value)];
+    ++count_;
+    sum_ += value;
+    sum_sq_ += static_cast<double>(value) * static_cast<double>(value);
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+  }
+
+  auto merge(const LatencyHistogram& other) -> void {
+    for (std::size_t i = 0; i < num_buckets; ++i) {
+      counts_[i] += other.counts_[i];
+    }
+    count_ += other.count_;
+    sum_ += other.sum_;
+    sum_sq_ += other.sum_sq_;
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+  }
+
+  [[nodiscard]] auto count() const -> std::uint64_t { return count_; }
+  [[nodiscard]] auto sum() const -> std::uint64_t { return sum_; }
+  [[nodiscard]] auto min() const -> std::uint64_t {
+    return count_ == 0 ? 0 : min_;
+  }
+  [[nodiscard]] auto max() const -> std::uint64_t { return max_; }
+
+  [[nodiscard]] auto mean() const -> double {
+    return count_ == 0 ? 0.0 : static_cast<double>(sum_) / count_;
+  }
+
+  [[nodiscard]] auto std_dev() const -> double {
+    if (count_ == 0) {
+      return 0.0;
+    }
+    const auto mean_value = mean();
+    return std::sqrt(
+        std::max(0.0, (sum_sq_ / count_) - (mean_value * mean_value)));
+  }
+
+  // Highest value in the bucket holding the `percentile`th value, capped at
+  // the largest value recorded; 0 when empty
+  [[nodiscard]] auto percentile(double percentile) const -> std::uint64_t {
+    if (count_ == 0) {
+      return 0;
+    }
+    const auto rank = std::max<std::uint64_t>(
+        1, static_cast<std::uint64_t>(
+               std::ceil(percentile / 100.0 * static_cast<double>(count_))));
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < num_buckets; ++i) {
+      seen += counts_[i];
+      if (seen >= rank) {
+        return std::min(highest_in(i), max_);
+      }
+    }
+    return max_;
+  }
+
+  // Non-empty buckets as [lowest value, count] pairs
+  [[nodiscard]] auto to_json() const -> nlohmann::json {
+    auto buckets = nlohmann::json::array();
+    for (std::size_t i = 0; i < num_buckets; ++i) {
+      if (counts_[i] != 0) {
+        buckets.push_back({lowest_in(i), counts_[i]});
+      }
+    }
+    return {{"sub_bucket_bits", sub_bucket_bits},
+            {"count", count_},
+            {"min", min()},
+            {"max", max_},
+            {"buckets", std::move(buckets)}};
+  }
+
+ private:
+  static constexpr std::uint64_t sub_buckets = std::uint64_t{1}
+                                               << sub_bucket_bits;
+  static constexpr std::size_t num_buckets =
+      sub_buckets + ((64 - sub_bucket_bits) * (sub_buckets / 2));
+
+  // Values in [2^k, 2^(k+1)) keep their top `sub_bucket_bits` bits
+  static auto bucket_of(std::uint64_t value) -> std::size_t {
+    if (value < sub_buckets) {
+      return value;
+    }
+    const auto shift = std::bit_width(value) - sub_bucket_bits;
+    return sub_buckets + ((shift - 1) * (sub_buckets / 2)) +
+           ((value >> shift) - (sub_buckets / 2));
+  }
+
+  static auto lowest_in(std::size_t bucket) -> std::uint64_t {
+    if (bucket < sub_buckets) {
+      return bucket;
+    }
+    const auto offset = bucket - sub_buckets;
+    const auto shift = (offset / (sub_buckets / 2)) + 1;
+    return ((offset % (sub_buckets / 2)) + (sub_buckets / 2)) << shift;
+  }
+
+  static auto highest_in(std::size_t bucket) -> std::uint64_t {
+    return bucket + 1 == num_buckets ? std::numeric_limits<std::uint64_t>::max()
+                                     : lowest_in(bucket + 1) - 1;
+  }
+
+  std::vector<std::uint64_t> counts_;
+  std::uint64_t count_{0};
+  std::uint64_t sum_{0};
+  double sum_sq_{0};
+  std::uint64_t min_{std::numeric_limits<std::uint64_t>::max()};
+  std::uint64_t max_{0};
+};
+
+}  // namespace ggb::bench
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "common/logging.h"
+
+namespace ggb::bench {
+
+// A hardware event counted around the query loop
+struct PerfEvent {
+  std::string_view name;
+  std::uint32_t type;
+  std::uint64_t config;
+};
+
+inline constexpr auto cache_miss_event(std::uint64_t cache) -> std::uint64_t {
+  return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+         (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+
+inline constexpr std::array<PerfEvent, 5> perf_events{{
+    {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {"llc_load_misses", PERF_TYPE_HW_CACHE,
+     cache_miss_event(PERF_COUNT_HW_CACHE_LL)},
+    {"dtlb_load_misses", PERF_TYPE_HW_CACHE,
+     cache_miss_event(PERF_COUNT_HW_CACHE_DTLB)},
+    {"branch_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+}};
+
+// Event name -> count
+using PerfCounts = std::map<std::string, std::uint64_t>;
+
+struct ThreadPerfCounts {
+  int tid;
+  std::string name;  // From /proc/self/task/<tid>/comm
+  PerfCounts counts;
+};
+
+// Counts the user-space `perf_events` of every thread the process has when
+// it is constructed, one perf_event_open group per thread so that the
+// events of a thread are scheduled, and multiplexed, together. Threads
+// started later are not counted, so construct it once the store and its
+// executors are up. Events the PMU lacks are left out, as in many VMs; with
+// none left, or when perf_event_paranoid forbids it, nothing is counted.
+class PerfCounters {
+ public:
+  PerfCounters() : events_(supported_events()) {
+    if (events_.empty()) {
+      return;
+    }
+
+    std::error_code ec;
+    for (const auto& task :
+         std::filesystem::directory_iterator("/proc/self/task", ec)) {
+      open_group(std::stoi(task.path().filename().string()));
+    }
+    // Start every group at once, so all threads count the same interval
+    for (const auto& group : groups_) {
+      ioctl(group.fds.front(), PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+  }
+
+  ~PerfCounters() {
+    for (const auto& group : groups_) {
+      for (const auto fd : group.fds) {
+        close(fd);
+      }
+    }
+  }
+
+  PerfCounters(const PerfCounters&) = delete;
+  auto operator=(const PerfCounters&) -> PerfCounters& = delete;
+  PerfCounters(PerfCounters&&) = delete;
+  auto operator=(PerfCounters&&) -> PerfCounters& = delete;
+
+  // Counts since construction, per thread, scaled up when the kernel only
+  // had the group on the PMU part of the time. Threads whose group never
+  // ran are left out; empty when nothing is counted.
+  [[nodiscard]] auto read() const -> std::vector<ThreadPerfCounts> {
+    std::vector<ThreadPerfCounts> threads;
+    // nr, time_enabled, time_running, then one value per event
+    std::vector<std::uint64_t> values(3 + events_.size());
+    const auto bytes = static_cast<ssize_t>(values.size() * sizeof(values[0]));
+    for (const auto& group : groups_) {
+      if (::read(group.fds.front(), values.data(), bytes) != bytes ||
+          values[2] == 0) {
+        continue;
+      }
+      const auto scale =
+          static_cast<double>(values[1]) / static_cast<double>(values[2]);
+      ThreadPerfCounts thread{
+          .tid = group.tid, .name = group.name, .counts = {}};
+      for (std::size_t e = 0; e < events_.size(); ++e) {
+        thread.counts[std::string(events_[e].name)] =
+            static_cast<std::uint64_t>(static_cast<double>(values[3 + e]) *
+                                       scale);
+      }
+      threads.push_back(std::move(thread));
+    }
+    return threads;
+  }
+
+ private:
+  struct Group {
+    int tid;
+    std::string name;  // Read up front; the thread may be gone by `read`
+    std::vector<int> fds;  // Leader first
+  };
+
+  static auto open_event(const PerfEvent& event, int tid, int group_fd)
+      -> int {
+    perf_event_attr attr{};
+    attr.type = event.type;
+    attr.size = sizeof(attr);
+    attr.config = event.config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.disabled = group_fd == -1 ? 1 : 0;  // The leader starts the group
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                       PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(
+        syscall(SYS_perf_event_open, &attr, tid, -1, group_fd, 0));
+  }
+
+  // Probed once on the calling thread, warning about each event left out
+  static auto supported_events() -> const std::vector<PerfEvent>& {
+    static const auto supported = [] {
+      std::vector<PerfEvent> events;
+      for (const auto& event : perf_events) {
+        const auto fd = open_event(event, 0, -1);
+        if (fd == -1) {
+          GGB_LOG_WARN("perf event {} unavailable (errno: {})", event.name,
+                       errno);
+          continue;
+        }
+        close(fd);
+        events.push_back(event);
+      }
+      return events;
+    }();
+    return supported;
+  }
+
+  // A thread that exits meanwhile, or whose events cannot all join one
+  // group, is not counted
+  auto open_group(int tid) -> void {
+    Group group{.tid = tid, .name = thread_name(tid), .fds = {}};
+    for (const auto& event : events_) {
+      const auto fd = open_event(
+          event, tid, group.fds.empty() ? -1 : group.fds.front());
+      if (fd == -1) {
+        GGB_LOG_DEBUG("perf event {} of thread {} unavailable (errno: {})",
+                      event.name, tid, errno);
+        for (const auto opened : group.fds) {
+          close(opened);
+        }
+        return;
+      }
+      group.fds.push_back(fd);
+    }
+    groups_.push_back(std::move(group));
+  }
+
+  static auto thread_name(int tid) -> std::string {
+    std::ifstream comm("/proc/self/task/" + std::to_string(tid) + "/comm");
+    std::string name;
+    std::getline(comm, name);
+    return name;
+  }
+
+  const std::vector<PerfEvent> events_;  // Those the PMU supports
+  std::vector<Group> groups_;
+};
+
+// Sum over threads
+inline auto total_counts(const std::vector<ThreadPerfCounts>& threads)
+    -> PerfCounts {
+  PerfCounts total;
+  for (const auto& thread : threads) {
+    for (const auto& [name, count] : thread.counts) {
+      total[name] += count;
+    }
+  }
+  return total;
+}
+
+}  // namespace ggb::bench
@@ -1,11 +1,20 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
 #include <cstdlib>
+#include <deque>
+#include <latch>
 #include <memory>
 #include <optional>
+#include <random>
 #include <span>
 #include <string>
+#include <thread>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
@@ -36,19 +45,28 @@ class Runner {
     BenchResult result;
 
     {
-      const ScopedTimer timer("Ingestion");
+      const ScopedTimer timer([&](std::uint64_t us) {
+        result.ingest_time_us = us;
+        GGB_LOG_INFO("Ingestion: {} ms", static_cast<double>(us) / 1000.0);
+      });
       GGB_LOG_INFO("Ingesting features and graph topology");
-      ggb::io::ingest_features_from_csv(cfg_.node_feat_path, *builder_);
-      ggb::io::ingest_edgelist_from_csv(cfg_.edge_list_path.string(),
-                                        edge_buffer_);
+      ggb::io::ingest_features(cfg_.node_feat_path, *builder_);
+      ggb::io::ingest_edgelist(cfg_.edge_list_path.string(), edge_buffer_);
       graph_ = ggb::GraphTopology{.edges = std::span(edge_buffer_)};
     }
 
     {
-      const ScopedTimer timer("Building");
+      const ScopedTimer timer([&](std::uint64_t us) {
+        result.build_time_us = us;
+        GGB_LOG_INFO("Building: {} ms", static_cast<double>(us) / 1000.0);
+      });
       GGB_LOG_INFO("Constructing FeatureStore engine");
       store_ = builder_->build(graph_);
       result.num_elements_per_tensor = store_->get_tensor_size().value_or(0);
+      result.index_memory_bytes = store_->get_index_memory_bytes();
+      // As stored, so reduced-precision rows count their actual size
+      result.feature_bytes =
+          store_->get_num_keys() * store_->get_storage_row_bytes();
     }
 
     // Clear edge buffer to free some RAM
@@ -58,25 +76,354 @@ class Runner {
     // Load in queries before taking an IO snapshot
     const auto queries = QueryLoader::from_csv(cfg_.query_csv_path.string());
 
-    GGB_LOG_INFO("Running query workload");
-    result.on_start();
+    GGB_LOG_INFO(
+        "Running query workload (api: {}, in-flight: {}, prefetch: {}, "
+        "threads: {}, target: {} req/s)",
+        to_string(cfg_.workload.api), cfg_.workload.inflight,
+        cfg_.workload.prefetch_distance, cfg_.workload.threads,
+        cfg_.workload.target_qps);
+    const bool open_loop = cfg_.workload.target_qps > 0;
 
-    for (const auto& query : queries) {
-      {
-        const ScopedTimer timer(
-            [&](std::uint64_t us) { result.record_query(us, query.size()); });
-        auto feats = store_->get_multi_tensor(std::span(query));
+    // The smaller points of the scaling curve first, each replaying the
+    // whole workload on the same store. One untimed pass warms the store
+    // beforehand so the first point does not pay every cold miss alone.
+    const auto thread_counts = scaling_thread_counts(
+        open_loop ? std::size_t{1} : cfg_.workload.threads);
+    if (thread_counts.size() > 1) {
+      GGB_LOG_INFO("Warming up the store for the scaling curve");
+      BenchResult warm_up;
+      warm_up.num_elements_per_tensor = result.num_elements_per_tensor;
+      run_threaded_queries(queries, warm_up, 1);
+    }
+    std::vector<ScalingPoint> scaling;
+    for (const auto num_threads : std::span(thread_counts).first(
+             thread_counts.size() - 1)) {
+      BenchResult point;
+      point.num_elements_per_tensor = result.num_elements_per_tensor;
+      run_threaded_queries(queries, point, num_threads);
+      scaling.push_back(ScalingPoint::from(num_threads, point.compute_stats()));
+    }
+
+    result.start_metrics = store_->get_metrics();
+    if (open_loop) {
+      run_open_loop_queries(queries, result);
+    } else if (cfg_.workload.threads > 1) {
+      run_threaded_queries(queries, result, cfg_.workload.threads);
+    } else if (cfg_.workload.inflight > 1) {
+      run_pipelined_queries(queries, result);
+    } else {
+      switch (cfg_.workload.api) {
+        case QueryApi::Vector:
+          run_vector_queries(queries, result);
+          break;
+        case QueryApi::Into:
+          run_into_queries(queries, result);
+          break;
       }
     }
-    result.on_stop();
+    result.end_metrics = store_->get_metrics();
+
+    measure_index_lookups(queries, result);
 
     auto stats = result.compute_stats();
+    if (!open_loop && cfg_.workload.threads > 1) {
+      scaling.push_back(ScalingPoint::from(cfg_.workload.threads, stats));
+      stats.scaling = std::move(scaling);
+    }
     for (const auto& sink : sinks_) {
       sink->report(cfg_, stats);
     }
   }
 
  private:
+  using Query = std::vector<ggb::Key>;
+
+  auto run_vector_queries(const std::vector<Query>& queries,
+                          BenchResult& result) const -> void {
+    result.on_start();
+    for (std::size_t i = 0; i < queries.size(); ++i) {
+      prefetch_ahead(queries, i);
+      const auto& query = queries[i];
+      {
+        const ScopedTimer<std::chrono::nanoseconds> timer(
+            [&](std::uint64_t ns) { result.record_query(ns, query.size()); });
+        auto feats = store_->get_multi_tensor(std::span(query));
+      }
+    }
+    result.on_stop();
+  }
+
+  auto run_into_queries(const std::vector<Query>& queries,
+                        BenchResult& result) const -> void {
+    // Size the output buffer for the largest batch once, outside the timed
+    // region, so every query reuses the same allocation
+    std::vector<float> out(max_query_size(queries) *
+                           result.num_elements_per_tensor);
+
+    result.on_start();
+    for (std::size_t i = 0; i < queries.size(); ++i) {
+      prefetch_ahead(queries, i);
+      const auto& query = queries[i];
+      {
+        const ScopedTimer<std::chrono::nanoseconds> timer(
+            [&](std::uint64_t ns) { result.record_query(ns, query.size()); });
+        auto missing = store_->get_multi_tensor_into(std::span(query), out);
+      }
+    }
+    result.on_stop();
+  }
+
+  // Keeps up to `inflight` batches outstanding through the async APIs, the
+  // way a trainer queues batch N+1 while it computes on batch N. Latency is
+  // measured from submission until the result is collected.
+  auto run_pipelined_queries(const std::vector<Query>& queries,
+                             BenchResult& result) const -> void {
+    const auto depth = cfg_.workload.inflight;
+    const auto row_floats =
+        max_query_size(queries) * result.num_elements_per_tensor;
+
+    switch (cfg_.workload.api) {
+      case QueryApi::Vector:
+        run_pipelined(queries, result, depth,
+                      [&](const Query& query, [[maybe_unused]] std::size_t) {
+                        return store_->get_multi_tensor_async(query);
+                      });
+        break;
+      case QueryApi::Into: {
+        // One output buffer per in-flight slot
+        std::vector<std::vector<float>> buffers(depth,
+                                                std::vector<float>(row_floats));
+        run_pipelined(queries, result, depth,
+                      [&](const Query& query, std::size_t slot) {
+                        return store_->get_multi_tensor_into_async(
+                            query, buffers[slot]);
+                      });
+        break;
+      }
+    }
+  }
+
+  template <typename Submit>
+  auto run_pipelined(const std::vector<Query>& queries, BenchResult& result,
+                     std::size_t depth, Submit&& submit) const -> void {
+    using Clock = std::chrono::steady_clock;
+    using Future = std::invoke_result_t<Submit&, const Query&, std::size_t>;
+
+    struct Pending {
+      Future future;
+      Clock::time_point start;
+      std::size_t batch_size;
+    };
+    std::deque<Pending> pending;
+
+    auto collect_oldest = [&] {
+      auto& oldest = pending.front();
+      auto feats = oldest.future.get();
+      const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          Clock::now() - oldest.start)
+                          .count();
+      result.record_query(ns, oldest.batch_size);
+      pending.pop_front();
+    };
+
+    result.on_start();
+    for (std::size_t i = 0; i < queries.size(); ++i) {
+      if (pending.size() == depth) {
+        collect_oldest();
+      }
+      prefetch_ahead(queries, i);
+      // Slot i % depth was last used by query i - depth, collected above
+      const auto start = Clock::now();
+      pending.push_back({submit(queries[i], i % depth), start,
+                         queries[i].size()});
+    }
+    while (!pending.empty()) {
+      collect_oldest();
+    }
+    result.on_stop();
+  }
+
+  // Replays the workload from `num_threads` threads sharing the store, the
+  // way DataLoader workers do: thread t serves queries t, t + n, t + 2n, ...
+  // back to back and records its own latencies, merged once all are done
+  auto run_threaded_queries(const std::vector<Query>& queries,
+                            BenchResult& result, std::size_t num_threads) const
+      -> void {
+    std::vector<QueryRecorder> recorders(num_threads);
+    const auto row_floats =
+        max_query_size(queries) * result.num_elements_per_tensor;
+
+    std::latch go(1);
+    std::vector<std::jthread> threads;
+    for (std::size_t t = 0; t < num_threads; ++t) {
+      threads.emplace_back([&, t] {
+        auto& recorder = recorders[t];
+        std::vector<float> out(
+            cfg_.workload.api == QueryApi::Into ? row_floats : 0);
+        go.wait();
+        for (std::size_t i = t; i < queries.size(); i += num_threads) {
+          prefetch_ahead(queries, i, num_threads);
+          const auto& query = queries[i];
+          const ScopedTimer<std::chrono::nanoseconds> timer(
+              [&](std::uint64_t ns) {
+                recorder.latencies_ns.record(ns);
+                recorder.num_tensors += query.size();
+              });
+          if (cfg_.workload.api == QueryApi::Into) {
+            auto missing = store_->get_multi_tensor_into(std::span(query), out);
+          } else {
+            auto feats = store_->get_multi_tensor(std::span(query));
+          }
+        }
+      });
+    }
+
+    // Threads exist before the start snapshot, so per-thread counters see
+    // them, and are released together
+    result.on_start();
+    go.count_down();
+    threads.clear();
+    result.on_stop();
+    for (const auto& recorder : recorders) {
+      result.record_queries(recorder);
+    }
+  }
+
+  // Sends query i at its intended time on a `target_qps` timeline, whether
+  // or not earlier queries are done, from `threads` clients that each take
+  // the next query due. A query that goes out late because every client was
+  // busy is charged the wait: its corrected latency runs from the intended
+  // send time, so a stall shows up in the tail of every query queued behind
+  // it rather than lowering the offered load.
+  auto run_open_loop_queries(const std::vector<Query>& queries,
+                             BenchResult& result) const -> void {
+    using Clock = std::chrono::steady_clock;
+    const auto to_ns = [](Clock::duration d) {
+      return static_cast<std::uint64_t>(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(d).count());
+    };
+    const auto num_threads = cfg_.workload.threads;
+    std::vector<QueryRecorder> recorders(num_threads);
+    const auto schedule = arrival_schedule(queries.size());
+    const auto row_floats =
+        max_query_size(queries) * result.num_elements_per_tensor;
+
+    std::atomic<std::size_t> next{0};
+    Clock::time_point start;
+    std::latch go(1);
+    std::vector<std::jthread> threads;
+    for (std::size_t t = 0; t < num_threads; ++t) {
+      threads.emplace_back([&, t] {
+        auto& recorder = recorders[t];
+        std::vector<float> out(
+            cfg_.workload.api == QueryApi::Into ? row_floats : 0);
+        go.wait();
+        for (auto i = next.fetch_add(1); i < queries.size();
+             i = next.fetch_add(1)) {
+          // Hinted while waiting, outside both latency windows
+          prefetch_ahead(queries, i);
+          const auto intended = start + schedule[i];
+          wait_until(intended);
+          const auto& query = queries[i];
+          const auto sent = Clock::now();
+          if (cfg_.workload.api == QueryApi::Into) {
+            auto missing = store_->get_multi_tensor_into(std::span(query), out);
+          } else {
+            auto feats = store_->get_multi_tensor(std::span(query));
+          }
+          const auto done = Clock::now();
+          recorder.latencies_ns.record(to_ns(done - sent));
+          recorder.corrected_latencies_ns.record(to_ns(done - intended));
+          recorder.num_tensors += query.size();
+        }
+      });
+    }
+
+    result.on_start();
+    start = Clock::now();
+    go.count_down();
+    threads.clear();
+    result.on_stop();
+    for (const auto& recorder : recorders) {
+      result.record_queries(recorder);
+    }
+  }
+
+  // `sleep_until` alone overshoots by tens of microseconds, which would read
+  // as queueing delay, so sleep most of the way and spin the rest
+  static auto wait_until(std::chrono::steady_clock::time_point t) -> void {
+    constexpr auto spin = std::chrono::microseconds(200);
+    if (std::chrono::steady_clock::now() + spin < t) {
+      std::this_thread::sleep_until(t - spin);
+    }
+    while (std::chrono::steady_clock::now() < t) {
+      std::this_thread::yield();
+    }
+  }
+
+  // Intended send time of each query relative to the start of the loop.
+  // Poisson gaps are seeded from the workload, so runs are repeatable.
+  [[nodiscard]] auto arrival_schedule(std::size_t num_queries) const
+      -> std::vector<std::chrono::nanoseconds> {
+    const auto rate = cfg_.workload.target_qps;
+    std::mt19937_64 rng(static_cast<std::uint64_t>(cfg_.sampling.seed));
+    std::exponential_distribution<double> gap(rate);
+    std::vector<std::chrono::nanoseconds> schedule(num_queries);
+    double t = 0;
+    for (std::size_t i = 0; i < num_queries; ++i) {
+      schedule[i] =
+          std::chrono::nanoseconds(static_cast<std::int64_t>(t * 1e9));
+      t += cfg_.workload.arrival == Arrival::Poisson ? gap(rng) : 1.0 / rate;
+    }
+    return schedule;
+  }
+
+  // Hints the batch `prefetch_distance` ahead of batch `i` in a loop that
+  // advances by `stride`, the way a trainer whose sampler runs ahead would.
+  // Not part of any batch's latency.
+  auto prefetch_ahead(const std::vector<Query>& queries, std::size_t i,
+                      std::size_t stride = 1) const -> void {
+    const auto ahead = i + (cfg_.workload.prefetch_distance * stride);
+    if (cfg_.workload.prefetch_distance > 0 && ahead < queries.size()) {
+      store_->prefetch(std::span(queries[ahead]));
+    }
+  }
+
+  // 1, 2, 4, ... up to and including `max_threads`
+  static auto scaling_thread_counts(std::size_t max_threads)
+      -> std::vector<std::size_t> {
+    std::vector<std::size_t> counts;
+    for (std::size_t n = 1; n < max_threads; n *= 2) {
+      counts.push_back(n);
+    }
+    counts.push_back(max_threads);
+    return counts;
+  }
+
+  // Replays the workload through `get_missing_keys`, which only consults the
+  // index, to separate lookup cost from the cost of copying feature data
+  auto measure_index_lookups(const std::vector<Query>& queries,
+                             BenchResult& result) const -> void {
+    const auto start = std::chrono::steady_clock::now();
+    for (const auto& query : queries) {
+      auto missing = store_->get_missing_keys(std::span(query));
+      result.num_index_lookups += query.size();
+    }
+    result.index_lookup_ns =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start)
+            .count();
+  }
+
+  static auto max_query_size(const std::vector<Query>& queries)
+      -> std::size_t {
+    std::size_t max_size{0};
+    for (const auto& query : queries) {
+      max_size = std::max(max_size, query.size());
+    }
+    return max_size;
+  }
+
   std::unique_ptr<FeatureStoreBuilder> builder_;
   std::unique_ptr<FeatureStore> store_;
   std::optional<ggb::GraphTopology> graph_;
@@ -27,13 +27,49 @@ class ResultSink {
 
 class LogSink : public ResultSink {
  public:
-  auto report(const RunConfig& cfg, const BenchStats& stats) -> void override {
-    std::string engine_info = std::visit(
+  static auto describe(const BaseEngineConfig& engine) -> std::string {
+    return std::visit(
         overloaded{
             [](const FlatMmapConfig& c) {
-              return std::format("FlatMmap (path: {})", c.db_path);
+              return std::format(
+                  "FlatMmap (path: {}, index: {}, rows: {}, dtype: {}, hot: {} "
+                  "nodes / {} B, gather: {} threads / {} grain, coalesce: {} "
+                  "B, huge pages: {})",
+                  c.db_path, to_string(c.index), to_string(c.row_order),
+                  to_string(c.dtype), c.hot_cache.max_nodes,
+                  c.hot_cache.max_bytes, c.gather.num_threads,
+                  c.gather.grain_size, coalesce_bytes(c.coalesce),
+                  to_string(c.huge_pages));
+            },
+            [](const InMemoryConfig& c) {
+              return std::format(
+                  "InMemory (index: {}, rows: {}, dtype: {}, gather: {} "
+                  "threads / {} grain, huge pages: {})",
+                  to_string(c.index), to_string(c.row_order),
+                  to_string(c.dtype), c.gather.num_threads,
+                  c.gather.grain_size, to_string(c.huge_pages));
             },
-            [](const InMemoryConfig&) { return std::string("InMemory"); }},
+            [](const DirectIoConfig& c) {
+              return std::format(
+                  "DirectIo (path: {}, index: {}, rows: {}, dtype: {}, "
+                  "backend: {}, qd: {}, O_DIRECT: {}, coalesce: {} B)",
+                  c.db_path, to_string(c.index), to_string(c.row_order),
+                  to_string(c.dtype), to_string(c.backend), c.queue_depth,
+                  c.direct_io, coalesce_bytes(c.coalesce));
+            }},
+        engine);
+  }
+
+  auto report(const RunConfig& cfg, const BenchStats& stats) -> void override {
+    const auto engine_info = std::visit(
+        overloaded{[](const CachedConfig& c) {
+                     return std::format(
+                         "Cached (policy: {}, {:.1f} MB, shards: {}) over {}",
+                         to_string(c.policy),
+                         static_cast<double>(c.capacity_bytes) / (1024 * 1024),
+                         c.num_shards, describe(c.base));
+                   },
+                   [](const auto& c) { return describe(BaseEngineConfig(c)); }},
         cfg.engine);
 
     std::ostringstream oss;
@@ -49,6 +85,10 @@ class LogSink : public ResultSink {
         << std::format(" {:<20} : {}\n", "Run ID", cfg.run_id)
         << std::format(" {:<20} : {}\n", "Engine Type", engine_info)
         << std::format(" {:<20} : {}\n", "Sampling", sampling_str)
+        << std::format(
+               " {:<20} : {} (in-flight: {}, executor: {}, threads: {})\n",
+               "Query API", to_string(cfg.workload.api), cfg.workload.inflight,
+               cfg.workload.executor_threads, cfg.workload.threads)
         << std::string(60, '-')
         << "\n"
         // Counters
@@ -59,20 +99,24 @@ class LogSink : public ResultSink {
         << std::string(60, '-')
         << "\n"
         // Throughput
+        << std::format(" {:<20} : {:>12.3f} s\n", "Wall Time",
+                       stats.wall_time_s)
+        << std::format(" {:<20} : {:>12.2f} x\n", "Query Overlap",
+                       stats.overlap)
         << std::format(" {:<20} : {:>12.2f} req/s\n", "Throughput QPS",
                        stats.qps)
         << std::format(" {:<20} : {:>12.3f} MM/s\n", "Throughput TPS",
                        stats.tps_m)
-        << std::format(" {:<20} : {:>12.2f} GB/s\n", "Throughput BW",
+        << std::format(" {:<20} : {:>12.2f} GiB/s\n", "Throughput BW",
                        stats.gi_bps)
         << std::string(60, '-')
         << "\n"
         // System IO
-        << std::format(" {:<20} : {:>12.3f} GB\n", "Peak RAM",
+        << std::format(" {:<20} : {:>12.3f} GiB\n", "Peak RAM",
                        stats.peak_ram_gb)
-        << std::format(" {:<20} : {:>12.3f} GB\n", "Disk Read",
+        << std::format(" {:<20} : {:>12.3f} GiB\n", "Disk Read",
                        stats.disk_read_gb)
-        << std::format(" {:<20} : {:>12.2f} GB/s\n", "Disk IOPS",
+        << std::format(" {:<20} : {:>12.2f} GiB/s\n", "Disk IOPS",
                        stats.disk_iops_gb)
         << std::format(" {:<20} : {:>12} hits\n", "Major Faults",
                        stats.major_faults)
@@ -87,14 +131,108 @@ class LogSink : public ResultSink {
                        stats.invol_context_switches)
         << std::string(60, '-')
         << "\n"
+        // Load
+        << std::format(" {:<20} : {:>12.3f} s\n", "Ingest Time",
+                       stats.ingest_time_s)
+        << std::format(" {:<20} : {:>12.3f} s\n", "Build Time",
+                       stats.build_time_s)
+        << std::format(" {:<20} : {:>12.2f} GiB/s\n", "Load BW",
+                       stats.load_gi_bps)
+        << std::string(60, '-')
+        << "\n"
+        // Index
+        << std::format(" {:<20} : {:>12.3f} MB\n", "Index Memory",
+                       stats.index_memory_mb)
+        << std::format(" {:<20} : {:>12.2f} ns\n", "Index Lookup/Key",
+                       stats.index_lookup_ns_per_key)
+        << std::string(60, '-') << "\n";
+
+    // Hardware events, per tensor to compare engines and layouts
+    if (!stats.perf.empty()) {
+      for (const auto& [name, rate] :
+           per_tensor(stats.perf, stats.total_tensors)) {
+        oss << std::format(" {:<20} : {:>12} {:>10.2f}/tensor\n", name,
+                           stats.perf.at(name), rate);
+      }
+      if (stats.perf.contains("cycles") &&
+          stats.perf.contains("instructions") && stats.perf.at("cycles") > 0) {
+        oss << std::format(" {:<20} : {:>12.2f}\n", "IPC",
+                           static_cast<double>(stats.perf.at("instructions")) /
+                               static_cast<double>(stats.perf.at("cycles")));
+      }
+      oss << std::string(60, '-') << "\n";
+    }
+
+    // Engine counters
+    if (!stats.counters.empty()) {
+      for (const auto& [name, value] : stats.counters) {
+        oss << std::format(" {:<20} : {:>12}\n", name, value);
+      }
+      if (stats.counters.contains("hot_cache.hits")) {
+        oss << std::format(" {:<20} : {:>12.2f} %\n", "Hot Cache Hit Ratio",
+                           stats.hot_cache_hit_ratio * 100.0);
+      }
+      if (stats.counters.contains("direct_io.reads") ||
+          stats.counters.contains("flat_mmap.ranges")) {
+        oss << std::format(" {:<20} : {:>12.2f}\n", "Ranges/Batch",
+                           stats.ranges_per_batch);
+      }
+      oss << std::string(60, '-') << "\n";
+    }
+
+    // Where the engine spent the query time, as a share of the summed
+    // query latencies
+    if (!stats.stages.empty()) {
+      for (const auto& [name, stage] : stats.stages) {
+        oss << std::format(" {:<20} : {:>12.3f} ms {:>6.1f}%  Mean {:.2f} us"
+                           "  P99 <{:.1f} us\n",
+                           name, stage.total_ms, stage.share * 100.0,
+                           stage.mean_us, stage.p99_us);
+      }
+      oss << std::string(60, '-') << "\n";
+    }
+
+    // Throughput scaling over client threads, relative to one thread
+    if (!stats.scaling.empty()) {
+      const auto base_qps = stats.scaling.front().qps;
+      for (const auto& point : stats.scaling) {
+        oss << std::format(
+            " {:<20} : {:>12.2f} req/s {:>6.2f}x  P99 {:.3f} ms\n",
+            std::format("Threads {}", point.threads), point.qps,
+            base_qps > 0 ? point.qps / base_qps : 0.0, point.p99);
+      }
+      oss << std::string(60, '-') << "\n";
+    }
+
+    oss
         // Latency
         << std::format(" {:<20} : {:>12.3f} ms\n", "Latency Mean", stats.mean)
         << std::format(" {:<20} : {:>12.3f} ms\n", "Latency StdDev",
                        stats.std_dev)
         << std::format(" {:<20} : {:>12.3f} ms\n", "Latency P50", stats.p50)
+        << std::format(" {:<20} : {:>12.3f} ms\n", "Latency P90", stats.p90)
         << std::format(" {:<20} : {:>12.3f} ms\n", "Latency P99", stats.p99)
-        << std::format(" {:<20} : {:>12.3f} ms\n", "Latency Max", stats.max)
-        << std::string(60, '=');
+        << std::format(" {:<20} : {:>12.3f} ms\n", "Latency P99.9", stats.p999)
+        << std::format(" {:<20} : {:>12.3f} ms\n", "Latency P99.99",
+                       stats.p9999)
+        << std::format(" {:<20} : {:>12.3f} ms\n", "Latency Max", stats.max);
+    if (cfg.workload.target_qps > 0) {
+      oss << std::string(60, '-') << "\n"
+          << std::format(" {:<20} : {:>12.2f} req/s ({})\n", "Offered Load",
+                         cfg.workload.target_qps,
+                         to_string(cfg.workload.arrival))
+          << std::format(" {:<20} : {:>12.3f} ms\n", "Corrected P50",
+                         stats.corrected_p50)
+          << std::format(" {:<20} : {:>12.3f} ms\n", "Corrected P95",
+                         stats.corrected_p95)
+          << std::format(" {:<20} : {:>12.3f} ms\n", "Corrected P99",
+                         stats.corrected_p99)
+          << std::format(" {:<20} : {:>12.3f} ms\n", "Corrected P99.9",
+                         stats.corrected_p999)
+          << std::format(" {:<20} : {:>12.3f} ms\n", "Corrected Max",
+                         stats.corrected_max);
+    }
+    oss << std::string(60, '=');
 
     GGB_LOG_INFO("{}", oss.str());
   }
@@ -104,6 +242,11 @@ class LogSink : public ResultSink {
   struct overloaded : Ts... {
     using Ts::operator()...;
   };
+
+  // Largest coalesced read, 0 when rows are read one by one
+  static auto coalesce_bytes(const CoalesceConfig& c) -> std::size_t {
+    return c.enabled ? c.max_range_bytes : 0;
+  }
 };
 
 class JsonSink : public ResultSink {
@@ -112,9 +255,20 @@ class JsonSink : public ResultSink {
     auto results_dir = cfg.get_results_dir();
     std::filesystem::create_directories(results_dir);
 
-    std::string engine_name = std::visit(
-        overloaded{[](const FlatMmapConfig&) { return "mmap"; },
-                   [](const InMemoryConfig&) { return "in_memory"; }},
+    const auto base_name = [](const BaseEngineConfig& engine) {
+      return std::visit(
+          overloaded{[](const FlatMmapConfig&) { return "mmap"; },
+                     [](const InMemoryConfig&) { return "in_memory"; },
+                     [](const DirectIoConfig&) { return "direct_io"; }},
+          engine);
+    };
+    const std::string engine_name = std::visit(
+        overloaded{[&](const CachedConfig& c) {
+                     return std::string("cached_") + base_name(c.base);
+                   },
+                   [&](const auto& c) {
+                     return std::string(base_name(BaseEngineConfig(c)));
+                   }},
         cfg.engine);
 
     auto now = std::chrono::system_clock::now();
@@ -123,7 +277,8 @@ class JsonSink : public ResultSink {
     ss << std::put_time(std::localtime(&time_t), "%Y-%m-%d_%H-%M-%S");
 
     std::string filename =
-        std::format("result_{}_{}.json", engine_name, ss.str());
+        std::format("result_{}_{}_{}.json", engine_name,
+                    to_string(cfg.workload.api), ss.str());
     auto file_path = results_dir / filename;
 
     nlohmann::json out;
@@ -131,7 +286,8 @@ class JsonSink : public ResultSink {
                        {"run_id", cfg.run_id},
                        {"engine", engine_name},
                        {"git_hash", GGB_GIT_HASH},
-                       {"sampling", cfg.sampling}};
+                       {"sampling", cfg.sampling},
+                       {"workload", cfg.workload}};
     out["stats"] = stats;
 
     std::ofstream f(file_path);
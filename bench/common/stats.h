@@ -3,29 +3,68 @@
 #include <sys/resource.h>
 #include <sys/time.h>
 
-#include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <cstddef>
 #include <cstdint>
 #include <fstream>
-#include <functional>
-#include <numeric>
+#include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "common/logging.h"
+#include "ggb/core.h"
+#include "histogram.h"
+#include "perf_counter.h"
 
 // Third-party
 #include <nlohmann/json.hpp>
 
 namespace ggb::bench {
 
+struct BenchStats;
+
+// Throughput and tail latency of the query loop at one thread count
+struct ScalingPoint {
+  std::size_t threads;
+  double qps;
+  double tps_m;
+  double p50, p99;  // ms
+
+  static auto from(std::size_t threads, const BenchStats& stats)
+      -> ScalingPoint;
+};
+
+// Time the engine spent in one lookup stage during the query loop, summed
+// over its threads
+struct StageStats {
+  std::uint64_t count;  // Timed sections, one per gathered chunk
+  double total_ms;
+  double mean_us;
+  double p99_us;  // Upper bound of the power-of-two bucket
+  double share;   // Of the summed query latencies
+
+  static auto from(const StageTimes& times, double query_ns) -> StageStats;
+};
+
 struct BenchStats {
   // Latency (ms)
   double mean, std_dev, min, max;
-  double p50, p95, p99;
+  double p50, p90, p95, p99, p999, p9999;
+
+  // Open loop only: latency from each query's intended send time, which
+  // charges queries for the time they queued behind a stalled one
+  double corrected_p50, corrected_p95, corrected_p99, corrected_p999;
+  double corrected_max;
+
+  // Every query latency (ns), and the corrected ones in open loop
+  LatencyHistogram histogram;
+  LatencyHistogram corrected_histogram;
 
-  // Throughput
+  // Throughput (over wall time of the query loop)
+  double wall_time_s;
+  double overlap;  // Sum of query latencies / wall time, >1 when pipelined
   double qps;
   double tps_m;  // Millions of tensors per second
   double gi_bps;
@@ -39,18 +78,117 @@ struct BenchStats {
   std::uint64_t vol_context_switches;
   std::uint64_t invol_context_switches;
 
+  // Hardware events of the query loop (see `perf_events`), summed and per
+  // thread; empty without perf counters
+  PerfCounts perf;
+  std::vector<ThreadPerfCounts> perf_threads;
+
+  // Index (lookups timed in a separate pass that skips the feature data)
+  double index_memory_mb;
+  double index_lookup_ns_per_key;
+
+  // Load: rows are written while ingesting, then `build` finishes the store
+  double ingest_time_s;
+  double build_time_s;
+  double load_gi_bps;  // Feature bytes / (ingest + build time)
+
+  // Engine counters accumulated during the query loop
+  std::map<std::string, std::uint64_t> counters;
+  double hot_cache_hit_ratio;  // Share of found rows served from RAM
+  double ranges_per_batch;     // Reads issued after coalescing rows
+
+  // Engine lookup stages timed during the query loop, see `get_metrics`
+  std::map<std::string, StageStats> stages;
+
   std::size_t total_queries;
   std::size_t total_tensors;
+
+  // One point per thread count with `--threads`, ending at the run above
+  std::vector<ScalingPoint> scaling;
 };
 
+inline auto ScalingPoint::from(std::size_t threads, const BenchStats& stats)
+    -> ScalingPoint {
+  return {.threads = threads,
+          .qps = stats.qps,
+          .tps_m = stats.tps_m,
+          .p50 = stats.p50,
+          .p99 = stats.p99};
+}
+
+inline auto StageStats::from(const StageTimes& times, double query_ns)
+    -> StageStats {
+  const auto total_ns = static_cast<double>(times.total_ns);
+  // Rank of the 99th percentile sample, then the bucket holding it
+  const auto rank = times.count - (times.count / 100);
+  std::size_t bucket = 0;
+  for (std::uint64_t seen = 0; bucket + 1 < times.buckets.size(); ++bucket) {
+    seen += times.buckets[bucket];
+    if (seen >= rank) {
+      break;
+    }
+  }
+  return {.count = times.count,
+          .total_ms = total_ns / 1e6,
+          .mean_us = times.count == 0 ? 0.0 : total_ns / times.count / 1e3,
+          .p99_us = std::ldexp(1.0, static_cast<int>(bucket) + 1) / 1e3,
+          .share = query_ns > 0 ? total_ns / query_ns : 0.0};
+}
+
+inline auto to_json(nlohmann::json& j, const StageStats& s) -> void {
+  j = nlohmann::json{{"count", s.count},
+                     {"total_ms", s.total_ms},
+                     {"mean_us", s.mean_us},
+                     {"p99_us", s.p99_us},
+                     {"share", s.share}};
+}
+
+inline auto to_json(nlohmann::json& j, const ScalingPoint& p) -> void {
+  j = nlohmann::json{{"threads", p.threads},
+                     {"qps_throughput", p.qps},
+                     {"tps_mm_throughput", p.tps_m},
+                     {"p50_latency_ms", p.p50},
+                     {"p99_latency_ms", p.p99}};
+}
+
+inline auto to_json(nlohmann::json& j, const ThreadPerfCounts& t) -> void {
+  j = nlohmann::json{{"tid", t.tid}, {"name", t.name}, {"counts", t.counts}};
+}
+
+// Each event per tensor read, which compares engines and layouts serving
+// batches of different sizes
+inline auto per_tensor(const PerfCounts& perf, std::size_t tensors)
+    -> std::map<std::string, double> {
+  std::map<std::string, double> rates;
+  for (const auto& [name, count] : perf) {
+    rates[name] = tensors == 0 ? 0.0 : static_cast<double>(count) / tensors;
+  }
+  return rates;
+}
+
 inline auto to_json(nlohmann::json& j, const BenchStats& s) -> void {
   j = nlohmann::json{{"mean_latency_ms", s.mean},
                      {"std_dev_latency_ms", s.std_dev},
                      {"min_latency_ms", s.min},
                      {"max_latency_ms", s.max},
+                     {"wall_time_s", s.wall_time_s},
+                     {"overlap", s.overlap},
                      {"p50_latency_ms", s.p50},
                      {"p95_latency_ms", s.p95},
+                     {"p90_latency_ms", s.p90},
                      {"p99_latency_ms", s.p99},
+                     {"p999_latency_ms", s.p999},
+                     {"p9999_latency_ms", s.p9999},
+                     {"corrected_p50_latency_ms", s.corrected_p50},
+                     {"corrected_p95_latency_ms", s.corrected_p95},
+                     {"corrected_p99_latency_ms", s.corrected_p99},
+                     {"corrected_p999_latency_ms", s.corrected_p999},
+                     {"corrected_max_latency_ms", s.corrected_max},
+                     {"latency_histogram_ns", s.histogram.to_json()},
+                     {"corrected_latency_histogram_ns",
+                      s.corrected_histogram.count() == 0
+                          ? nlohmann::json(nullptr)
+                          : s.corrected_histogram.to_json()},
                      {"qps_throughput", s.qps},
                      {"tps_mm_throughput", s.tps_m},
                      {"gi_bps_throughput", s.gi_bps},
@@ -61,8 +199,22 @@ inline auto to_json(nlohmann::json& j, const BenchStats& s) -> void {
                      {"minor_faults", s.minor_faults},
                      {"voluntary_context_switches", s.vol_context_switches},
                      {"involuntary_context_switches", s.invol_context_switches},
+                     {"perf", s.perf.empty() ? nlohmann::json(nullptr)
+                                             : nlohmann::json(s.perf)},
+                     {"perf_per_tensor", per_tensor(s.perf, s.total_tensors)},
+                     {"perf_threads", s.perf_threads},
+                     {"index_memory_mb", s.index_memory_mb},
+                     {"index_lookup_ns_per_key", s.index_lookup_ns_per_key},
+                     {"ingest_time_s", s.ingest_time_s},
+                     {"build_time_s", s.build_time_s},
+                     {"load_gi_bps", s.load_gi_bps},
+                     {"counters", s.counters},
+                     {"hot_cache_hit_ratio", s.hot_cache_hit_ratio},
+                     {"ranges_per_batch", s.ranges_per_batch},
+                     {"stages", s.stages},
                      {"total_queries", s.total_queries},
-                     {"total_tensors", s.total_tensors}};
+                     {"total_tensors", s.total_tensors},
+                     {"scaling", s.scaling}};
 }
 
 struct IOSnapshot {
@@ -113,61 +265,137 @@ struct IOSnapshot {
   }
 };
 
+// The queries one thread issued, merged into the run once it is done
+struct QueryRecorder {
+  LatencyHistogram latencies_ns;
+  LatencyHistogram corrected_latencies_ns;  // Open loop only
+  std::size_t num_tensors{0};
+};
+
 struct BenchResult {
-  std::vector<std::uint64_t> latencies_us;
+  LatencyHistogram latencies_ns;
+  LatencyHistogram corrected_latencies_ns;  // Open loop only
   std::size_t num_tensors_read{0};
   std::size_t num_elements_per_tensor{0};
 
+  std::size_t index_memory_bytes{0};
+  std::uint64_t index_lookup_ns{0};
+  std::size_t num_index_lookups{0};
+
+  std::uint64_t ingest_time_us{0};
+  std::uint64_t build_time_us{0};
+  std::size_t feature_bytes{0};
+
+  Metrics start_metrics;
+  Metrics end_metrics;
+
   IOSnapshot start_io;
   IOSnapshot end_io;
+  std::unique_ptr<PerfCounters> perf_counters;
+  std::vector<ThreadPerfCounts> perf_threads;
+  std::chrono::steady_clock::time_point start_time;
+  std::chrono::steady_clock::time_point end_time;
 
-  auto on_start() -> void { start_io = IOSnapshot::capture(); }
-  auto on_stop() -> void { end_io = IOSnapshot::capture(); }
+  auto on_start() -> void {
+    start_io = IOSnapshot::capture();
+    perf_counters = std::make_unique<PerfCounters>();
+    start_time = std::chrono::steady_clock::now();
+  }
+  auto on_stop() -> void {
+    end_time = std::chrono::steady_clock::now();
+    perf_threads = perf_counters->read();
+    perf_counters.reset();
+    end_io = IOSnapshot::capture();
+  }
 
-  auto record_query(std::uint64_t duration_us, std::size_t batch_size) -> void {
-    latencies_us.push_back(duration_us);
+  auto record_query(std::uint64_t duration_ns, std::size_t batch_size) -> void {
+    latencies_ns.record(duration_ns);
     num_tensors_read += batch_size;
   }
 
+  auto record_queries(const QueryRecorder& recorder) -> void {
+    latencies_ns.merge(recorder.latencies_ns);
+    corrected_latencies_ns.merge(recorder.corrected_latencies_ns);
+    num_tensors_read += recorder.num_tensors;
+  }
+
   [[nodiscard]] auto compute_stats() const -> BenchStats {
-    if (latencies_us.empty()) {
+    if (latencies_ns.count() == 0) {
       GGB_LOG_WARN("No latencies found");
       return {};
     }
 
-    auto sorted_latencies = latencies_us;
-    std::ranges::sort(sorted_latencies);
-
-    const auto n = sorted_latencies.size();
-    const double total_us =
-        std::accumulate(sorted_latencies.begin(), sorted_latencies.end(), 0.0);
-    const double total_s = total_us / 1'000'000.0;
-    const double mean_us = total_us / n;
-
-    auto get_p_ms = [&](double percentile) {
-      const size_t idx =
-          static_cast<size_t>(std::ceil(percentile / 100.0 * n)) - 1;
-      return static_cast<double>(
-                 sorted_latencies[std::clamp(idx, std::size_t{0}, n - 1)]) /
-             1000.0;
+    const auto n = static_cast<std::size_t>(latencies_ns.count());
+    const double total_us = static_cast<double>(latencies_ns.sum()) / 1000.0;
+
+    // Queries may overlap when pipelined, so throughput uses wall time
+    const double wall_s =
+        std::chrono::duration<double>(end_time - start_time).count();
+    const double total_s = wall_s > 0 ? wall_s : total_us / 1'000'000.0;
+
+    const auto counter_at = [](const auto& counters, const std::string& name)
+        -> std::uint64_t {
+      const auto it = counters.find(name);
+      return it != counters.end() ? it->second : 0;
+    };
+    std::map<std::string, std::uint64_t> counters;
+    for (const auto& [name, value] : end_metrics.counters) {
+      counters[name] = value - counter_at(start_metrics.counters, name);
+    }
+    std::map<std::string, StageStats> stages;
+    for (const auto& [name, end] : end_metrics.stages) {
+      auto times = end;
+      if (const auto it = start_metrics.stages.find(name);
+          it != start_metrics.stages.end()) {
+        times.count -= it->second.count;
+        times.total_ns -= it->second.total_ns;
+        for (std::size_t b = 0; b < times.buckets.size(); ++b) {
+          times.buckets[b] -= it->second.buckets[b];
+        }
+      }
+      if (times.count > 0) {
+        stages[name] = StageStats::from(
+            times, static_cast<double>(latencies_ns.sum()));
+      }
+    }
+    const auto hot_hits = counter_at(counters, "hot_cache.hits");
+    const auto hot_lookups =
+        hot_hits + counter_at(counters, "hot_cache.misses");
+    const auto ranges = counter_at(counters, "direct_io.reads") +
+                        counter_at(counters, "flat_mmap.ranges");
+
+    const auto load_us = ingest_time_us + build_time_us;
+
+    const auto ms = [](double ns) { return ns / 1e6; };
+    const auto get_p_ms = [&](double percentile) {
+      return ms(static_cast<double>(latencies_ns.percentile(percentile)));
+    };
+    const auto get_corrected_ms = [&](double percentile) {
+      return ms(
+          static_cast<double>(corrected_latencies_ns.percentile(percentile)));
     };
 
     return BenchStats{
-        .mean = mean_us / 1000.0,
-        .std_dev = std::sqrt(std::transform_reduce(
-                                 sorted_latencies.begin(),
-                                 sorted_latencies.end(), 0.0, std::plus<>(),
-                                 [mean_us](auto v) {
-                                   return std::pow(
-                                       static_cast<double>(v) - mean_us, 2);
-                                 }) /
-                             n) /
-                   1000.0,
-        .min = static_cast<double>(sorted_latencies.front()) / 1000.0,
-        .max = static_cast<double>(sorted_latencies.back()) / 1000.0,
+        .mean = ms(latencies_ns.mean()),
+        .std_dev = ms(latencies_ns.std_dev()),
+        .min = ms(static_cast<double>(latencies_ns.min())),
+        .max = ms(static_cast<double>(latencies_ns.max())),
         .p50 = get_p_ms(50.0),
+        .p90 = get_p_ms(90.0),
         .p95 = get_p_ms(95.0),
         .p99 = get_p_ms(99.0),
+        .p999 = get_p_ms(99.9),
+        .p9999 = get_p_ms(99.99),
+        .corrected_p50 = get_corrected_ms(50.0),
+        .corrected_p95 = get_corrected_ms(95.0),
+        .corrected_p99 = get_corrected_ms(99.0),
+        .corrected_p999 = get_corrected_ms(99.9),
+        .corrected_max =
+            ms(static_cast<double>(corrected_latencies_ns.max())),
+        .histogram = latencies_ns,
+        .corrected_histogram = corrected_latencies_ns,
+        .wall_time_s = total_s,
+        .overlap = (total_us / 1'000'000.0) / total_s,
         .qps = static_cast<double>(n) / total_s,
         .tps_m = (static_cast<double>(num_tensors_read) / total_s) / 1e6,
         .gi_bps =
@@ -185,8 +413,29 @@ struct BenchResult {
         .minor_faults = end_io.minor_faults - start_io.minor_faults,
         .vol_context_switches = end_io.vol_csw - start_io.vol_csw,
         .invol_context_switches = end_io.invol_csw - start_io.invol_csw,
+        .perf = total_counts(perf_threads),
+        .perf_threads = perf_threads,
+        .index_memory_mb =
+            static_cast<double>(index_memory_bytes) / (1024.0 * 1024.0),
+        .index_lookup_ns_per_key =
+            num_index_lookups == 0
+                ? 0.0
+                : static_cast<double>(index_lookup_ns) / num_index_lookups,
+        .ingest_time_s = static_cast<double>(ingest_time_us) / 1e6,
+        .build_time_s = static_cast<double>(build_time_us) / 1e6,
+        .load_gi_bps = load_us == 0 ? 0.0
+                                    : static_cast<double>(feature_bytes) /
+                                          (1024.0 * 1024.0 * 1024.0) /
+                                          (static_cast<double>(load_us) / 1e6),
+        .counters = counters,
+        .hot_cache_hit_ratio =
+            hot_lookups == 0 ? 0.0
+                             : static_cast<double>(hot_hits) / hot_lookups,
+        .ranges_per_batch = static_cast<double>(ranges) / n,
+        .stages = stages,
         .total_queries = n,
-        .total_tensors = num_tensors_read};
+        .total_tensors = num_tensors_read,
+        .scaling = {}};
   }
 };
 
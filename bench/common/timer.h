@@ -13,6 +13,8 @@
 
 namespace ggb::bench {
 
+// Reports the elapsed time in whole `Unit`s to its callback when destroyed
+template <typename Unit = std::chrono::microseconds>
 class ScopedTimer {
  public:
   using Callback = std::function<void(std::uint64_t)>;
@@ -23,15 +25,16 @@ class ScopedTimer {
   explicit ScopedTimer(std::string_view op_name = "Operation")
       : start_(std::chrono::high_resolution_clock::now()) {
     const std::string op_name_str{op_name};
-    cb_ = [op_name_str](std::uint64_t us) {
-      GGB_LOG_INFO("{}: {} ms", op_name_str, static_cast<double>(us) / 1000.0);
+    cb_ = [op_name_str](std::uint64_t elapsed) {
+      GGB_LOG_INFO("{}: {} ms", op_name_str,
+                   std::chrono::duration<double, std::milli>(Unit(elapsed))
+                       .count());
     };
   }
 
   ~ScopedTimer() {
     auto end = std::chrono::high_resolution_clock::now();
-    auto duration =
-        std::chrono::duration_cast<std::chrono::microseconds>(end - start_);
+    auto duration = std::chrono::duration_cast<Unit>(end - start_);
     try {
       cb_(duration.count());
     } catch (...) {
@@ -1,5 +1,12 @@
+#include <algorithm>
+#include <cstddef>
 #include <iostream>
+#include <optional>
+#include <string>
 #include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
 
 #include "config.h"
 #include "ggb/core.h"
@@ -9,6 +16,25 @@ struct Args {
   std::string_view dataset;
   std::string_view run_id;
   std::string_view engine = "all";
+  std::string_view api = "vector";
+  std::size_t inflight = 1;
+  std::size_t threads = 1;
+  double target_qps = 0;
+  std::optional<ggb::bench::Arrival> arrival = ggb::bench::Arrival::Fixed;
+  std::size_t executor_threads = 0;
+  std::size_t prefetch_distance = 0;
+  std::optional<ggb::IndexKind> index = ggb::IndexKind::Eytzinger;
+  std::optional<ggb::RowOrder> row_order = ggb::RowOrder::Insertion;
+  ggb::HotCacheConfig hot_cache{};
+  std::size_t cache_mb = 0;
+  std::optional<ggb::CachePolicy> cache_policy = ggb::CachePolicy::S3Fifo;
+  std::optional<ggb::IoBackend> io_backend = ggb::IoBackend::Auto;
+  std::size_t queue_depth = 128;
+  ggb::WriterConfig writer{};
+  std::optional<ggb::StorageDType> dtype = ggb::StorageDType::F32;
+  ggb::GatherConfig gather{};
+  std::optional<std::size_t> coalesce_kb = std::nullopt;
+  std::optional<ggb::HugePages> huge_pages = ggb::HugePages::None;
   bool help = false;
 };
 
@@ -17,10 +43,165 @@ namespace {
 auto print_usage() -> void {
   std::cout << "Usage: bench_main <dataset> <run_id> [options]\n"
             << "Options:\n"
-            << "  --engine <mmap|in_memory|all>  (default: all)\n"
+            << "  --engine <mmap|in_memory|direct_io|all>  (default: all)\n"
+            << "  --api <vector|into|all>        (default: vector)\n"
+            << "  --inflight <K>                 Async batches kept in flight "
+               "(default: 1)\n"
+            << "  --threads <N>                  Client threads sharing the "
+               "store, measured at 1, 2, 4, ...\n"
+            << "                                 up to N, replaying the "
+               "workload once per point\n"
+            << "                                 after one untimed warm-up "
+               "pass (default: 1)\n"
+            << "  --target-qps <R>               Open loop: send queries at R "
+               "req/s from the --threads\n"
+            << "                                 clients and report "
+               "corrected latency (default: 0, off)\n"
+            << "  --arrival <fixed|poisson>      Open-loop send times "
+               "(default: fixed)\n"
+            << "  --executor-threads <N>         Engine worker threads "
+               "(default: 0, inline)\n"
+            << "  --prefetch-distance <D>        Prefetch batch i+D while "
+               "batch i is served, on the\n"
+            << "                                 --executor-threads "
+               "workers (default: 0)\n"
+            << "  --index <hash|eytzinger|perfect_hash>  Sparse key index "
+               "(default: eytzinger)\n"
+            << "  --row-order <insertion|degree|rcm>     Row layout built "
+               "from the graph (default: insertion)\n"
+            << "  --hot-cache-nodes <K>          Pin the top-K nodes by degree "
+               "in RAM (mmap only)\n"
+            << "  --hot-cache-mb <M>             Byte budget for pinned rows "
+               "(mmap only)\n"
+            << "  --cache-mb <M>                 Wrap engines in a row cache "
+               "of M MiB (default: 0, off)\n"
+            << "  --cache-policy <clock|s3fifo|lru>      Row cache policy "
+               "(default: s3fifo)\n"
+            << "  --io-backend <auto|io_uring|pread>     Read path of "
+               "direct_io (default: auto)\n"
+            << "  --queue-depth <Q>              Reads in flight per direct_io "
+               "batch (default: 128)\n"
+            << "  --writer-buffer-mb <M>         Build staging buffer size, "
+               "the store file itself is\n"
+            << "                                 preallocated (default: 8)\n"
+            << "  --no-sync                      Skip fdatasync of the store "
+               "file after build\n"
+            << "  --dtype <f32|f16|bf16|int8>    Element type rows are stored "
+               "in (default: f32)\n"
+            << "  --gather-threads <N>           Extra threads splitting one "
+               "large batch (default: 0)\n"
+            << "  --grain-size <G>               Fewest keys per gather thread "
+               "(default: 4096)\n"
+            << "  --coalesce-kb <K>              Merge touching rows into "
+               "reads of up to K KiB, 0 to\n"
+            << "                                 disable (default: mmap 0, "
+               "direct_io 64)\n"
+            << "  --huge-pages <none|thp|hugetlb>        Page size backing "
+               "rows (default: none)\n"
             << "  --help                         Show this message\n";
 }
 
+auto parse_index_kind(std::string_view name) -> std::optional<ggb::IndexKind> {
+  for (const auto kind : {ggb::IndexKind::Hash, ggb::IndexKind::Eytzinger,
+                          ggb::IndexKind::PerfectHash}) {
+    if (name == ggb::bench::to_string(kind)) {
+      return kind;
+    }
+  }
+  return std::nullopt;
+}
+
+auto parse_row_order(std::string_view name) -> std::optional<ggb::RowOrder> {
+  for (const auto order :
+       {ggb::RowOrder::Insertion, ggb::RowOrder::Degree, ggb::RowOrder::Rcm}) {
+    if (name == ggb::bench::to_string(order)) {
+      return order;
+    }
+  }
+  return std::nullopt;
+}
+
+auto parse_cache_policy(std::string_view name)
+    -> std::optional<ggb::CachePolicy> {
+  for (const auto policy : {ggb::CachePolicy::Clock, ggb::CachePolicy::S3Fifo,
+                            ggb::CachePolicy::Lru}) {
+    if (name == ggb::bench::to_string(policy)) {
+      return policy;
+    }
+  }
+  return std::nullopt;
+}
+
+auto parse_io_backend(std::string_view name)
+    -> std::optional<ggb::IoBackend> {
+  for (const auto backend : {ggb::IoBackend::Auto, ggb::IoBackend::IoUring,
+                             ggb::IoBackend::Pread}) {
+    if (name == ggb::bench::to_string(backend)) {
+      return backend;
+    }
+  }
+  return std::nullopt;
+}
+
+auto parse_dtype(std::string_view name) -> std::optional<ggb::StorageDType> {
+  for (const auto dtype : {ggb::StorageDType::F32, ggb::StorageDType::F16,
+                           ggb::StorageDType::BF16, ggb::StorageDType::Int8}) {
+    if (name == ggb::bench::to_string(dtype)) {
+      return dtype;
+    }
+  }
+  return std::nullopt;
+}
+
+auto parse_huge_pages(std::string_view name)
+    -> std::optional<ggb::HugePages> {
+  for (const auto huge_pages : {ggb::HugePages::None,
+                                ggb::HugePages::Transparent,
+                                ggb::HugePages::Explicit}) {
+    if (name == ggb::bench::to_string(huge_pages)) {
+      return huge_pages;
+    }
+  }
+  return std::nullopt;
+}
+
+auto parse_arrival(std::string_view name)
+    -> std::optional<ggb::bench::Arrival> {
+  for (const auto arrival :
+       {ggb::bench::Arrival::Fixed, ggb::bench::Arrival::Poisson}) {
+    if (name == ggb::bench::to_string(arrival)) {
+      return arrival;
+    }
+  }
+  return std::nullopt;
+}
+
+// Puts `engine` behind a row cache when one was requested. The cache then
+// owns the executor and the wrapped engine runs inline on its workers.
+auto maybe_cached(const Args& args, ggb::BaseEngineConfig engine)
+    -> ggb::EngineConfig {
+  if (args.cache_mb == 0) {
+    return std::visit([](auto&& c) -> ggb::EngineConfig { return c; },
+                      engine);
+  }
+  const ggb::ExecutorConfig executor{.num_threads = args.executor_threads};
+  std::visit([](auto& c) { c.executor = {}; }, engine);
+  return ggb::CachedConfig{.base = std::move(engine),
+                           .capacity_bytes = args.cache_mb * 1024 * 1024,
+                           .policy = *args.cache_policy,
+                           .executor = executor};
+}
+
+// `--coalesce-kb` if given, else the engine's own default
+auto coalesce_for(const Args& args, ggb::CoalesceConfig engine_default)
+    -> ggb::CoalesceConfig {
+  if (!args.coalesce_kb) {
+    return engine_default;
+  }
+  return {.enabled = *args.coalesce_kb > 0,
+          .max_range_bytes = *args.coalesce_kb * 1024};
+}
+
 auto parse_args(int argc, char** argv) -> std::optional<Args> {
   if (argc < 3) {
     return std::nullopt;
@@ -32,6 +213,78 @@ auto parse_args(int argc, char** argv) -> std::optional<Args> {
     std::string_view arg = argv[i];
     if (arg == "--engine" && i + 1 < argc) {
       args.engine = argv[++i];
+    } else if (arg == "--api" && i + 1 < argc) {
+      args.api = argv[++i];
+    } else if (arg == "--inflight" && i + 1 < argc) {
+      args.inflight = std::max<std::size_t>(1, std::stoull(argv[++i]));
+    } else if (arg == "--threads" && i + 1 < argc) {
+      args.threads = std::max<std::size_t>(1, std::stoull(argv[++i]));
+    } else if (arg == "--target-qps" && i + 1 < argc) {
+      args.target_qps = std::stod(argv[++i]);
+    } else if (arg == "--arrival" && i + 1 < argc) {
+      args.arrival = parse_arrival(argv[++i]);
+      if (!args.arrival) {
+        std::cerr << "Unknown arrival: " << argv[i] << "\n";
+        return std::nullopt;
+      }
+    } else if (arg == "--executor-threads" && i + 1 < argc) {
+      args.executor_threads = std::stoull(argv[++i]);
+    } else if (arg == "--prefetch-distance" && i + 1 < argc) {
+      args.prefetch_distance = std::stoull(argv[++i]);
+    } else if (arg == "--index" && i + 1 < argc) {
+      args.index = parse_index_kind(argv[++i]);
+      if (!args.index) {
+        std::cerr << "Unknown index: " << argv[i] << "\n";
+        return std::nullopt;
+      }
+    } else if (arg == "--row-order" && i + 1 < argc) {
+      args.row_order = parse_row_order(argv[++i]);
+      if (!args.row_order) {
+        std::cerr << "Unknown row order: " << argv[i] << "\n";
+        return std::nullopt;
+      }
+    } else if (arg == "--hot-cache-nodes" && i + 1 < argc) {
+      args.hot_cache.max_nodes = std::stoull(argv[++i]);
+    } else if (arg == "--hot-cache-mb" && i + 1 < argc) {
+      args.hot_cache.max_bytes = std::stoull(argv[++i]) * 1024 * 1024;
+    } else if (arg == "--cache-mb" && i + 1 < argc) {
+      args.cache_mb = std::stoull(argv[++i]);
+    } else if (arg == "--cache-policy" && i + 1 < argc) {
+      args.cache_policy = parse_cache_policy(argv[++i]);
+      if (!args.cache_policy) {
+        std::cerr << "Unknown cache policy: " << argv[i] << "\n";
+        return std::nullopt;
+      }
+    } else if (arg == "--io-backend" && i + 1 < argc) {
+      args.io_backend = parse_io_backend(argv[++i]);
+      if (!args.io_backend) {
+        std::cerr << "Unknown io backend: " << argv[i] << "\n";
+        return std::nullopt;
+      }
+    } else if (arg == "--queue-depth" && i + 1 < argc) {
+      args.queue_depth = std::stoull(argv[++i]);
+    } else if (arg == "--writer-buffer-mb" && i + 1 < argc) {
+      args.writer.buffer_bytes = std::stoull(argv[++i]) * 1024 * 1024;
+    } else if (arg == "--no-sync") {
+      args.writer.sync = false;
+    } else if (arg == "--dtype" && i + 1 < argc) {
+      args.dtype = parse_dtype(argv[++i]);
+      if (!args.dtype) {
+        std::cerr << "Unknown dtype: " << argv[i] << "\n";
+        return std::nullopt;
+      }
+    } else if (arg == "--gather-threads" && i + 1 < argc) {
+      args.gather.num_threads = std::stoull(argv[++i]);
+    } else if (arg == "--grain-size" && i + 1 < argc) {
+      args.gather.grain_size = std::stoull(argv[++i]);
+    } else if (arg == "--coalesce-kb" && i + 1 < argc) {
+      args.coalesce_kb = std::stoull(argv[++i]);
+    } else if (arg == "--huge-pages" && i + 1 < argc) {
+      args.huge_pages = parse_huge_pages(argv[++i]);
+      if (!args.huge_pages) {
+        std::cerr << "Unknown huge pages: " << argv[i] << "\n";
+        return std::nullopt;
+      }
     } else if (arg == "--help" || arg == "-h") {
       args.help = true;
     } else {
@@ -39,6 +292,16 @@ auto parse_args(int argc, char** argv) -> std::optional<Args> {
       return std::nullopt;
     }
   }
+  if ((args.threads > 1 || args.target_qps > 0) && args.inflight > 1) {
+    std::cerr << "--threads and --target-qps cannot be combined with "
+                 "--inflight\n";
+    return std::nullopt;
+  }
+  // Engines drop prefetch hints when they have no workers to run them on
+  if (args.prefetch_distance > 0 && args.executor_threads == 0) {
+    std::cerr << "--prefetch-distance requires --executor-threads\n";
+    return std::nullopt;
+  }
   return args;
 }
 
@@ -51,18 +314,83 @@ auto main(int argc, char** argv) -> int {
     return args->help ? 0 : 1;
   }
 
-  const auto base_cfg =
-      ggb::bench::RunConfig::load(args->dataset, args->run_id);
+  auto base_cfg = ggb::bench::RunConfig::load(args->dataset, args->run_id);
   if (!base_cfg) {
     return 1;
   }
 
-  const auto run_all = (args->engine == "all");
-  if (run_all || args->engine == "in_memory") {
-    create_runner(ggb::InMemoryConfig{}, *base_cfg).run();
+  std::vector<ggb::bench::QueryApi> apis;
+  if (args->api == "all" || args->api == "vector") {
+    apis.push_back(ggb::bench::QueryApi::Vector);
+  }
+  if (args->api == "all" || args->api == "into") {
+    apis.push_back(ggb::bench::QueryApi::Into);
+  }
+  if (apis.empty()) {
+    std::cerr << "Unknown query api: " << args->api << "\n";
+    print_usage();
+    return 1;
   }
-  if (run_all || args->engine == "mmap") {
-    create_runner(ggb::FlatMmapConfig{.db_path = "test.ggb"}, *base_cfg).run();
+
+  base_cfg->workload.inflight = args->inflight;
+  base_cfg->workload.threads = args->threads;
+  base_cfg->workload.target_qps = args->target_qps;
+  base_cfg->workload.arrival = *args->arrival;
+  base_cfg->workload.executor_threads = args->executor_threads;
+  base_cfg->workload.prefetch_distance = args->prefetch_distance;
+  const ggb::ExecutorConfig executor{.num_threads = args->executor_threads};
+
+  for (const auto api : apis) {
+    base_cfg->workload.api = api;
+
+    const auto run_all = (args->engine == "all");
+    if (run_all || args->engine == "in_memory") {
+      create_runner(maybe_cached(*args,
+                                 ggb::InMemoryConfig{
+                                     .executor = executor,
+                                     .index = *args->index,
+                                     .row_order = *args->row_order,
+                                     .dtype = *args->dtype,
+                                     .gather = args->gather,
+                                     .huge_pages = *args->huge_pages}),
+                    *base_cfg)
+          .run();
+    }
+    if (run_all || args->engine == "mmap") {
+      create_runner(maybe_cached(*args,
+                                 ggb::FlatMmapConfig{
+                                     .db_path = "test.ggb",
+                                     .executor = executor,
+                                     .index = *args->index,
+                                     .row_order = *args->row_order,
+                                     .hot_cache = args->hot_cache,
+                                     .writer = args->writer,
+                                     .dtype = *args->dtype,
+                                     .gather = args->gather,
+                                     .huge_pages = *args->huge_pages,
+                                     .coalesce = coalesce_for(
+                                         *args,
+                                         ggb::FlatMmapConfig{}.coalesce)}),
+                    *base_cfg)
+          .run();
+    }
+    if (run_all || args->engine == "direct_io") {
+      create_runner(maybe_cached(*args,
+                                 ggb::DirectIoConfig{
+                                     .db_path = "test.ggb",
+                                     .executor = executor,
+                                     .index = *args->index,
+                                     .row_order = *args->row_order,
+                                     .backend = *args->io_backend,
+                                     .queue_depth = args->queue_depth,
+                                     .writer = args->writer,
+                                     .dtype = *args->dtype,
+                                     .coalesce = coalesce_for(
+                                         *args,
+                                         ggb::DirectIoConfig{}.coalesce)}),
+                    *base_cfg)
+          .run();
+    }
   }
 
   return 0;
@@ -0,0 +1,138 @@
+// Microbenchmark of the row gather kernels against the copies the engines
+// used before them: one `Value` per row, and `std::copy_n` into a batch.
+//
+// Usage: bench_gather [table_mb] [batch_rows]
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <functional>
+#include <iostream>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "common/gather.h"
+#include "ggb/core.h"
+
+namespace {
+
+using ggb::detail::GatherIsa;
+using ggb::detail::RowCopier;
+
+constexpr std::size_t num_reps = 7;
+
+struct Workload {
+  std::size_t dim{0};
+  std::vector<float> table;
+  std::vector<std::size_t> rows;  // Random rows of `table` to gather
+  std::vector<float> out;
+};
+
+// Median wall time of `fn` over `num_reps` runs, in nanoseconds
+auto median_ns(const std::function<void()>& fn) -> double {
+  std::vector<double> times;
+  fn();  // Warm up
+  for (std::size_t rep = 0; rep < num_reps; ++rep) {
+    const auto start = std::chrono::steady_clock::now();
+    fn();
+    const auto end = std::chrono::steady_clock::now();
+    times.push_back(
+        std::chrono::duration<double, std::nano>(end - start).count());
+  }
+  std::ranges::nth_element(times, times.begin() + (num_reps / 2));
+  return times[num_reps / 2];
+}
+
+auto report(const Workload& w, std::string_view name, double ns) -> void {
+  const auto bytes =
+      static_cast<double>(w.rows.size() * w.dim * sizeof(float));
+  const auto rows = static_cast<double>(w.rows.size());
+  std::cout << std::format("{:>5} {:<26} {:>10.2f} ns/row {:>8.2f} GB/s\n",
+                           w.dim, name, ns / rows, bytes / ns);
+}
+
+auto run_kernel(Workload& w, const RowCopier& copier, bool streaming,
+                std::size_t prefetch_distance) -> void {
+  const auto* table = w.table.data();
+  const auto row_bytes = w.dim * sizeof(float);
+  for (std::size_t i = 0; i < w.rows.size(); ++i) {
+    if (prefetch_distance > 0 && i + prefetch_distance < w.rows.size()) {
+      const auto ahead = w.rows[i + prefetch_distance];
+      ggb::detail::prefetch_row(table + (ahead * w.dim), row_bytes);
+    }
+    copier.copy(table + (w.rows[i] * w.dim), w.out.data() + (i * w.dim),
+                streaming);
+  }
+  if (streaming) {
+    ggb::detail::store_fence();
+  }
+}
+
+auto bench_dim(std::size_t dim, std::size_t table_bytes,
+               std::size_t batch_rows) -> void {
+  Workload w;
+  w.dim = dim;
+  const auto num_table_rows = std::max<std::size_t>(
+      1, table_bytes / (dim * sizeof(float)));
+  w.table.resize(num_table_rows * dim);
+  std::iota(w.table.begin(), w.table.end(), 0.0F);
+  std::mt19937_64 rng(42);
+  std::uniform_int_distribution<std::size_t> pick(0, num_table_rows - 1);
+  w.rows.resize(batch_rows);
+  std::ranges::generate(w.rows, [&] { return pick(rng); });
+  w.out.resize(batch_rows * dim);
+
+  // Before: `get_multi_tensor` built one vector per row
+  report(w, "vector (per row)", median_ns([&] {
+           std::vector<std::optional<ggb::Value>> results;
+           results.reserve(w.rows.size());
+           for (const auto row : w.rows) {
+             const auto* start = w.table.data() + (row * dim);
+             results.emplace_back(ggb::Value(start, start + dim));
+           }
+         }));
+
+  // Before: `get_multi_tensor_into` copied with `std::copy_n`
+  report(w, "copy_n", median_ns([&] {
+           for (std::size_t i = 0; i < w.rows.size(); ++i) {
+             std::copy_n(w.table.data() + (w.rows[i] * dim), dim,
+                         w.out.data() + (i * dim));
+           }
+         }));
+
+  for (const auto isa :
+       {GatherIsa::Scalar, GatherIsa::Avx2, GatherIsa::Avx512}) {
+    if (isa > ggb::detail::best_gather_isa()) {
+      continue;
+    }
+    const RowCopier copier(dim, isa);
+    const std::string name(copier.name());
+    report(w, name, median_ns([&] { run_kernel(w, copier, false, 0); }));
+    report(w, name + " +prefetch",
+           median_ns([&] { run_kernel(w, copier, false, 8); }));
+    report(w, name + " +prefetch +nt",
+           median_ns([&] { run_kernel(w, copier, true, 8); }));
+  }
+  std::cout << "\n";
+}
+
+}  // namespace
+
+auto main(int argc, char** argv) -> int {
+  const std::size_t table_mb = argc > 1 ? std::stoull(argv[1]) : 1024;
+  const std::size_t batch_rows = argc > 2 ? std::stoull(argv[2]) : 100'000;
+
+  std::cout << std::format(
+      "Gathering {} random rows from a {} MiB table (best ISA: {})\n\n",
+      batch_rows, table_mb, RowCopier(1).name());
+  for (const std::size_t dim : {64, 100, 128, 256, 602, 129}) {
+    bench_dim(dim, table_mb << 20, batch_rows);
+  }
+  return 0;
+}
@@ -1,9 +1,13 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <future>
 #include <iostream>
+#include <map>
 #include <memory>
 #include <optional>
 #include <span>
@@ -16,17 +20,228 @@
 
 namespace ggb {
 
+// Background worker pool that serves `*_async` lookups.
+struct ExecutorConfig {
+  // Number of worker threads. With 0, lookups run inline on the caller and
+  // the returned futures are already ready.
+  std::size_t num_threads{0};
+
+  // Give each worker its own deque and let idle workers steal from peers,
+  // instead of sharing a single FIFO queue.
+  bool work_stealing{false};
+
+  // Pin worker i to CPU (i % hardware_concurrency). Linux only.
+  bool pin_threads{false};
+};
+
+// Key -> row index used when keys do not form a dense contiguous range.
+// Dense ranges always use offset arithmetic and need no index memory.
+enum class IndexKind {
+  Hash,         // std::unordered_map
+  Eytzinger,    // Sorted key array in BFS order, branch-free search
+  PerfectHash,  // Minimal perfect hash built at `build` time
+};
+
+// Physical row layout chosen at `build` time from the graph passed to it.
+// Without a graph, rows stay in insertion order.
+enum class RowOrder {
+  Insertion,  // `put_tensor` order
+  Degree,     // Highest-degree nodes first, packing hot rows together
+  Rcm,        // Reverse Cuthill-McKee, so graph neighbours share pages
+};
+
+// Page size backing a store's rows. Random gathers over a large table miss
+// the TLB on nearly every row with 4 KiB pages; 2 MiB pages cover 512 times
+// as much memory per entry.
+enum class HugePages {
+  None,         // Regular 4 KiB pages
+  Transparent,  // 2 MiB transparent huge pages via madvise(MADV_HUGEPAGE)
+  Explicit,     // Reserved hugetlbfs pages, falling back to Transparent
+};
+
+// Pins the highest-degree rows of a FlatMmap store in RAM, in front of the
+// mapping. Rows are picked at `build` time from the graph passed to it, up to
+// whichever limit is reached first. A limit of 0 is unset; with both unset
+// the cache is disabled.
+struct HotCacheConfig {
+  std::size_t max_nodes{0};
+  std::size_t max_bytes{0};
+};
+
+// Element type rows are stored in. Lookups dequantize to fp32 unless the
+// caller asks for the stored encoding. Values are persisted in store files.
+enum class StorageDType : std::uint32_t {
+  F32 = 0,
+  F16 = 1,   // IEEE binary16
+  BF16 = 2,  // Upper half of an fp32
+  Int8 = 3,  // Symmetric per-row quantization: an fp32 scale, then the row
+};
+
+// Bytes of one row of `dim` elements. Int8 rows are padded to a multiple of
+// 4 bytes so the scale of every row stays aligned.
+[[nodiscard]] constexpr auto storage_row_bytes(StorageDType dtype,
+                                               std::size_t dim) -> std::size_t {
+  switch (dtype) {
+    case StorageDType::F32:
+      return dim * 4;
+    case StorageDType::F16:
+    case StorageDType::BF16:
+      return dim * 2;
+    case StorageDType::Int8:
+      return 4 + ((dim + 3) / 4 * 4);
+  }
+  return 0;
+}
+
+// Tuning of how lookups gather rows. `get_multi_tensor_into` copies with the
+// widest SIMD kernel the CPU supports, detected at runtime.
+struct GatherConfig {
+  // Rows ahead of the one being copied to prefetch, 0 to disable
+  std::size_t prefetch_distance{8};
+
+  // Batches of at least this many output bytes are written with
+  // non-temporal stores, so a batch larger than the cache does not evict the
+  // store's own hot data; 0 disables them
+  std::size_t streaming_min_bytes{std::size_t{32} << 20};
+
+  // Extra threads a single large batch is split across, each gathering a
+  // contiguous run of keys while the caller gathers the first. With 0, every
+  // batch is gathered on the calling thread.
+  std::size_t num_threads{0};
+
+  // Fewest keys per thread; batches of at most this many keys stay serial
+  std::size_t grain_size{4096};
+};
+
+// How file-backed stores schedule the reads of a batch: found rows are sorted
+// by file offset, rows whose 4 KiB-aligned extents touch or overlap are merged
+// into one range, and ranges are issued in file order. Rows are then
+// scattered back into request order.
+struct CoalesceConfig {
+  bool enabled{true};
+
+  // Largest merged range; a single row larger than this is read on its own
+  std::size_t max_range_bytes{std::size_t{64} << 10};
+};
+
+// How builders of file-backed stores write the file. Rows are staged in two
+// aligned buffers of `buffer_bytes`; a background thread writes one out while
+// the other fills.
+struct WriterConfig {
+  std::size_t buffer_bytes{std::size_t{8} << 20};
+  std::size_t preallocate_bytes{0};  // Expected file size to fallocate, or 0
+  bool sync{true};  // fdatasync(2) the file once the store is built
+};
+
 struct FlatMmapConfig {
   std::string db_path;
+  ExecutorConfig executor{};
+  IndexKind index{IndexKind::Eytzinger};
+  RowOrder row_order{RowOrder::Insertion};
+  HotCacheConfig hot_cache{};
+  WriterConfig writer{};
+  StorageDType dtype{StorageDType::F32};
+  GatherConfig gather{};
+
+  // Transparent advises the mapping, which takes effect where the file
+  // system supports huge pages for files (e.g. tmpfs mounted with `huge=`).
+  // Explicit requires the store to live on hugetlbfs.
+  HugePages huge_pages{HugePages::None};
+
+  // Each range is advised in with MADV_WILLNEED before any row is copied, so
+  // a cold batch has its pages in flight at once. Off by default: when the
+  // store is resident, the sort and the syscalls are pure overhead.
+  CoalesceConfig coalesce{.enabled = false};
+};
+
+// How `DirectIoConfig` engines issue their reads
+enum class IoBackend {
+  Auto,     // io_uring when built with liburing and permitted, else Pread
+  IoUring,  // io_uring only; fails to open the store otherwise
+  Pread,    // A pool of threads issuing blocking pread(2)
+};
+
+// Reads rows of a FlatMmap-format store with explicit I/O instead of page
+// faults: all misses of a batch are submitted at once, up to `queue_depth`
+// reads in flight, into an aligned buffer pool. The file is opened with
+// O_DIRECT when `direct_io` is set and the filesystem supports it.
+struct DirectIoConfig {
+  std::string db_path;
+  ExecutorConfig executor{};
+  IndexKind index{IndexKind::Eytzinger};
+  RowOrder row_order{RowOrder::Insertion};
+  IoBackend backend{IoBackend::Auto};
+  std::size_t queue_depth{128};
+  std::size_t pread_threads{16};  // Only used by the Pread backend
+  bool direct_io{true};
+  WriterConfig writer{};
+  StorageDType dtype{StorageDType::F32};
+  CoalesceConfig coalesce{};
+};
+
+struct InMemoryConfig {
+  ExecutorConfig executor{};
+  IndexKind index{IndexKind::Eytzinger};
+  RowOrder row_order{RowOrder::Insertion};
+  StorageDType dtype{StorageDType::F32};
+  GatherConfig gather{};
+
+  // Backs the rows, and the index arrays where the kernel can collapse
+  // them, with huge pages
+  HugePages huge_pages{HugePages::None};
+
+  // Rows the table is sized for at the first insert, if known up front; 0
+  // starts small and grows. The `io::ingest_features*` readers reserve the
+  // row count of their file themselves.
+  std::size_t expected_rows{0};
 };
 
-struct InMemoryConfig {};
+using BaseEngineConfig =
+    std::variant<FlatMmapConfig, InMemoryConfig, DirectIoConfig>;
 
-using EngineConfig = std::variant<FlatMmapConfig, InMemoryConfig>;
+// Replacement policy of the row cache in front of a `CachedConfig` engine
+enum class CachePolicy {
+  Clock,   // One reference bit per row, second-chance sweep
+  S3Fifo,  // Small probationary FIFO, main FIFO and a ghost list of keys
+  Lru,     // Exact recency order
+};
+
+// Wraps another engine with a row-granular cache of `capacity_bytes`, split
+// into `num_shards` independently locked shards. Lookups run on `executor`;
+// the wrapped engine is only called synchronously for cache misses.
+struct CachedConfig {
+  BaseEngineConfig base;
+  std::size_t capacity_bytes{256UL * 1024 * 1024};
+  CachePolicy policy{CachePolicy::S3Fifo};
+  std::size_t num_shards{16};
+  ExecutorConfig executor{};
+};
+
+using EngineConfig = std::variant<FlatMmapConfig, InMemoryConfig,
+                                  DirectIoConfig, CachedConfig>;
 
 using NodeID = std::uint64_t;
 using Value = std::vector<float>;
 
+// Named monotonic event counts reported by an engine, e.g. cache hits
+using Counters = std::map<std::string, std::uint64_t>;
+
+// Time spent in one stage of lookups, one sample per timed section
+struct StageTimes {
+  static constexpr std::size_t num_buckets = 64;
+
+  std::uint64_t count{0};
+  std::uint64_t total_ns{0};
+  // buckets[i] counts samples of [2^i, 2^(i+1)) ns; bucket 0 also holds 0 ns
+  std::array<std::uint64_t, num_buckets> buckets{};
+};
+
+// Counters plus per-stage lookup timings, see `FeatureStore::get_metrics`
+struct Metrics {
+  Counters counters;
+  std::map<std::string, StageTimes> stages;
+};
+
 struct Key {
   // TODO(kuba) For now, we only support homogenous node keys
   std::uint64_t NodeID;
@@ -53,18 +268,132 @@ class FeatureStore {
  public:
   virtual ~FeatureStore() = default;
 
+  // Maps a store previously written by a FlatMmap builder without rebuilding
+  // it. The index and dtype are loaded from the file, so `cfg.index` and
+  // `cfg.dtype` are ignored. Throws `std::runtime_error` if the file is
+  // missing, truncated or not a store.
+  [[nodiscard]] static auto open(const FlatMmapConfig &cfg)
+      -> std::unique_ptr<FeatureStore>;
+  [[nodiscard]] static auto open(const std::string &path)
+      -> std::unique_ptr<FeatureStore>;
+
   [[nodiscard]] virtual auto name() const -> std::string_view = 0;
   [[nodiscard]] virtual auto get_num_keys() const -> std::size_t = 0;
   [[nodiscard]] virtual auto get_tensor_size() const
       -> std::optional<std::size_t> = 0;
+  [[nodiscard]] virtual auto get_index_memory_bytes() const
+      -> std::size_t = 0;
+
+  [[nodiscard]] virtual auto get_storage_dtype() const -> StorageDType {
+    return StorageDType::F32;
+  }
+
+  // Bytes of one row as stored, see `storage_row_bytes`
+  [[nodiscard]] auto get_storage_row_bytes() const -> std::size_t {
+    return storage_row_bytes(get_storage_dtype(),
+                             get_tensor_size().value_or(0));
+  }
+
+  // Counts since construction. Engines that track nothing return none.
+  [[nodiscard]] virtual auto get_counters() const -> Counters { return {}; }
+
+  // `get_counters` plus what the lookups themselves record since
+  // construction: keys requested and missing, bytes copied, and the time
+  // spent resolving keys, copying rows and waiting on reads. Only counters
+  // when the library is built without GGB_WITH_METRICS.
+  [[nodiscard]] virtual auto get_metrics() const -> Metrics {
+    return {.counters = get_counters(), .stages = {}};
+  }
+
+  // Positions in `keys` that are absent from the store, in ascending order.
+  // Only consults the index and never touches feature data.
+  [[nodiscard]] virtual auto get_missing_keys(std::span<const Key> keys) const
+      -> std::vector<std::size_t> = 0;
 
   [[nodiscard]] virtual auto get_multi_tensor_async(std::span<const Key> keys)
       const -> std::future<std::vector<std::optional<Value>>> = 0;
 
+  // Hints that `keys` will be looked up soon, e.g. the batch a sampler has
+  // already drawn for a later step. Returns without waiting for any data:
+  // engines warm it on their executor's workers and ignore the hint when
+  // the executor has none, as do engines with nothing to warm.
+  virtual auto prefetch([[maybe_unused]] std::span<const Key> keys) const
+      -> void {}
+
   [[nodiscard]] auto get_multi_tensor(std::span<const Key> keys) const
       -> std::vector<std::optional<Value>> {
     return get_multi_tensor_async(keys).get();
   }
+
+  // Gathers the rows of `keys` into `out`, a caller-owned row-major buffer of
+  // at least `keys.size() * get_tensor_size()` floats. Rows of missing keys
+  // are zero-filled and their positions in `keys` are returned in ascending
+  // order, so a fully hit batch performs no heap allocation.
+  [[nodiscard]] auto get_multi_tensor_into(std::span<const Key> keys,
+                                           std::span<float> out) const
+      -> std::vector<std::size_t> {
+    check_output_size(keys.size(), out.size());
+    return get_multi_tensor_into_impl(keys, out);
+  }
+
+  // Asynchronous `get_multi_tensor_into`. The keys are copied, but `out` must
+  // stay valid and untouched until the returned future is ready.
+  [[nodiscard]] auto get_multi_tensor_into_async(std::span<const Key> keys,
+                                                 std::span<float> out) const
+      -> std::future<std::vector<std::size_t>> {
+    check_output_size(keys.size(), out.size());
+    return get_multi_tensor_into_async_impl(keys, out);
+  }
+
+  // Like `get_multi_tensor_into`, but copies rows in their stored encoding
+  // without dequantizing. `out` holds at least `keys.size() *
+  // get_storage_row_bytes()` bytes; rows of missing keys are zero bytes.
+  [[nodiscard]] auto get_multi_tensor_native_into(std::span<const Key> keys,
+                                                  std::span<std::byte> out)
+      const -> std::vector<std::size_t> {
+    const auto required = keys.size() * get_storage_row_bytes();
+    if (out.size() < required) {
+      throw std::runtime_error(
+          "GGB Error: output buffer too small for "
+          "`get_multi_tensor_native_into`. Expected at least " +
+          std::to_string(required) + " bytes, got " +
+          std::to_string(out.size()) + ".");
+    }
+    return get_multi_tensor_native_into_impl(keys, out);
+  }
+
+ protected:
+  [[nodiscard]] virtual auto get_multi_tensor_into_impl(
+      std::span<const Key> keys, std::span<float> out) const
+      -> std::vector<std::size_t> = 0;
+
+  [[nodiscard]] virtual auto get_multi_tensor_into_async_impl(
+      std::span<const Key> keys, std::span<float> out) const
+      -> std::future<std::vector<std::size_t>> = 0;
+
+  // Engines that store a reduced dtype override this; by default rows are
+  // gathered as fp32, which is then the stored encoding
+  [[nodiscard]] virtual auto get_multi_tensor_native_into_impl(
+      std::span<const Key> keys, std::span<std::byte> out) const
+      -> std::vector<std::size_t> {
+    std::vector<float> rows(keys.size() * get_tensor_size().value_or(0));
+    auto missing = get_multi_tensor_into_impl(keys, rows);
+    std::memcpy(out.data(), rows.data(), rows.size() * sizeof(float));
+    return missing;
+  }
+
+ private:
+  auto check_output_size(std::size_t num_keys, std::size_t out_size) const
+      -> void {
+    const auto required = num_keys * get_tensor_size().value_or(0);
+    if (out_size < required) {
+      throw std::runtime_error(
+          "GGB Error: output buffer too small for `get_multi_tensor_into`. "
+          "Expected at least " +
+          std::to_string(required) + " floats, got " +
+          std::to_string(out_size) + ".");
+    }
+  }
 };
 
 class FeatureStoreBuilder {
@@ -81,6 +410,51 @@ class FeatureStoreBuilder {
     return put_tensor_impl(key, std::move(tensor));
   }
 
+  // Inserts `keys.size()` rows of `dim` floats stored back to back in `rows`.
+  // Returns false if the shapes disagree or any row was rejected.
+  auto put_tensors(std::span<const Key> keys, std::span<const float> rows,
+                   std::size_t dim) -> bool {
+    check_not_built();
+    if (rows.size() != keys.size() * dim) {
+      return false;
+    }
+    return put_tensors_impl(keys, rows, dim);
+  }
+
+  // Inserts a dense row-major matrix of `dim` columns as nodes `first_id`,
+  // `first_id + 1`, ... Returns false if `rows` is not a whole number of rows
+  // or any row was rejected.
+  auto put_matrix(NodeID first_id, std::span<const float> rows,
+                  std::size_t dim) -> bool {
+    check_not_built();
+    if (dim == 0 || rows.size() % dim != 0) {
+      return false;
+    }
+    // Batches bound the key buffer, which would otherwise rival the matrix
+    constexpr std::size_t batch_rows = std::size_t{1} << 16;
+    const auto num_rows = rows.size() / dim;
+    std::vector<Key> keys;
+    bool all_accepted = true;
+    for (std::size_t first = 0; first < num_rows; first += batch_rows) {
+      const auto n = std::min(batch_rows, num_rows - first);
+      keys.resize(n);
+      for (std::size_t i = 0; i < n; ++i) {
+        keys[i] = {.NodeID = first_id + first + i};
+      }
+      all_accepted &= put_tensors_impl(keys, rows.subspan(first * dim, n * dim),
+                                       dim);
+    }
+    return all_accepted;
+  }
+
+  // Hints that about `num_rows` rows of `dim` floats are coming, so the
+  // builder can size its storage once instead of growing it. Inserting more
+  // or fewer rows is still fine.
+  auto reserve(std::size_t num_rows, std::size_t dim) -> void {
+    check_not_built();
+    reserve_impl(num_rows, dim);
+  }
+
   auto build(std::optional<GraphTopology> graph = std::nullopt)
       -> std::unique_ptr<FeatureStore> {
     check_not_built();
@@ -91,6 +465,20 @@ class FeatureStoreBuilder {
  protected:
   virtual auto put_tensor_impl(const Key &key, const Value &tensor) -> bool = 0;
   virtual auto put_tensor_impl(const Key &key, Value &&tensor) -> bool = 0;
+  // Engines override this to insert a whole batch at once; by default every
+  // row is inserted on its own
+  virtual auto put_tensors_impl(std::span<const Key> keys,
+                                std::span<const float> rows, std::size_t dim)
+      -> bool {
+    bool all_accepted = true;
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+      const auto row = rows.subspan(i * dim, dim);
+      all_accepted &= put_tensor_impl(keys[i], Value(row.begin(), row.end()));
+    }
+    return all_accepted;
+  }
+  virtual auto reserve_impl([[maybe_unused]] std::size_t num_rows,
+                            [[maybe_unused]] std::size_t dim) -> void {}
   virtual auto build_impl(std::optional<GraphTopology> graph = std::nullopt)
       -> std::unique_ptr<FeatureStore> = 0;
 
@@ -14,7 +14,29 @@ print_usage() {
     echo "  run_id       ID of the query run (e.g., run-0001)"
     echo
     echo "Options:"
-    echo "  --engine     mmap | in_memory | all (default: all)"
+    echo "  --engine     mmap | in_memory | direct_io | all (default: all)"
+    echo "  --api        vector | into | all (default: vector)"
+    echo "  --inflight   Async batches kept in flight (default: 1)"
+    echo "  --threads    Client threads sharing the store, measured at 1, 2, 4, ... up to N after a warm-up pass (default: 1)"
+    echo "  --target-qps Open loop: send queries at this rate and report corrected latency (default: 0, off)"
+    echo "  --arrival    fixed | poisson, open-loop send times (default: fixed)"
+    echo "  --executor-threads  Engine worker threads (default: 0, inline)"
+    echo "  --prefetch-distance Prefetch batch i+D while batch i is served, needs --executor-threads (default: 0)"
+    echo "  --index      hash | eytzinger | perfect_hash (default: eytzinger)"
+    echo "  --row-order  insertion | degree | rcm (default: insertion)"
+    echo "  --hot-cache-nodes  Pin the top-K nodes by degree in RAM (mmap only)"
+    echo "  --hot-cache-mb     Byte budget for pinned rows in MiB (mmap only)"
+    echo "  --cache-mb         Wrap engines in a row cache of this many MiB (default: 0, off)"
+    echo "  --cache-policy     clock | s3fifo | lru (default: s3fifo)"
+    echo "  --io-backend       auto | io_uring | pread, read path of direct_io (default: auto)"
+    echo "  --queue-depth      Reads in flight per direct_io batch (default: 128)"
+    echo "  --writer-buffer-mb Build staging buffer size in MiB, the store file itself is preallocated (default: 8)"
+    echo "  --no-sync          Skip fdatasync of the store file after build (mmap and direct_io)"
+    echo "  --dtype            f32 | f16 | bf16 | int8, element type rows are stored in (default: f32)"
+    echo "  --gather-threads   Extra threads splitting one large batch (default: 0, serial)"
+    echo "  --grain-size       Fewest keys per gather thread (default: 4096)"
+    echo "  --coalesce-kb      Merge touching rows into reads of up to this many KiB, 0 to disable (default: mmap 0, direct_io 64)"
+    echo "  --huge-pages       none | thp | hugetlb, page size backing in_memory rows and the mmap mapping (default: none)"
     echo "  --help       Show this message"
 
     echo "Environment:"
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <span>
+#include <vector>
+
+namespace ggb::detail {
+
+// Fixed set of equally sized, `alignment`-aligned blocks carved out of one
+// allocation, as required for O_DIRECT reads. Callers take as many blocks as
+// are free (at least one, waiting if necessary) so concurrent batches never
+// deadlock holding partial sets.
+class AlignedBufferPool {
+ public:
+  AlignedBufferPool(std::size_t block_bytes, std::size_t num_blocks,
+                    std::size_t alignment)
+      : block_bytes_(round_up(block_bytes, alignment)),
+        storage_(allocate(block_bytes_ * num_blocks, alignment)) {
+    free_.reserve(num_blocks);
+    for (std::size_t i = 0; i < num_blocks; ++i) {
+      free_.push_back(storage_.get() + (i * block_bytes_));
+    }
+  }
+
+  // Moves up to `max_blocks` free blocks into `out` and returns how many
+  [[nodiscard]] auto acquire(std::size_t max_blocks,
+                             std::vector<std::byte*>& out) -> std::size_t {
+    std::unique_lock lock(mutex_);
+    available_.wait(lock, [this] { return !free_.empty(); });
+    const auto n = std::min(max_blocks, free_.size());
+    out.insert(out.end(), free_.end() - static_cast<std::ptrdiff_t>(n),
+               free_.end());
+    free_.resize(free_.size() - n);
+    return n;
+  }
+
+  auto release(std::span<std::byte* const> blocks) -> void {
+    {
+      const std::lock_guard lock(mutex_);
+      free_.insert(free_.end(), blocks.begin(), blocks.end());
+    }
+    available_.notify_all();
+  }
+
+  [[nodiscard]] auto block_bytes() const -> std::size_t { return block_bytes_; }
+
+  static constexpr auto round_up(std::size_t value, std::size_t alignment)
+      -> std::size_t {
+    return (value + alignment - 1) / alignment * alignment;
+  }
+
+ private:
+  struct FreeDeleter {
+    auto operator()(std::byte* ptr) const -> void { std::free(ptr); }
+  };
+
+  static auto allocate(std::size_t bytes, std::size_t alignment)
+      -> std::unique_ptr<std::byte[], FreeDeleter> {
+    auto* ptr = static_cast<std::byte*>(
+        std::aligned_alloc(alignment, std::max(bytes, alignment)));
+    if (ptr == nullptr) {
+      throw std::bad_alloc();
+    }
+    return std::unique_ptr<std::byte[], FreeDeleter>(ptr);
+  }
+
+  const std::size_t block_bytes_;
+  std::unique_ptr<std::byte[], FreeDeleter> storage_;
+
+  std::mutex mutex_;
+  std::condition_variable available_;
+  std::vector<std::byte*> free_;
+};
+
+}  // namespace ggb::detail
@@ -0,0 +1,265 @@
+#pragma once
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include "common/logging.h"
+#include "ggb/core.h"
+
+namespace ggb::detail {
+
+// Append-only file writer with double buffering. `write` copies into the
+// active staging buffer; a full buffer is handed to a background thread that
+// pwrite(2)s it while the caller fills the other one, so the caller only
+// blocks when the disk falls a whole buffer behind.
+//
+// I/O errors are sticky: once one happens further writes are dropped, `ok`
+// returns false and `close` throws.
+class BufferedWriter {
+ public:
+  BufferedWriter(std::string path, const WriterConfig& cfg)
+      : path_(std::move(path)),
+        cfg_(cfg),
+        capacity_(round_up(std::max<std::size_t>(cfg.buffer_bytes, 1),
+                           buffer_alignment)),
+        storage_(allocate(2 * capacity_)) {
+    fd_ = ::open(path_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ == -1) {
+      GGB_LOG_ERROR("Failed to open file for writing: {} (errno: {})", path_,
+                    errno);
+      error_ = errno;
+      return;
+    }
+    if (cfg_.preallocate_bytes > 0) {
+      preallocate(cfg_.preallocate_bytes);
+    }
+    thread_ = std::thread([this] { write_loop(); });
+  }
+
+  ~BufferedWriter() {
+    stop();
+    if (fd_ != -1) {
+      ::close(fd_);
+    }
+  }
+
+  BufferedWriter(const BufferedWriter&) = delete;
+  auto operator=(const BufferedWriter&) -> BufferedWriter& = delete;
+
+  auto write(const void* data, std::size_t num_bytes) -> void {
+    const auto* src = static_cast<const std::byte*>(data);
+    size_ += num_bytes;
+    while (num_bytes > 0) {
+      const auto n = std::min(num_bytes, capacity_ - fill_);
+      std::memcpy(buffer(active_) + fill_, src, n);
+      fill_ += n;
+      src += n;
+      num_bytes -= n;
+      if (fill_ == capacity_) {
+        submit();
+      }
+    }
+  }
+
+  // Overwrites bytes that were already appended, e.g. a header placeholder
+  auto write_at(std::uint64_t offset, const void* data, std::size_t num_bytes)
+      -> void {
+    drain();
+    if (ok() && !pwrite_full(static_cast<const std::byte*>(data), num_bytes,
+                             offset)) {
+      fail(errno);
+    }
+  }
+
+  // Makes everything appended so far visible to readers of the file
+  auto flush() -> void { drain(); }
+
+  // Flushes, optionally syncs and closes the file. Throws
+  // `std::runtime_error` if any write failed.
+  auto close() -> void {
+    drain();
+    stop();
+    if (fd_ != -1) {
+      // Gives back the blocks `preallocate` reserved past what was written
+      if (ok() && ::ftruncate(fd_, static_cast<off_t>(size_)) == -1) {
+        fail(errno);
+      }
+      if (ok() && cfg_.sync && ::fdatasync(fd_) == -1) {
+        fail(errno);
+      }
+      ::close(fd_);
+      fd_ = -1;
+    }
+    if (!ok()) {
+      GGB_LOG_ERROR("Failed to write {} (errno: {})", path_, error_.load());
+      throw std::runtime_error("BufferedWriter: write failed");
+    }
+  }
+
+  // Reserves disk blocks for the first `bytes` of the file so appends do
+  // not allocate as they go. Best effort, the file size is left as is.
+  auto preallocate(std::size_t bytes) -> void {
+    if (fd_ == -1) {
+      return;
+    }
+#ifdef __linux__
+    // Keep the size at 0 so a crash does not leave a zero-filled tail
+    if (::fallocate(fd_, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(bytes)) ==
+        0) {
+      return;
+    }
+#endif
+    GGB_LOG_WARN("Could not preallocate {} bytes for {} (errno: {})", bytes,
+                 path_, errno);
+  }
+
+  [[nodiscard]] auto ok() const -> bool { return error_.load() == 0; }
+
+  // Bytes appended so far
+  [[nodiscard]] auto size() const -> std::uint64_t { return size_; }
+
+ private:
+  static constexpr std::size_t buffer_alignment = 4096;
+
+  struct FreeDeleter {
+    auto operator()(std::byte* ptr) const -> void { std::free(ptr); }
+  };
+
+  static constexpr auto round_up(std::size_t value, std::size_t alignment)
+      -> std::size_t {
+    return (value + alignment - 1) / alignment * alignment;
+  }
+
+  static auto allocate(std::size_t bytes)
+      -> std::unique_ptr<std::byte[], FreeDeleter> {
+    auto* ptr =
+        static_cast<std::byte*>(std::aligned_alloc(buffer_alignment, bytes));
+    if (ptr == nullptr) {
+      throw std::bad_alloc();
+    }
+    return std::unique_ptr<std::byte[], FreeDeleter>(ptr);
+  }
+
+  auto buffer(int which) -> std::byte* {
+    return storage_.get() + (static_cast<std::size_t>(which) * capacity_);
+  }
+
+  auto fail(int err) -> void {
+    int expected = 0;
+    error_.compare_exchange_strong(expected, err == 0 ? EIO : err);
+  }
+
+  auto pwrite_full(const std::byte* data, std::size_t num_bytes,
+                   std::uint64_t offset) const -> bool {
+    while (num_bytes > 0) {
+      const auto n = ::pwrite(fd_, data, num_bytes, static_cast<off_t>(offset));
+      if (n < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        return false;
+      }
+      data += n;
+      num_bytes -= static_cast<std::size_t>(n);
+      offset += static_cast<std::uint64_t>(n);
+    }
+    return true;
+  }
+
+  // Hands the active buffer to the writer thread once it finished the other
+  auto submit() -> void {
+    if (fill_ == 0) {
+      return;
+    }
+    std::unique_lock lock(mutex_);
+    idle_.wait(lock, [this] { return pending_bytes_ == 0; });
+    if (ok() && fd_ != -1) {
+      pending_ = buffer(active_);
+      pending_bytes_ = fill_;
+      pending_offset_ = file_offset_;
+      ready_.notify_one();
+    }
+    file_offset_ += fill_;
+    active_ ^= 1;
+    fill_ = 0;
+  }
+
+  auto drain() -> void {
+    submit();
+    std::unique_lock lock(mutex_);
+    idle_.wait(lock, [this] { return pending_bytes_ == 0; });
+  }
+
+  auto stop() -> void {
+    if (!thread_.joinable()) {
+      return;
+    }
+    {
+      const std::lock_guard lock(mutex_);
+      stopping_ = true;
+    }
+    ready_.notify_one();
+    thread_.join();
+  }
+
+  auto write_loop() -> void {
+    std::unique_lock lock(mutex_);
+    while (true) {
+      ready_.wait(lock, [this] { return stopping_ || pending_bytes_ > 0; });
+      if (pending_bytes_ == 0) {
+        return;  // Stopping with nothing left to write
+      }
+      const auto* data = pending_;
+      const auto num_bytes = pending_bytes_;
+      const auto offset = pending_offset_;
+      lock.unlock();
+      if (!pwrite_full(data, num_bytes, offset)) {
+        fail(errno);
+      }
+      lock.lock();
+      pending_bytes_ = 0;
+      idle_.notify_all();
+    }
+  }
+
+  const std::string path_;
+  const WriterConfig cfg_;
+  const std::size_t capacity_;
+  std::unique_ptr<std::byte[], FreeDeleter> storage_;
+  int fd_{-1};
+  std::atomic<int> error_{0};
+
+  // Caller side
+  int active_{0};
+  std::size_t fill_{0};
+  std::uint64_t size_{0};
+  std::uint64_t file_offset_{0};
+
+  // Shared with the writer thread
+  std::mutex mutex_;
+  std::condition_variable ready_;
+  std::condition_variable idle_;
+  const std::byte* pending_{nullptr};
+  std::size_t pending_bytes_{0};
+  std::uint64_t pending_offset_{0};
+  bool stopping_{false};
+  std::thread thread_;
+};
+
+}  // namespace ggb::detail
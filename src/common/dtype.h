@@ -0,0 +1,167 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+#include "ggb/core.h"
+
+namespace ggb::detail {
+
+// IEEE 754 binary16 to binary32, exact for every input including
+// subnormals, infinities and NaN payloads. Branch-free so decode loops
+// vectorize.
+[[nodiscard]] constexpr auto half_to_float(std::uint16_t h) -> float {
+  const std::uint32_t sign = static_cast<std::uint32_t>(h & 0x8000U) << 16;
+  const std::uint32_t bits = static_cast<std::uint32_t>(h & 0x7FFFU) << 13;
+  const std::uint32_t exponent = bits & 0x0F800000U;
+
+  // Rebias normals; Inf / NaN move on to the maximum fp32 exponent
+  std::uint32_t magnitude = bits + 0x38000000U;
+  magnitude = exponent == 0x0F800000U ? magnitude + 0x38000000U : magnitude;
+
+  // Subnormals: 2^-14 * (1 + m / 1024) - 2^-14 is exactly m * 2^-24
+  const float subnormal = std::bit_cast<float>(bits + 0x38800000U) -
+                          std::bit_cast<float>(0x38800000U);
+  magnitude =
+      exponent == 0 ? std::bit_cast<std::uint32_t>(subnormal) : magnitude;
+  return std::bit_cast<float>(sign | magnitude);
+}
+
+// IEEE 754 binary32 to binary16, rounding to nearest even
+[[nodiscard]] constexpr auto float_to_half(float f) -> std::uint16_t {
+  const auto bits = std::bit_cast<std::uint32_t>(f);
+  const auto sign = static_cast<std::uint16_t>((bits >> 16) & 0x8000U);
+  const std::uint32_t abs = bits & 0x7FFFFFFFU;
+
+  if (abs >= 0x7F800000U) {  // Inf / NaN, keeping NaNs quiet
+    const std::uint32_t nan = abs > 0x7F800000U ? 0x200U | (abs >> 13) : 0U;
+    return static_cast<std::uint16_t>(sign | 0x7C00U | (nan & 0x3FFU));
+  }
+  if (abs >= 0x477FF000U) {  // At least 65520, which rounds to Inf
+    return static_cast<std::uint16_t>(sign | 0x7C00U);
+  }
+
+  std::uint32_t half = 0;
+  std::uint32_t rem = 0;
+  std::uint32_t halfway = 0;
+  if (abs < 0x38800000U) {  // Below 2^-14: subnormal or zero
+    const std::uint32_t exponent = abs >> 23;
+    if (exponent < 102) {  // Below half the smallest subnormal
+      return sign;
+    }
+    // Count units of 2^-24
+    const std::uint32_t shift = 126 - exponent;
+    const std::uint32_t mantissa = (abs & 0x7FFFFFU) | 0x800000U;
+    half = mantissa >> shift;
+    rem = mantissa & ((1U << shift) - 1);
+    halfway = 1U << (shift - 1);
+  } else {
+    half = (abs - 0x38000000U) >> 13;
+    rem = abs & 0x1FFFU;
+    halfway = 0x1000U;
+  }
+  // A carry out of the mantissa correctly bumps the exponent
+  if (rem > halfway || (rem == halfway && (half & 1U) != 0)) {
+    ++half;
+  }
+  return static_cast<std::uint16_t>(sign | half);
+}
+
+[[nodiscard]] constexpr auto bfloat16_to_float(std::uint16_t b) -> float {
+  return std::bit_cast<float>(static_cast<std::uint32_t>(b) << 16);
+}
+
+// Truncates the fp32 mantissa to 7 bits, rounding to nearest even
+[[nodiscard]] constexpr auto float_to_bfloat16(float f) -> std::uint16_t {
+  const auto bits = std::bit_cast<std::uint32_t>(f);
+  if ((bits & 0x7FFFFFFFU) > 0x7F800000U) {  // NaN, keep it quiet
+    return static_cast<std::uint16_t>((bits >> 16) | 0x40U);
+  }
+  const std::uint32_t rounding = 0x7FFFU + ((bits >> 16) & 1U);
+  return static_cast<std::uint16_t>((bits + rounding) >> 16);
+}
+
+// Writes `src` to `dst` as one row of `dtype`, `storage_row_bytes` long.
+// Int8 rows scale by max|x| / 127, so the largest magnitude is exact.
+inline auto encode_row(StorageDType dtype, std::span<const float> src,
+                       std::byte* dst) -> void {
+  switch (dtype) {
+    case StorageDType::F32:
+      std::memcpy(dst, src.data(), src.size_bytes());
+      return;
+    case StorageDType::F16:
+      for (std::size_t i = 0; i < src.size(); ++i) {
+        const auto h = float_to_half(src[i]);
+        std::memcpy(dst + (i * sizeof(h)), &h, sizeof(h));
+      }
+      return;
+    case StorageDType::BF16:
+      for (std::size_t i = 0; i < src.size(); ++i) {
+        const auto b = float_to_bfloat16(src[i]);
+        std::memcpy(dst + (i * sizeof(b)), &b, sizeof(b));
+      }
+      return;
+    case StorageDType::Int8: {
+      float max_abs = 0.0F;
+      for (const auto x : src) {
+        max_abs = std::max(max_abs, std::abs(x));
+      }
+      const float scale = max_abs / 127.0F;
+      const float inv_scale = scale == 0.0F ? 0.0F : 1.0F / scale;
+      std::memcpy(dst, &scale, sizeof(scale));
+      auto* q = reinterpret_cast<std::int8_t*>(dst + sizeof(scale));
+      for (std::size_t i = 0; i < src.size(); ++i) {
+        q[i] = static_cast<std::int8_t>(
+            std::clamp(std::nearbyint(src[i] * inv_scale), -127.0F, 127.0F));
+      }
+      // Zero the padding so files are deterministic
+      std::fill(dst + sizeof(scale) + src.size(),
+                dst + storage_row_bytes(dtype, src.size()), std::byte{0});
+      return;
+    }
+  }
+}
+
+// Expands one row of `dim` `dtype` elements at `src` to fp32. `src` must be
+// 2-byte aligned for F16/BF16 rows and 4-byte aligned for F32/Int8 rows,
+// which every row of a store is; F16/BF16 rows are not padded, so with an
+// odd `dim` they start at 2-byte offsets. The loops are kept simple and
+// branch-free so the compiler vectorizes them.
+inline auto decode_row(StorageDType dtype, const std::byte* src,
+                       std::size_t dim, float* __restrict dst) -> void {
+  switch (dtype) {
+    case StorageDType::F32:
+      std::memcpy(dst, src, dim * sizeof(float));
+      return;
+    case StorageDType::F16: {
+      const auto* h = reinterpret_cast<const std::uint16_t*>(src);
+      for (std::size_t i = 0; i < dim; ++i) {
+        dst[i] = half_to_float(h[i]);
+      }
+      return;
+    }
+    case StorageDType::BF16: {
+      const auto* b = reinterpret_cast<const std::uint16_t*>(src);
+      for (std::size_t i = 0; i < dim; ++i) {
+        dst[i] = bfloat16_to_float(b[i]);
+      }
+      return;
+    }
+    case StorageDType::Int8: {
+      float scale = 0.0F;
+      std::memcpy(&scale, src, sizeof(scale));
+      const auto* q = reinterpret_cast<const std::int8_t*>(src + sizeof(scale));
+      for (std::size_t i = 0; i < dim; ++i) {
+        dst[i] = static_cast<float>(q[i]) * scale;
+      }
+      return;
+    }
+  }
+}
+
+}  // namespace ggb::detail
@@ -0,0 +1,313 @@
+#pragma once
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "common/logging.h"
+#include "ggb/core.h"
+
+namespace ggb::detail {
+
+// Fixed-size worker pool that runs batch lookups in the background.
+//
+// Without work stealing, all workers share a single FIFO queue. With work
+// stealing, each worker owns a deque: tasks submitted from a worker go to its
+// own deque (popped LIFO for locality), external submissions are spread
+// round-robin, and idle workers steal FIFO from their peers.
+//
+// An executor with zero threads runs every task inline on the caller and
+// hands back an already-ready future.
+class Executor {
+ public:
+  explicit Executor(const ExecutorConfig& cfg) : cfg_(cfg) {
+    const auto num_queues = cfg_.work_stealing ? cfg_.num_threads : 1;
+    for (std::size_t i = 0; i < num_queues; ++i) {
+      queues_.push_back(std::make_unique<WorkerQueue>());
+    }
+
+    workers_.reserve(cfg_.num_threads);
+    for (std::size_t i = 0; i < cfg_.num_threads; ++i) {
+      workers_.emplace_back([this, i] { worker_loop(i); });
+      if (cfg_.pin_threads) {
+        pin_to_cpu(workers_.back(), i);
+      }
+    }
+    if (cfg_.num_threads > 0) {
+      GGB_LOG_DEBUG("Started executor with {} workers (stealing: {})",
+                    cfg_.num_threads, cfg_.work_stealing);
+    }
+  }
+
+  // Drains all queued tasks before joining the workers
+  ~Executor() {
+    {
+      const std::lock_guard lock(sleep_mutex_);
+      stop_ = true;
+    }
+    sleep_cv_.notify_all();
+    for (auto& worker : workers_) {
+      worker.join();
+    }
+  }
+
+  Executor(const Executor&) = delete;
+  auto operator=(const Executor&) -> Executor& = delete;
+  Executor(Executor&&) = delete;
+  auto operator=(Executor&&) -> Executor& = delete;
+
+  template <typename F>
+  [[nodiscard]] auto submit(F&& fn) -> std::future<std::invoke_result_t<F&>> {
+    using R = std::invoke_result_t<F&>;
+
+    if (workers_.empty()) {
+      std::packaged_task<R()> task(std::forward<F>(fn));
+      auto future = task.get_future();
+      task();
+      return future;
+    }
+
+    // std::function requires copyable targets, packaged_task is move-only
+    auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(fn));
+    auto future = task->get_future();
+    push([task = std::move(task)] { (*task)(); });
+    return future;
+  }
+
+  // Queues `fn` for a worker without handing back a future, for hints the
+  // caller never waits on. Without workers `fn` is dropped, as running it
+  // inline would block the caller, and false is returned; the first drop
+  // is logged.
+  template <typename F>
+  auto post(F&& fn) -> bool {
+    if (workers_.empty()) {
+      if (!warned_no_workers_.exchange(true, std::memory_order_relaxed)) {
+        GGB_LOG_WARN(
+            "Executor has no workers, dropping background work; set "
+            "ExecutorConfig::num_threads to run it");
+      }
+      return false;
+    }
+    [[maybe_unused]] auto pending = submit(std::forward<F>(fn));
+    return true;
+  }
+
+  [[nodiscard]] auto num_threads() const -> std::size_t {
+    return workers_.size();
+  }
+
+ private:
+  using Task = std::function<void()>;
+
+  struct WorkerQueue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  static constexpr std::size_t not_a_worker = static_cast<std::size_t>(-1);
+
+  // Index of the calling worker within its owning executor, if any
+  static auto current_worker() -> std::pair<const Executor*, std::size_t>& {
+    thread_local std::pair<const Executor*, std::size_t> worker{nullptr,
+                                                               not_a_worker};
+    return worker;
+  }
+
+  // Only touches `sleep_mutex_` when a worker is asleep. The count is raised
+  // after the task is queued, so a woken worker always finds it; pairing it
+  // with `sleeping_` (both seq_cst) means either the pusher sees the sleeper
+  // or the sleeper sees the count, and taking the mutex before notifying
+  // waits out a sleeper that checked the count but is not yet waiting.
+  auto push(Task task) -> void {
+    auto& queue = *queues_[pick_queue()];
+    {
+      const std::lock_guard lock(queue.mutex);
+      queue.tasks.push_back(std::move(task));
+    }
+    pending_.fetch_add(1);
+    if (sleeping_.load() > 0) {
+      { const std::lock_guard lock(sleep_mutex_); }
+      sleep_cv_.notify_one();
+    }
+  }
+
+  auto pick_queue() -> std::size_t {
+    if (queues_.size() == 1) {
+      return 0;
+    }
+    const auto [owner, idx] = current_worker();
+    if (owner == this) {
+      return idx;
+    }
+    return next_queue_.fetch_add(1, std::memory_order_relaxed) %
+           queues_.size();
+  }
+
+  auto try_pop(std::size_t worker_idx, Task& out) -> bool {
+    if (queues_.size() == 1) {
+      return pop_front(*queues_.front(), out);
+    }
+
+    // Own deque LIFO, then steal FIFO from peers
+    {
+      auto& own = *queues_[worker_idx];
+      const std::lock_guard lock(own.mutex);
+      if (!own.tasks.empty()) {
+        out = std::move(own.tasks.back());
+        own.tasks.pop_back();
+        return true;
+      }
+    }
+    for (std::size_t i = 1; i < queues_.size(); ++i) {
+      if (pop_front(*queues_[(worker_idx + i) % queues_.size()], out)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  static auto pop_front(WorkerQueue& queue, Task& out) -> bool {
+    const std::lock_guard lock(queue.mutex);
+    if (queue.tasks.empty()) {
+      return false;
+    }
+    out = std::move(queue.tasks.front());
+    queue.tasks.pop_front();
+    return true;
+  }
+
+  auto worker_loop(std::size_t worker_idx) -> void {
+    current_worker() = {this, worker_idx};
+
+    while (true) {
+      Task task;
+      if (try_pop(worker_idx, task)) {
+        // May dip below zero until the push that queued `task` counts it
+        pending_.fetch_sub(1);
+        task();
+        continue;
+      }
+
+      std::unique_lock lock(sleep_mutex_);
+      sleeping_.fetch_add(1);
+      sleep_cv_.wait(lock, [this] { return stop_ || pending_.load() > 0; });
+      sleeping_.fetch_sub(1);
+      if (stop_ && pending_.load() <= 0) {
+        return;
+      }
+    }
+  }
+
+  static auto pin_to_cpu([[maybe_unused]] std::thread& thread,
+                         [[maybe_unused]] std::size_t worker_idx) -> void {
+#ifdef __linux__
+    const auto num_cpus = std::max(1U, std::thread::hardware_concurrency());
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(worker_idx % num_cpus, &cpu_set);
+    if (pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set),
+                               &cpu_set) != 0) {
+      GGB_LOG_WARN("Failed to pin executor worker {} to CPU {}", worker_idx,
+                   worker_idx % num_cpus);
+    }
+#else
+    GGB_LOG_WARN("CPU pinning is only supported on Linux, ignoring");
+#endif
+  }
+
+  const ExecutorConfig cfg_;
+
+  std::vector<std::unique_ptr<WorkerQueue>> queues_;
+  std::atomic<std::size_t> next_queue_{0};
+  std::atomic<bool> warned_no_workers_{false};
+
+  std::atomic<std::int64_t> pending_{0};   // Queued tasks
+  std::atomic<std::size_t> sleeping_{0};  // Workers in `sleep_cv_.wait`
+
+  std::mutex sleep_mutex_;
+  std::condition_variable sleep_cv_;
+  bool stop_{false};  // Guarded by `sleep_mutex_`
+
+  std::vector<std::thread> workers_;
+};
+
+// Splits [0, count) into contiguous chunks of at least `grain` items, at most
+// one per worker of `pool` plus one for the caller, and calls
+// `fn(begin, end)` on each. The caller runs the first chunk itself and then
+// waits for the rest, so this never blocks on a busy pool. Results come back
+// in chunk order; a count of at most `grain` runs inline as a single chunk.
+template <typename Fn>
+auto parallel_chunks(Executor& pool, std::size_t count, std::size_t grain,
+                     Fn&& fn)
+    -> std::vector<std::invoke_result_t<Fn&, std::size_t, std::size_t>> {
+  using R = std::invoke_result_t<Fn&, std::size_t, std::size_t>;
+
+  grain = std::max<std::size_t>(grain, 1);
+  const auto max_chunks = (count + grain - 1) / grain;
+  const auto num_chunks =
+      std::max<std::size_t>(1, std::min(max_chunks, pool.num_threads() + 1));
+  const auto chunk = (count + num_chunks - 1) / num_chunks;
+
+  std::vector<std::future<R>> futures;
+  futures.reserve(num_chunks - 1);
+  for (std::size_t i = 1; i < num_chunks; ++i) {
+    const auto begin = std::min(count, i * chunk);
+    const auto end = std::min(count, begin + chunk);
+    futures.push_back(
+        pool.submit([&fn, begin, end] { return fn(begin, end); }));
+  }
+
+  std::vector<R> results;
+  results.reserve(num_chunks);
+  std::exception_ptr error;
+  try {
+    results.push_back(fn(0, std::min(count, chunk)));
+  } catch (...) {
+    error = std::current_exception();
+  }
+  // Workers reference `fn`, so every chunk must finish before unwinding
+  for (auto& future : futures) {
+    future.wait();
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+  for (auto& future : futures) {
+    results.push_back(future.get());
+  }
+  return results;
+}
+
+// Concatenates the per-chunk vectors returned by `parallel_chunks`, in order
+template <typename T>
+auto concat_chunks(std::vector<std::vector<T>>&& chunks) -> std::vector<T> {
+  if (chunks.size() == 1) {
+    return std::move(chunks.front());
+  }
+  std::vector<T> out;
+  for (auto& chunk : chunks) {
+    out.insert(out.end(), std::make_move_iterator(chunk.begin()),
+               std::make_move_iterator(chunk.end()));
+  }
+  return out;
+}
+
+}  // namespace ggb::detail
@@ -0,0 +1,263 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define GGB_GATHER_X86 1
+#endif
+
+namespace ggb::detail {
+
+// Instruction sets the row copy kernels are built for, in increasing order
+enum class GatherIsa {
+  Scalar,  // memcpy
+  Avx2,
+  Avx512,
+};
+
+// Best instruction set this CPU supports, detected once
+[[nodiscard]] inline auto best_gather_isa() -> GatherIsa {
+#ifdef GGB_GATHER_X86
+  static const auto isa = [] {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+      return GatherIsa::Avx512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+      return GatherIsa::Avx2;
+    }
+    return GatherIsa::Scalar;
+  }();
+  return isa;
+#else
+  return GatherIsa::Scalar;
+#endif
+}
+
+// Hints the cache lines of `bytes` at `row` into L1 ahead of a copy. Never
+// faults, so rows of an mmap that are not resident are simply skipped.
+inline auto prefetch_row(const void* row, std::size_t bytes) -> void {
+  const auto* p = static_cast<const char*>(row);
+  for (std::size_t offset = 0; offset < bytes; offset += 64) {
+    __builtin_prefetch(p + offset, 0, 3);
+  }
+}
+
+// Orders non-temporal stores before anything that follows, so a batch is
+// visible once the gather returns
+inline auto store_fence() -> void {
+#ifdef GGB_GATHER_X86
+  _mm_sfence();
+#endif
+}
+
+namespace gather_kernels {
+
+using CopyFn = void (*)(const float* __restrict src, float* __restrict dst,
+                        std::size_t dim);
+
+inline auto copy_scalar(const float* __restrict src, float* __restrict dst,
+                        std::size_t dim) -> void {
+  std::memcpy(dst, src, dim * sizeof(float));
+}
+
+#ifdef GGB_GATHER_X86
+
+// Any dim: full vectors, then a scalar tail
+__attribute__((target("avx2"))) inline auto copy_avx2(
+    const float* __restrict src, float* __restrict dst, std::size_t dim)
+    -> void {
+  std::size_t i = 0;
+  for (; i + 8 <= dim; i += 8) {
+    _mm256_storeu_ps(dst + i, _mm256_loadu_ps(src + i));
+  }
+  for (; i < dim; ++i) {
+    dst[i] = src[i];
+  }
+}
+
+__attribute__((target("avx512f"))) inline auto copy_avx512(
+    const float* __restrict src, float* __restrict dst, std::size_t dim)
+    -> void {
+  std::size_t i = 0;
+  for (; i + 16 <= dim; i += 16) {
+    _mm512_storeu_ps(dst + i, _mm512_loadu_ps(src + i));
+  }
+  if (i < dim) {
+    const auto mask = static_cast<__mmask16>((1U << (dim - i)) - 1);
+    _mm512_mask_storeu_ps(dst + i, mask,
+                          _mm512_maskz_loadu_ps(mask, src + i));
+  }
+}
+
+// `Dim` known at compile time: the loop is fully unrolled and the tail mask
+// is a constant. `dim` is ignored.
+template <std::size_t Dim>
+__attribute__((target("avx2"))) inline auto copy_avx2_fixed(
+    const float* __restrict src, float* __restrict dst, std::size_t /*dim*/)
+    -> void {
+#pragma GCC unroll 128
+  for (std::size_t i = 0; i + 8 <= Dim; i += 8) {
+    _mm256_storeu_ps(dst + i, _mm256_loadu_ps(src + i));
+  }
+  if constexpr (Dim % 8 >= 4) {
+    constexpr auto i = Dim / 8 * 8;
+    _mm_storeu_ps(dst + i, _mm_loadu_ps(src + i));
+  }
+#pragma GCC unroll 4
+  for (std::size_t i = (Dim / 8 * 8) + (Dim % 8 / 4 * 4); i < Dim; ++i) {
+    dst[i] = src[i];
+  }
+}
+
+template <std::size_t Dim>
+__attribute__((target("avx512f"))) inline auto copy_avx512_fixed(
+    const float* __restrict src, float* __restrict dst, std::size_t /*dim*/)
+    -> void {
+#pragma GCC unroll 64
+  for (std::size_t i = 0; i + 16 <= Dim; i += 16) {
+    _mm512_storeu_ps(dst + i, _mm512_loadu_ps(src + i));
+  }
+  if constexpr (Dim % 16 != 0) {
+    constexpr auto i = Dim / 16 * 16;
+    constexpr auto mask = static_cast<__mmask16>((1U << (Dim % 16)) - 1);
+    _mm512_mask_storeu_ps(dst + i, mask,
+                          _mm512_maskz_loadu_ps(mask, src + i));
+  }
+}
+
+// Non-temporal stores need aligned destinations: regular stores up to the
+// first cache line boundary, streaming stores for the body, regular for the
+// tail. Starting on a line lets the write-combining buffers flush whole lines.
+__attribute__((target("avx2"))) inline auto stream_avx2(
+    const float* __restrict src, float* __restrict dst, std::size_t dim)
+    -> void {
+  std::size_t i = 0;
+  const auto head = (64 - (reinterpret_cast<std::uintptr_t>(dst) % 64)) % 64;
+  for (; i < dim && i * sizeof(float) < head; ++i) {
+    dst[i] = src[i];
+  }
+  // Stream whole lines only; a half-written line is flushed partially,
+  // which is far slower than a regular store
+  for (; i + 16 <= dim; i += 16) {
+    _mm256_stream_ps(dst + i, _mm256_loadu_ps(src + i));
+    _mm256_stream_ps(dst + i + 8, _mm256_loadu_ps(src + i + 8));
+  }
+  for (; i + 8 <= dim; i += 8) {
+    _mm256_storeu_ps(dst + i, _mm256_loadu_ps(src + i));
+  }
+  if (i < dim) {
+    const auto lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const auto mask = _mm256_cmpgt_epi32(
+        _mm256_set1_epi32(static_cast<int>(dim - i)), lanes);
+    _mm256_maskstore_ps(dst + i, mask, _mm256_maskload_ps(src + i, mask));
+  }
+}
+
+__attribute__((target("avx512f"))) inline auto stream_avx512(
+    const float* __restrict src, float* __restrict dst, std::size_t dim)
+    -> void {
+  std::size_t i = 0;
+  const auto head = (64 - (reinterpret_cast<std::uintptr_t>(dst) % 64)) % 64;
+  for (; i < dim && i * sizeof(float) < head; ++i) {
+    dst[i] = src[i];
+  }
+  for (; i + 16 <= dim; i += 16) {
+    _mm512_stream_ps(dst + i, _mm512_loadu_ps(src + i));
+  }
+  if (i < dim) {
+    const auto mask = static_cast<__mmask16>((1U << (dim - i)) - 1);
+    _mm512_mask_storeu_ps(dst + i, mask,
+                          _mm512_maskz_loadu_ps(mask, src + i));
+  }
+}
+
+// Feature widths of the common benchmark datasets
+template <template <std::size_t> typename Kernel>
+[[nodiscard]] inline auto fixed_for(std::size_t dim) -> CopyFn {
+  switch (dim) {
+    case 64:
+      return Kernel<64>::fn;
+    case 100:
+      return Kernel<100>::fn;
+    case 128:
+      return Kernel<128>::fn;
+    case 256:
+      return Kernel<256>::fn;
+    case 602:
+      return Kernel<602>::fn;
+    default:
+      return nullptr;
+  }
+}
+
+template <std::size_t Dim>
+struct Avx2Fixed {
+  static constexpr CopyFn fn = copy_avx2_fixed<Dim>;
+};
+
+template <std::size_t Dim>
+struct Avx512Fixed {
+  static constexpr CopyFn fn = copy_avx512_fixed<Dim>;
+};
+
+#endif  // GGB_GATHER_X86
+
+}  // namespace gather_kernels
+
+// Copies fp32 rows of one fixed width, with the kernels for that width and
+// `isa` picked once up front. `copy(..., true)` uses non-temporal stores;
+// call `store_fence` once the batch is written.
+class RowCopier {
+ public:
+  RowCopier() : RowCopier(0) {}
+
+  explicit RowCopier(std::size_t dim, GatherIsa isa = best_gather_isa())
+      : dim_(dim) {
+#ifdef GGB_GATHER_X86
+    namespace k = gather_kernels;
+    switch (isa) {
+      case GatherIsa::Avx512: {
+        const auto fixed = k::fixed_for<k::Avx512Fixed>(dim);
+        copy_ = fixed != nullptr ? fixed : k::copy_avx512;
+        stream_ = k::stream_avx512;
+        name_ = fixed != nullptr ? "avx512-fixed" : "avx512";
+        return;
+      }
+      case GatherIsa::Avx2: {
+        const auto fixed = k::fixed_for<k::Avx2Fixed>(dim);
+        copy_ = fixed != nullptr ? fixed : k::copy_avx2;
+        stream_ = k::stream_avx2;
+        name_ = fixed != nullptr ? "avx2-fixed" : "avx2";
+        return;
+      }
+      case GatherIsa::Scalar:
+        break;
+    }
+#else
+    static_cast<void>(isa);
+#endif
+  }
+
+  auto copy(const float* src, float* dst, bool streaming = false) const
+      -> void {
+    (streaming ? stream_ : copy_)(src, dst, dim_);
+  }
+
+  [[nodiscard]] auto dim() const -> std::size_t { return dim_; }
+
+  // Kernel in use, e.g. "avx512-fixed" for a specialized width
+  [[nodiscard]] auto name() const -> std::string_view { return name_; }
+
+ private:
+  std::size_t dim_;
+  gather_kernels::CopyFn copy_{gather_kernels::copy_scalar};
+  gather_kernels::CopyFn stream_{gather_kernels::copy_scalar};
+  std::string_view name_{"scalar"};
+};
+
+}  // namespace ggb::detail
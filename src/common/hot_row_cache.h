@@ -0,0 +1,132 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "common/key_index.h"
+#include "ggb/core.h"
+
+namespace ggb::detail {
+
+// Dense in-RAM copy of a fixed set of rows, keyed by slot. Membership is a
+// bitmap over all slots with a rank per 64-bit word, so a probe is two loads
+// and a popcount, and the cached rows are packed in slot order.
+class HotRowCache {
+ public:
+  HotRowCache() = default;
+
+  // `slots` must be ascending and below `num_slots`. `row_of(slot)` points at
+  // the `tensor_size` floats to copy for that slot.
+  template <typename RowFn>
+  HotRowCache(std::span<const std::size_t> slots, std::size_t num_slots,
+              std::size_t tensor_size, RowFn&& row_of)
+      : tensor_size_(tensor_size),
+        num_rows_(slots.size()),
+        bits_((num_slots + 63) / 64, 0),
+        rows_(slots.size() * tensor_size) {
+    for (std::size_t i = 0; i < slots.size(); ++i) {
+      bits_[slots[i] / 64] |= std::uint64_t{1} << (slots[i] % 64);
+      std::copy_n(row_of(slots[i]), tensor_size,
+                  rows_.data() + (i * tensor_size));
+    }
+
+    ranks_.reserve(bits_.size());
+    std::size_t rank = 0;
+    for (const auto word : bits_) {
+      ranks_.push_back(rank);
+      rank += std::popcount(word);
+    }
+  }
+
+  // The cached row of `slot`, or nullptr if it is not cached
+  [[nodiscard]] auto find(std::size_t slot) const -> const float* {
+    const auto word = slot / 64;
+    if (word >= bits_.size()) {
+      return nullptr;
+    }
+    const auto bit = std::uint64_t{1} << (slot % 64);
+    if ((bits_[word] & bit) == 0) {
+      return nullptr;
+    }
+    const auto rank = ranks_[word] + std::popcount(bits_[word] & (bit - 1));
+    return rows_.data() + (rank * tensor_size_);
+  }
+
+  [[nodiscard]] auto size() const -> std::size_t { return num_rows_; }
+  [[nodiscard]] auto memory_bytes() const -> std::size_t {
+    return ((bits_.capacity() + ranks_.capacity()) * sizeof(std::uint64_t)) +
+           (rows_.capacity() * sizeof(float));
+  }
+
+ private:
+  std::size_t tensor_size_{0};
+  std::size_t num_rows_{0};
+  std::vector<std::uint64_t> bits_;
+  std::vector<std::uint64_t> ranks_;
+  std::vector<float> rows_;
+};
+
+// Slots of the highest-degree rows in `graph` that fit the limits of `cfg`,
+// in ascending order. Rows without edges are never selected.
+[[nodiscard]] inline auto select_hot_slots(const KeyIndex& index,
+                                           std::size_t num_slots,
+                                           const GraphTopology& graph,
+                                           const HotCacheConfig& cfg,
+                                           std::size_t row_bytes)
+    -> std::vector<std::size_t> {
+  if ((cfg.max_nodes == 0 && cfg.max_bytes == 0) || row_bytes == 0) {
+    return {};
+  }
+
+  // Count both endpoints of every edge, resolving keys a chunk at a time
+  std::vector<std::uint32_t> degrees(num_slots, 0);
+  std::array<Key, 2 * lookup_batch_size> keys{};
+  std::array<std::size_t, 2 * lookup_batch_size> slots{};
+  for (std::size_t first = 0; first < graph.edges.size();
+       first += lookup_batch_size) {
+    const auto n = std::min(lookup_batch_size, graph.edges.size() - first);
+    for (std::size_t i = 0; i < n; ++i) {
+      keys[2 * i] = {graph.edges[first + i].first};
+      keys[(2 * i) + 1] = {graph.edges[first + i].second};
+    }
+    index.find_batch(std::span(keys).first(2 * n),
+                     std::span(slots).first(2 * n));
+    for (const auto slot : std::span(slots).first(2 * n)) {
+      if (slot != missing_slot) {
+        ++degrees[slot];
+      }
+    }
+  }
+
+  std::vector<std::size_t> hot;
+  for (std::size_t slot = 0; slot < num_slots; ++slot) {
+    if (degrees[slot] > 0) {
+      hot.push_back(slot);
+    }
+  }
+
+  auto limit = hot.size();
+  if (cfg.max_nodes > 0) {
+    limit = std::min(limit, cfg.max_nodes);
+  }
+  if (cfg.max_bytes > 0) {
+    limit = std::min(limit, cfg.max_bytes / row_bytes);
+  }
+
+  // Highest degree first, lower slot on ties
+  const auto hotter = [&](std::size_t a, std::size_t b) {
+    return degrees[a] != degrees[b] ? degrees[a] > degrees[b] : a < b;
+  };
+  std::ranges::nth_element(
+      hot, hot.begin() + static_cast<std::ptrdiff_t>(limit), hotter);
+  hot.resize(limit);
+  std::ranges::sort(hot);
+  return hot;
+}
+
+}  // namespace ggb::detail
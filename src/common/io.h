@@ -2,60 +2,295 @@
 
 #include <sys/mman.h>
 
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cstddef>
 #include <cstdint>
 #include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <span>
+#include <stdexcept>
 #include <string>
+#include <system_error>
+#include <thread>
 #include <utility>
 #include <vector>
 
+#include "common/dtype.h"
+#include "common/executor.h"
 #include "common/logging.h"
 #include "common/mmap_region.h"
+#include "common/npy.h"
 #include "ggb/core.h"
 
-namespace ggb::io {
-inline auto ingest_features_from_csv(const std::string& path,
-                                     FeatureStoreBuilder& builder) -> void {
-  const detail::MmapRegion mmap(path);
+namespace ggb::detail {
 
-  // Hint to the kernel that we will read this start-to-finish
-  mmap.advise(MADV_SEQUENTIAL);
+// Rows parsed from one slice of a feature CSV
+struct CsvChunk {
+  std::vector<float> values;
+  std::vector<std::size_t> row_ends;  // End of each row within `values`
+  bool uniform_dim{true};
+};
 
-  const char* ptr = static_cast<const char*>(mmap.data());
-  const char* const end = ptr + mmap.size();
+inline auto is_line_break(char c) -> bool { return c == '\n' || c == '\r'; }
 
-  std::uint64_t node_id{0};
-  ggb::Value tensor;
-  tensor.reserve(128);  // Pre-reserve typical GNN feature dim
+// Cuts [begin, end) into slices of about `chunk_bytes` that each end right
+// after a line break (or at `end`), so no row spans two slices
+inline auto split_at_lines(const char* begin, const char* end,
+                           std::size_t chunk_bytes)
+    -> std::vector<std::pair<const char*, const char*>> {
+  std::vector<std::pair<const char*, const char*>> slices;
+  const auto step = std::max<std::size_t>(1, chunk_bytes);
+  while (begin < end) {
+    const char* cut = end;
+    if (static_cast<std::size_t>(end - begin) > step) {
+      const auto* line_end = static_cast<const char*>(
+          std::memchr(begin + step, '\n', end - (begin + step)));
+      cut = line_end == nullptr ? end : line_end + 1;
+    }
+    slices.emplace_back(begin, cut);
+    begin = cut;
+  }
+  return slices;
+}
 
+// Parses comma separated floats, one row per non-empty line. Unlike
+// `std::strtof`, `std::from_chars` ignores the locale and does not need a
+// terminated string.
+inline auto parse_csv_rows(const char* ptr, const char* const end)
+    -> CsvChunk {
+  CsvChunk chunk;
   while (ptr < end) {
-    tensor.clear();
-    char* next_ptr = nullptr;
-
-    while (ptr < end && *ptr != '\n' && *ptr != '\r') {
-      const float val = std::strtof(ptr, &next_ptr);
-      if (ptr == next_ptr) {
-        break;  // Could not parse a number
+    const auto row_start = chunk.values.size();
+    while (ptr < end && !is_line_break(*ptr)) {
+      while (ptr < end && (*ptr == ' ' || *ptr == '\t' || *ptr == '+')) {
+        ++ptr;
+      }
+      float val = 0;
+      const auto [next, ec] = std::from_chars(ptr, end, val);
+      if (ec == std::errc::invalid_argument) {
+        break;  // Could not parse a number, drop the rest of the line
+      }
+      if (ec == std::errc::result_out_of_range) {
+        val = std::strtof(ptr, nullptr);  // Saturate like `strtof`
       }
 
-      tensor.push_back(val);
-      ptr = next_ptr;
+      chunk.values.push_back(val);
+      ptr = next;
 
       // Skip the comma if present
+      while (ptr < end && (*ptr == ' ' || *ptr == '\t')) {
+        ++ptr;
+      }
       if (ptr < end && *ptr == ',') {
         ptr++;
       }
     }
 
-    if (!tensor.empty()) {
-      builder.put_tensor({node_id++}, tensor);
+    if (chunk.values.size() > row_start) {
+      const auto dim = chunk.values.size() - row_start;
+      if (!chunk.row_ends.empty() && dim != chunk.row_ends.front()) {
+        chunk.uniform_dim = false;
+      }
+      chunk.row_ends.push_back(chunk.values.size());
     }
 
-    while (ptr < end && (*ptr == '\n' || *ptr == '\r')) {
+    while (ptr < end && !is_line_break(*ptr)) {
+      ptr++;
+    }
+    while (ptr < end && is_line_break(*ptr)) {
       ptr++;
     }
   }
+  return chunk;
+}
 
-  GGB_LOG_INFO("Ingested {} node features from {}", node_id, path);
+// Hands the rows of `chunk` to `builder` as nodes `first_id`, `first_id + 1`,
+// ...; a chunk of equally sized rows goes in as a single batch
+inline auto insert_csv_chunk(const CsvChunk& chunk, std::uint64_t first_id,
+                             FeatureStoreBuilder& builder) -> void {
+  const auto num_rows = chunk.row_ends.size();
+  if (num_rows == 0) {
+    return;
+  }
+  if (chunk.uniform_dim) {
+    std::vector<Key> keys(num_rows);
+    for (std::size_t i = 0; i < num_rows; ++i) {
+      keys[i] = {.NodeID = first_id + i};
+    }
+    builder.put_tensors(keys, chunk.values, chunk.row_ends.front());
+    return;
+  }
+
+  std::size_t row_start = 0;
+  for (std::size_t i = 0; i < num_rows; ++i) {
+    const auto row_end = chunk.row_ends[i];
+    builder.put_tensor(
+        {.NodeID = first_id + i},
+        Value(chunk.values.begin() + static_cast<std::ptrdiff_t>(row_start),
+              chunk.values.begin() + static_cast<std::ptrdiff_t>(row_end)));
+    row_start = row_end;
+  }
+}
+
+// Inserts a row-major `rows` x `dim` matrix of little-endian elements as
+// nodes 0, 1, ... Aligned float32 data goes from the mapping to the builder
+// without an intermediate copy; anything else is converted a bounded number
+// of rows at a time.
+inline auto insert_binary_matrix(std::span<const std::byte> data,
+                                 NpyDtype dtype, std::size_t rows,
+                                 std::size_t dim, FeatureStoreBuilder& builder)
+    -> bool {
+  static_assert(std::endian::native == std::endian::little);
+  if (rows == 0 || dim == 0) {
+    return true;
+  }
+  builder.reserve(rows, dim);
+  const auto num_values = rows * dim;
+  if (dtype == NpyDtype::F32 &&
+      reinterpret_cast<std::uintptr_t>(data.data()) % alignof(float) == 0) {
+    return builder.put_matrix(
+        0, std::span(reinterpret_cast<const float*>(data.data()), num_values),
+        dim);
+  }
+
+  constexpr std::size_t batch_values = std::size_t{4} << 20;
+  const auto batch_rows = std::max<std::size_t>(1, batch_values / dim);
+  const std::size_t element_bytes = dtype == NpyDtype::F32 ? 4 : 2;
+  std::vector<float> scratch;
+  bool all_accepted = true;
+  for (std::size_t first = 0; first < rows; first += batch_rows) {
+    const auto n = std::min(batch_rows, rows - first);
+    const auto* const src = data.data() + (first * dim * element_bytes);
+    scratch.resize(n * dim);
+    if (dtype == NpyDtype::F32) {
+      std::memcpy(scratch.data(), src, scratch.size() * sizeof(float));
+    } else {
+      for (std::size_t i = 0; i < scratch.size(); ++i) {
+        std::uint16_t half = 0;
+        std::memcpy(&half, src + (i * 2), sizeof(half));
+        scratch[i] = half_to_float(half);
+      }
+    }
+    all_accepted &= builder.put_matrix(first, scratch, dim);
+  }
+  return all_accepted;
+}
+
+inline auto mapped_bytes(const MmapRegion& mmap)
+    -> std::span<const std::byte> {
+  return {static_cast<const std::byte*>(mmap.data()), mmap.size()};
+}
+
+}  // namespace ggb::detail
+
+namespace ggb::io {
+
+struct CsvIngestOptions {
+  // Parser threads, with 0 the file is parsed on the calling thread
+  std::size_t num_threads{std::thread::hardware_concurrency()};
+
+  // Approximate size of the slice handed to one parser task
+  std::size_t chunk_bytes{std::size_t{16} << 20};
+};
+
+// Assigns node ids by line number, skipping empty lines. Slices of the file
+// are parsed concurrently while the builder consumes them in file order, so
+// the builder itself is only ever called from this thread.
+inline auto ingest_features_from_csv(const std::string& path,
+                                     FeatureStoreBuilder& builder,
+                                     const CsvIngestOptions& opts = {})
+    -> void {
+  const detail::MmapRegion mmap(path);
+
+  // Hint to the kernel that we will read this start-to-finish
+  mmap.advise(MADV_SEQUENTIAL);
+
+  const char* const begin = static_cast<const char*>(mmap.data());
+  const auto slices =
+      detail::split_at_lines(begin, begin + mmap.size(), opts.chunk_bytes);
+
+  // Bound the parsed-but-not-inserted slices held in memory
+  detail::Executor parsers(ExecutorConfig{.num_threads = opts.num_threads});
+  const auto window = std::max<std::size_t>(1, 2 * opts.num_threads);
+  std::deque<std::future<detail::CsvChunk>> pending;
+
+  std::uint64_t node_id{0};
+  std::size_t next_slice = 0;
+  while (next_slice < slices.size() || !pending.empty()) {
+    while (next_slice < slices.size() && pending.size() < window) {
+      const auto [first, last] = slices[next_slice++];
+      pending.push_back(parsers.submit(
+          [first, last] { return detail::parse_csv_rows(first, last); }));
+    }
+
+    const auto chunk = pending.front().get();
+    pending.pop_front();
+    // Lines are about equally long, so the first slice with rows predicts
+    // the row count of the file; a little slack beats growing at the very end
+    if (node_id == 0 && !chunk.row_ends.empty()) {
+      const auto [first, last] = slices[next_slice - pending.size() - 1];
+      const auto slice_bytes = static_cast<std::size_t>(last - first);
+      const auto rows = chunk.row_ends.size() * mmap.size() / slice_bytes;
+      builder.reserve(rows + (rows / 16), chunk.row_ends.front());
+    }
+    detail::insert_csv_chunk(chunk, node_id, builder);
+    node_id += chunk.row_ends.size();
+  }
+
+  GGB_LOG_INFO("Ingested {} node features from {} ({} slices)", node_id, path,
+               slices.size());
+}
+
+// Reads a C-ordered float32 or float16 .npy matrix, one node per row
+inline auto ingest_features_from_npy(const std::string& path,
+                                     FeatureStoreBuilder& builder) -> void {
+  const detail::MmapRegion mmap(path);
+  mmap.advise(MADV_SEQUENTIAL);
+
+  const auto array =
+      detail::NpyArray::parse(detail::mapped_bytes(mmap), path);
+  if (!detail::insert_binary_matrix(array.data, array.dtype, array.rows,
+                                    array.cols, builder)) {
+    GGB_LOG_WARN("Builder rejected rows of {}", path);
+  }
+  GGB_LOG_INFO("Ingested {} node features from {}", array.rows, path);
+}
+
+// Reads a headerless row-major matrix of little-endian float32 with `dim`
+// columns, one node per row
+inline auto ingest_features_from_raw(const std::string& path,
+                                     FeatureStoreBuilder& builder,
+                                     std::size_t dim) -> void {
+  const detail::MmapRegion mmap(path);
+  mmap.advise(MADV_SEQUENTIAL);
+
+  const auto row_bytes = dim * sizeof(float);
+  if (row_bytes == 0 || mmap.size() % row_bytes != 0) {
+    GGB_LOG_ERROR("Size of {} ({} B) is not a multiple of {} float32 columns",
+                  path, mmap.size(), dim);
+    throw std::runtime_error("ingest_features_from_raw: bad file size");
+  }
+  const auto rows = mmap.size() / row_bytes;
+  if (!detail::insert_binary_matrix(detail::mapped_bytes(mmap),
+                                    detail::NpyDtype::F32, rows, dim,
+                                    builder)) {
+    GGB_LOG_WARN("Builder rejected rows of {}", path);
+  }
+  GGB_LOG_INFO("Ingested {} node features from {}", rows, path);
+}
+
+// Picks the reader from the extension: `.npy`, otherwise CSV
+inline auto ingest_features(const std::string& path,
+                            FeatureStoreBuilder& builder) -> void {
+  if (path.ends_with(".npy")) {
+    ingest_features_from_npy(path, builder);
+  } else {
+    ingest_features_from_csv(path, builder);
+  }
 }
 
 inline void ingest_edgelist_from_csv(
@@ -95,4 +330,42 @@ inline void ingest_edgelist_from_csv(
 
   GGB_LOG_INFO("Ingested {} edges from {}", out_buffer.size(), path);
 }
+
+// Reads (src, dst) pairs of little-endian int64 stored back to back
+inline auto ingest_edgelist_from_binary(
+    const std::string& path,
+    std::vector<std::pair<ggb::NodeID, ggb::NodeID>>& out_buffer) -> void {
+  const detail::MmapRegion mmap(path);
+  mmap.advise(MADV_SEQUENTIAL);
+
+  constexpr auto edge_bytes = 2 * sizeof(std::int64_t);
+  if (mmap.size() % edge_bytes != 0) {
+    GGB_LOG_ERROR("Size of {} ({} B) is not a whole number of int64 pairs",
+                  path, mmap.size());
+    throw std::runtime_error("ingest_edgelist_from_binary: bad file size");
+  }
+
+  const auto* const src = static_cast<const std::byte*>(mmap.data());
+  const auto num_edges = mmap.size() / edge_bytes;
+  out_buffer.reserve(out_buffer.size() + num_edges);
+  for (std::size_t i = 0; i < num_edges; ++i) {
+    std::int64_t ends[2];
+    std::memcpy(ends, src + (i * edge_bytes), edge_bytes);
+    out_buffer.emplace_back(static_cast<ggb::NodeID>(ends[0]),
+                            static_cast<ggb::NodeID>(ends[1]));
+  }
+
+  GGB_LOG_INFO("Ingested {} edges from {}", num_edges, path);
+}
+
+// Picks the reader from the extension: `.bin`, otherwise CSV
+inline auto ingest_edgelist(
+    const std::string& path,
+    std::vector<std::pair<ggb::NodeID, ggb::NodeID>>& out_buffer) -> void {
+  if (path.ends_with(".bin")) {
+    ingest_edgelist_from_binary(path, out_buffer);
+  } else {
+    ingest_edgelist_from_csv(path, out_buffer);
+  }
+}
 }  // namespace ggb::io
@@ -0,0 +1,643 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "common/serialize.h"
+#include "ggb/core.h"
+
+namespace ggb::detail {
+
+// Maps keys to row slots. Slots are assigned in insertion order, so a row's
+// location is always `slot * row_size` within the engine's data region.
+//
+// Every index answers lookups a batch at a time through `find_batch`, which
+// writes `missing_slot` for absent keys. Batching lets the sparse indices
+// interleave several independent searches so their cache misses overlap.
+
+inline constexpr std::size_t missing_slot = static_cast<std::size_t>(-1);
+
+// Number of keys resolved per `find_batch` call by `KeyIndex::for_each_slot`
+inline constexpr std::size_t lookup_batch_size = 64;
+
+// Keys [base, base + count) stored at slot `NodeID - base`. No per-key state.
+class DenseIndex {
+ public:
+  DenseIndex(NodeID base, std::size_t count) : base_(base), count_(count) {}
+
+  [[nodiscard]] auto find(NodeID id) const -> std::size_t {
+    // Unsigned wrap-around folds `id < base_` into the bounds check
+    const auto slot = id - base_;
+    return slot < count_ ? slot : missing_slot;
+  }
+
+  auto find_batch(std::span<const Key> keys, std::span<std::size_t> slots) const
+      -> void {
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+      slots[i] = find(keys[i].NodeID);
+    }
+  }
+
+  [[nodiscard]] auto size() const -> std::size_t { return count_; }
+  [[nodiscard]] auto memory_bytes() const -> std::size_t {
+    return sizeof(*this);
+  }
+
+  template <typename Fn>
+  auto for_each_array(Fn&& /*fn*/) const -> void {}
+
+  auto save(BinaryWriter& out) const -> void {
+    out.put(base_);
+    out.put(static_cast<std::uint64_t>(count_));
+  }
+
+  [[nodiscard]] static auto load(BinaryReader& in) -> DenseIndex {
+    const auto base = in.get<NodeID>();
+    const auto count = in.get<std::uint64_t>();
+    return {base, count};
+  }
+
+ private:
+  NodeID base_;
+  std::size_t count_;
+};
+
+// Node-based hash map. Kept as a baseline for the sparse indices below.
+class HashIndex {
+ public:
+  explicit HashIndex(std::span<const std::pair<NodeID, std::size_t>> entries) {
+    slots_.reserve(entries.size());
+    for (const auto& [id, slot] : entries) {
+      slots_[Key{.NodeID = id}] = slot;
+    }
+  }
+
+  [[nodiscard]] auto find(NodeID id) const -> std::size_t {
+    if (auto it = slots_.find(Key{.NodeID = id}); it != slots_.end()) {
+      return it->second;
+    }
+    return missing_slot;
+  }
+
+  auto find_batch(std::span<const Key> keys, std::span<std::size_t> slots) const
+      -> void {
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+      slots[i] = find(keys[i].NodeID);
+    }
+  }
+
+  [[nodiscard]] auto size() const -> std::size_t { return slots_.size(); }
+
+  // Approximate: one heap node per entry plus the bucket array
+  [[nodiscard]] auto memory_bytes() const -> std::size_t {
+    constexpr auto node_bytes =
+        sizeof(std::pair<const Key, std::size_t>) + sizeof(void*);
+    return (slots_.size() * node_bytes) +
+           (slots_.bucket_count() * sizeof(void*));
+  }
+
+  // Nodes are allocated one by one, so there is no array to visit
+  template <typename Fn>
+  auto for_each_array(Fn&& /*fn*/) const -> void {}
+
+  auto save(BinaryWriter& out) const -> void {
+    std::vector<NodeID> ids;
+    std::vector<std::size_t> slots;
+    ids.reserve(slots_.size());
+    slots.reserve(slots_.size());
+    for (const auto& [key, slot] : slots_) {
+      ids.push_back(key.NodeID);
+      slots.push_back(slot);
+    }
+    out.put_array<NodeID>(ids);
+    out.put_array<std::size_t>(slots);
+  }
+
+  // Rebuilds the hash table, so unlike the other indices this is not a copy
+  [[nodiscard]] static auto load(BinaryReader& in) -> HashIndex {
+    const auto ids = in.get_array<NodeID>();
+    const auto slots = in.get_array<std::size_t>();
+    if (ids.size() != slots.size()) {
+      throw std::runtime_error("HashIndex: corrupt serialized index");
+    }
+    std::vector<std::pair<NodeID, std::size_t>> entries;
+    entries.reserve(ids.size());
+    for (std::size_t i = 0; i < ids.size(); ++i) {
+      entries.emplace_back(ids[i], slots[i]);
+    }
+    return HashIndex(entries);
+  }
+
+ private:
+  std::unordered_map<Key, std::size_t, KeyHash> slots_;
+};
+
+// Immutable sorted key array in Eytzinger (BFS) order: the first levels of
+// the implicit search tree share a handful of cache lines, and each step is a
+// branch-free `k = 2k + (key < id)`.
+class EytzingerIndex {
+ public:
+  // `sorted` must be sorted by key with unique keys
+  explicit EytzingerIndex(
+      std::span<const std::pair<NodeID, std::size_t>> sorted)
+      : keys_(sorted.size() + 1),
+        slots_(sorted.size() + 1, missing_slot),
+        num_levels_(std::bit_width(sorted.size())) {
+    std::size_t next = 0;
+    fill(sorted, 1, next);
+  }
+
+  [[nodiscard]] auto find(NodeID id) const -> std::size_t {
+    std::size_t k = 1;
+    for (std::size_t level = 0; level < num_levels_; ++level) {
+      k = step(k, id);
+    }
+    return resolve(k, id);
+  }
+
+  // Advances a group of searches one tree level at a time, so the loads of
+  // different keys are in flight together instead of back to back
+  auto find_batch(std::span<const Key> keys, std::span<std::size_t> slots) const
+      -> void {
+    constexpr std::size_t group_size = 16;
+    std::array<std::size_t, group_size> k{};
+
+    for (std::size_t base = 0; base < keys.size(); base += group_size) {
+      const auto n = std::min(group_size, keys.size() - base);
+      std::fill_n(k.begin(), n, 1);
+      for (std::size_t level = 0; level < num_levels_; ++level) {
+        for (std::size_t j = 0; j < n; ++j) {
+          k[j] = step(k[j], keys[base + j].NodeID);
+          __builtin_prefetch(keys_.data() + std::min(k[j], size()));
+        }
+      }
+      for (std::size_t j = 0; j < n; ++j) {
+        slots[base + j] = resolve(k[j], keys[base + j].NodeID);
+      }
+    }
+  }
+
+  [[nodiscard]] auto size() const -> std::size_t { return keys_.size() - 1; }
+  [[nodiscard]] auto memory_bytes() const -> std::size_t {
+    return (keys_.capacity() * sizeof(NodeID)) +
+           (slots_.capacity() * sizeof(std::size_t));
+  }
+
+  template <typename Fn>
+  auto for_each_array(Fn&& fn) const -> void {
+    fn(keys_.data(), keys_.size() * sizeof(NodeID));
+    fn(slots_.data(), slots_.size() * sizeof(std::size_t));
+  }
+
+  auto save(BinaryWriter& out) const -> void {
+    out.put_array<NodeID>(keys_);
+    out.put_array<std::size_t>(slots_);
+  }
+
+  [[nodiscard]] static auto load(BinaryReader& in) -> EytzingerIndex {
+    auto keys = in.get_array<NodeID>();
+    auto slots = in.get_array<std::size_t>();
+    if (keys.empty() || keys.size() != slots.size()) {
+      throw std::runtime_error("EytzingerIndex: corrupt serialized index");
+    }
+    return EytzingerIndex(std::move(keys), std::move(slots));
+  }
+
+ private:
+  EytzingerIndex(std::vector<NodeID>&& keys, std::vector<std::size_t>&& slots)
+      : keys_(std::move(keys)),
+        slots_(std::move(slots)),
+        num_levels_(std::bit_width(keys_.size() - 1)) {}
+
+  // In-order traversal of the implicit tree assigns sorted keys to BFS slots
+  auto fill(std::span<const std::pair<NodeID, std::size_t>> sorted,
+            std::size_t k, std::size_t& next) -> void {
+    if (k > size()) {
+      return;
+    }
+    fill(sorted, 2 * k, next);
+    keys_[k] = sorted[next].first;
+    slots_[k] = sorted[next].second;
+    ++next;
+    fill(sorted, (2 * k) + 1, next);
+  }
+
+  // Once `k` falls off the tree it stays put; written so it lowers to cmov
+  [[nodiscard]] auto step(std::size_t k, NodeID id) const -> std::size_t {
+    const auto in_tree = k <= size();
+    const auto probe = in_tree ? k : 0;
+    const auto next = (2 * k) + static_cast<std::size_t>(keys_[probe] < id);
+    return in_tree ? next : k;
+  }
+
+  // Strip the trailing right turns to recover the lower bound of `id`
+  [[nodiscard]] auto resolve(std::size_t k, NodeID id) const -> std::size_t {
+    k >>= std::countr_one(k) + 1;
+    return (k != 0 && keys_[k] == id) ? slots_[k] : missing_slot;
+  }
+
+  std::vector<NodeID> keys_;  // 1-indexed, keys_[0] unused
+  std::vector<std::size_t> slots_;
+  std::size_t num_levels_;
+};
+
+// Minimal perfect hash in the style of BBHash: each level hashes the keys
+// still unplaced into a bit array of `gamma * n` bits, keeps the positions hit
+// by exactly one key, and passes the collisions down to the next level. The
+// rank of a key's bit is its dense position in `keys_`/`slots_`, and the
+// stored key rejects lookups of absent keys.
+class PerfectHashIndex {
+ public:
+  // `entries` must have unique keys
+  explicit PerfectHashIndex(
+      std::span<const std::pair<NodeID, std::size_t>> entries) {
+    std::vector<NodeID> remaining;
+    remaining.reserve(entries.size());
+    for (const auto& entry : entries) {
+      remaining.push_back(entry.first);
+    }
+
+    std::vector<std::uint64_t> seen;
+    std::vector<std::uint64_t> collided;
+    for (std::size_t level = 0; level < max_levels && !remaining.empty();
+         ++level) {
+      const auto num_words =
+          std::max<std::size_t>(1, ((remaining.size() * gamma) + 63) / 64);
+      const Level lvl{.first_word = bits_.size(), .num_bits = num_words * 64};
+
+      seen.assign(num_words, 0);
+      collided.assign(num_words, 0);
+      for (const auto id : remaining) {
+        const auto pos = hash(id, level) % lvl.num_bits;
+        const auto mask = std::uint64_t{1} << (pos % 64);
+        collided[pos / 64] |= seen[pos / 64] & mask;
+        seen[pos / 64] |= mask;
+      }
+      for (std::size_t w = 0; w < num_words; ++w) {
+        bits_.push_back(seen[w] & ~collided[w]);
+      }
+
+      std::erase_if(remaining, [&](NodeID id) {
+        const auto pos = hash(id, level) % lvl.num_bits;
+        return (collided[pos / 64] & (std::uint64_t{1} << (pos % 64))) == 0;
+      });
+      levels_.push_back(lvl);
+    }
+
+    ranks_.reserve(bits_.size());
+    std::size_t rank = 0;
+    for (const auto word : bits_) {
+      ranks_.push_back(rank);
+      rank += std::popcount(word);
+    }
+    for (const auto id : remaining) {
+      fallback_[id] = rank++;
+    }
+
+    keys_.resize(entries.size());
+    slots_.resize(entries.size());
+    for (const auto& [id, slot] : entries) {
+      const auto pos = position(id);
+      keys_[pos] = id;
+      slots_[pos] = slot;
+    }
+  }
+
+  [[nodiscard]] auto find(NodeID id) const -> std::size_t {
+    return verify(position(id), id);
+  }
+
+  // Three passes per group: hash and prefetch the first-level bit words, rank
+  // and prefetch the candidate entries, then verify the stored keys
+  auto find_batch(std::span<const Key> keys, std::span<std::size_t> slots) const
+      -> void {
+    if (levels_.empty()) {
+      std::fill(slots.begin(), slots.end(), missing_slot);
+      return;
+    }
+
+    const auto& first = levels_.front();
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+      const auto pos = hash(keys[i].NodeID, 0) % first.num_bits;
+      __builtin_prefetch(bits_.data() + first.first_word + (pos / 64));
+      __builtin_prefetch(ranks_.data() + first.first_word + (pos / 64));
+    }
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+      slots[i] = position(keys[i].NodeID);
+      if (slots[i] < keys_.size()) {
+        __builtin_prefetch(keys_.data() + slots[i]);
+        __builtin_prefetch(slots_.data() + slots[i]);
+      }
+    }
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+      slots[i] = verify(slots[i], keys[i].NodeID);
+    }
+  }
+
+  [[nodiscard]] auto size() const -> std::size_t { return keys_.size(); }
+  [[nodiscard]] auto memory_bytes() const -> std::size_t {
+    return ((bits_.capacity() + ranks_.capacity()) * sizeof(std::uint64_t)) +
+           (keys_.capacity() * sizeof(NodeID)) +
+           (slots_.capacity() * sizeof(std::size_t)) +
+           (fallback_.size() * 2 * sizeof(std::uint64_t));
+  }
+
+  template <typename Fn>
+  auto for_each_array(Fn&& fn) const -> void {
+    fn(bits_.data(), bits_.size() * sizeof(std::uint64_t));
+    fn(ranks_.data(), ranks_.size() * sizeof(std::uint64_t));
+    fn(keys_.data(), keys_.size() * sizeof(NodeID));
+    fn(slots_.data(), slots_.size() * sizeof(std::size_t));
+  }
+
+  auto save(BinaryWriter& out) const -> void {
+    out.put_array<Level>(levels_);
+    out.put_array<std::uint64_t>(bits_);
+    out.put_array<std::uint64_t>(ranks_);
+    std::vector<NodeID> fallback_ids;
+    std::vector<std::size_t> fallback_positions;
+    for (const auto& [id, pos] : fallback_) {
+      fallback_ids.push_back(id);
+      fallback_positions.push_back(pos);
+    }
+    out.put_array<NodeID>(fallback_ids);
+    out.put_array<std::size_t>(fallback_positions);
+    out.put_array<NodeID>(keys_);
+    out.put_array<std::size_t>(slots_);
+  }
+
+  [[nodiscard]] static auto load(BinaryReader& in) -> PerfectHashIndex {
+    PerfectHashIndex index;
+    index.levels_ = in.get_array<Level>();
+    index.bits_ = in.get_array<std::uint64_t>();
+    index.ranks_ = in.get_array<std::uint64_t>();
+    const auto fallback_ids = in.get_array<NodeID>();
+    const auto fallback_positions = in.get_array<std::size_t>();
+    index.keys_ = in.get_array<NodeID>();
+    index.slots_ = in.get_array<std::size_t>();
+
+    if (fallback_ids.size() != fallback_positions.size() ||
+        index.keys_.size() != index.slots_.size() ||
+        index.bits_.size() != index.ranks_.size()) {
+      throw std::runtime_error("PerfectHashIndex: corrupt serialized index");
+    }
+    for (const auto& lvl : index.levels_) {
+      if (lvl.num_bits == 0 ||
+          lvl.first_word + (lvl.num_bits / 64) > index.bits_.size()) {
+        throw std::runtime_error("PerfectHashIndex: corrupt serialized index");
+      }
+    }
+    for (std::size_t i = 0; i < fallback_ids.size(); ++i) {
+      index.fallback_[fallback_ids[i]] = fallback_positions[i];
+    }
+    return index;
+  }
+
+ private:
+  struct Level {
+    std::size_t first_word;
+    std::size_t num_bits;
+  };
+
+  PerfectHashIndex() = default;
+
+  static constexpr std::size_t gamma = 2;
+  static constexpr std::size_t max_levels = 32;
+
+  // splitmix64 finalizer over a per-level seed
+  static auto hash(NodeID id, std::size_t level) -> std::uint64_t {
+    std::uint64_t x = id + ((level + 1) * 0x9E3779B97F4A7C15ULL);
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+  }
+
+  // Candidate position of `id`, or `missing_slot` if no level claims it
+  [[nodiscard]] auto position(NodeID id) const -> std::size_t {
+    for (std::size_t level = 0; level < levels_.size(); ++level) {
+      const auto& lvl = levels_[level];
+      const auto pos = hash(id, level) % lvl.num_bits;
+      const auto word = lvl.first_word + (pos / 64);
+      const auto bit = std::uint64_t{1} << (pos % 64);
+      if ((bits_[word] & bit) != 0) {
+        return ranks_[word] + std::popcount(bits_[word] & (bit - 1));
+      }
+    }
+    if (auto it = fallback_.find(id); it != fallback_.end()) {
+      return it->second;
+    }
+    return missing_slot;
+  }
+
+  [[nodiscard]] auto verify(std::size_t pos, NodeID id) const -> std::size_t {
+    return (pos < keys_.size() && keys_[pos] == id) ? slots_[pos]
+                                                    : missing_slot;
+  }
+
+  std::vector<Level> levels_;
+  std::vector<std::uint64_t> bits_;
+  std::vector<std::uint64_t> ranks_;  // Set bits before each word of `bits_`
+  std::unordered_map<NodeID, std::size_t> fallback_;  // Unplaced after levels
+  std::vector<NodeID> keys_;
+  std::vector<std::size_t> slots_;
+};
+
+class KeyIndex {
+ public:
+  using Impl =
+      std::variant<DenseIndex, HashIndex, EytzingerIndex, PerfectHashIndex>;
+
+  KeyIndex() : impl_(DenseIndex(0, 0)) {}
+  explicit KeyIndex(Impl&& impl) : impl_(std::move(impl)) {}
+
+  [[nodiscard]] auto find(const Key& key) const -> std::optional<std::size_t> {
+    const auto slot = std::visit(
+        [&](const auto& index) { return index.find(key.NodeID); }, impl_);
+    if (slot == missing_slot) {
+      return std::nullopt;
+    }
+    return slot;
+  }
+
+  auto find_batch(std::span<const Key> keys, std::span<std::size_t> slots) const
+      -> void {
+    std::visit([&](const auto& index) { index.find_batch(keys, slots); },
+               impl_);
+  }
+
+  // Resolves `keys` in chunks of `lookup_batch_size` and hands each chunk to
+  // `fn(first, slots)`, where `slots[i]` belongs to `keys[first + i]`
+  template <typename Fn>
+  auto for_each_slot(std::span<const Key> keys, Fn&& fn) const -> void {
+    std::array<std::size_t, lookup_batch_size> slots{};
+    for (std::size_t first = 0; first < keys.size();
+         first += lookup_batch_size) {
+      const auto n = std::min(lookup_batch_size, keys.size() - first);
+      const auto chunk = std::span(slots).first(n);
+      find_batch(keys.subspan(first, n), chunk);
+      fn(first, std::span<const std::size_t>(chunk));
+    }
+  }
+
+  [[nodiscard]] auto size() const -> std::size_t {
+    return std::visit([](const auto& index) { return index.size(); }, impl_);
+  }
+
+  [[nodiscard]] auto memory_bytes() const -> std::size_t {
+    return std::visit([](const auto& index) { return index.memory_bytes(); },
+                      impl_);
+  }
+
+  // Calls `fn(data, bytes)` on each flat array the lookups read, e.g. to
+  // advise it onto huge pages
+  template <typename Fn>
+  auto for_each_array(Fn&& fn) const -> void {
+    std::visit([&](const auto& index) { index.for_each_array(fn); }, impl_);
+  }
+
+  [[nodiscard]] auto kind() const -> std::string_view {
+    constexpr std::array<std::string_view, std::variant_size_v<Impl>> names{
+        "dense", "hash", "eytzinger", "perfect_hash"};
+    return names.at(impl_.index());
+  }
+
+  // Writes the variant tag followed by the index's own representation
+  auto save(BinaryWriter& out) const -> void {
+    out.put(static_cast<std::uint32_t>(impl_.index()));
+    std::visit([&](const auto& index) { index.save(out); }, impl_);
+  }
+
+  [[nodiscard]] static auto load(BinaryReader& in) -> KeyIndex {
+    switch (in.get<std::uint32_t>()) {
+      case 0:
+        return KeyIndex(DenseIndex::load(in));
+      case 1:
+        return KeyIndex(HashIndex::load(in));
+      case 2:
+        return KeyIndex(EytzingerIndex::load(in));
+      case 3:
+        return KeyIndex(PerfectHashIndex::load(in));
+      default:
+        throw std::runtime_error("KeyIndex: unknown serialized index kind");
+    }
+  }
+
+ private:
+  Impl impl_;
+};
+
+// Assigns slots in insertion order. Stays in dense mode (no per-key memory)
+// for as long as keys arrive as a contiguous ascending run, which is what
+// `ingest_features_from_csv` produces. On the first key that breaks the run
+// it switches to collecting (key, slot) pairs, from which `build` constructs
+// the sparse index selected by `kind`.
+class KeyIndexBuilder {
+ public:
+  explicit KeyIndexBuilder(IndexKind kind = IndexKind::Eytzinger)
+      : kind_(kind) {}
+
+  auto insert(const Key& key) -> std::size_t {
+    const auto slot = num_slots_++;
+
+    if (dense_) {
+      if (slot == 0) {
+        dense_base_ = key.NodeID;
+        return slot;
+      }
+      if (key.NodeID == dense_base_ + slot) {
+        return slot;
+      }
+      materialize_dense_run();
+    }
+
+    sparse_entries_.emplace_back(key.NodeID, slot);
+    return slot;
+  }
+
+  [[nodiscard]] auto num_slots() const -> std::size_t { return num_slots_; }
+
+  // Current (key, slot) pairs sorted by key, without the stale slots of
+  // re-inserted keys. Leaves dense mode, so only call it when about to
+  // `permute`.
+  [[nodiscard]] auto live_entries()
+      -> std::span<std::pair<NodeID, std::size_t>> {
+    if (dense_ && num_slots_ > 0) {
+      materialize_dense_run();
+      sparse_entries_.emplace_back(dense_base_ + num_slots_ - 1,
+                                   num_slots_ - 1);
+    }
+    keep_latest_entries();
+    return sparse_entries_;
+  }
+
+  // Moves the key at slot `old_slots[i]` to slot `i`. `old_slots` must be a
+  // permutation of the slots returned by `live_entries`; stale slots are
+  // dropped.
+  auto permute(std::span<const std::size_t> old_slots) -> void {
+    std::vector<std::size_t> new_slots(num_slots_, missing_slot);
+    for (std::size_t slot = 0; slot < old_slots.size(); ++slot) {
+      new_slots[old_slots[slot]] = slot;
+    }
+    for (auto& entry : live_entries()) {
+      entry.second = new_slots[entry.second];
+    }
+    num_slots_ = old_slots.size();
+  }
+
+  [[nodiscard]] auto build() && -> KeyIndex {
+    if (dense_) {
+      return KeyIndex(DenseIndex(dense_base_, num_slots_));
+    }
+
+    keep_latest_entries();
+    switch (kind_) {
+      case IndexKind::Hash:
+        return KeyIndex(HashIndex(sparse_entries_));
+      case IndexKind::PerfectHash:
+        return KeyIndex(PerfectHashIndex(sparse_entries_));
+      case IndexKind::Eytzinger:
+      default:
+        return KeyIndex(EytzingerIndex(sparse_entries_));
+    }
+  }
+
+ private:
+  // Record the dense run built so far (all slots but the newest)
+  auto materialize_dense_run() -> void {
+    dense_ = false;
+    sparse_entries_.reserve(num_slots_);
+    for (std::size_t slot = 0; slot + 1 < num_slots_; ++slot) {
+      sparse_entries_.emplace_back(dense_base_ + slot, slot);
+    }
+  }
+
+  // Sort by key and keep the most recent slot of any re-inserted key
+  auto keep_latest_entries() -> void {
+    std::ranges::stable_sort(sparse_entries_, {},
+                             [](const auto& entry) { return entry.first; });
+    auto last_of_each = std::ranges::unique(
+        sparse_entries_.rbegin(), sparse_entries_.rend(),
+        [](const auto& a, const auto& b) { return a.first == b.first; });
+    sparse_entries_.erase(sparse_entries_.begin(),
+                          last_of_each.begin().base());
+  }
+
+  const IndexKind kind_;
+  bool dense_{true};
+  NodeID dense_base_{0};
+  std::size_t num_slots_{0};
+  std::vector<std::pair<NodeID, std::size_t>> sparse_entries_;
+};
+
+}  // namespace ggb::detail
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "ggb/core.h"
+
+namespace ggb::detail {
+
+// Parts of a lookup timed by `StageClock`
+enum class Stage : std::size_t {
+  Index,  // Resolving keys to slots
+  Copy,   // Copying or decoding found rows into the output
+  Read,   // Waiting on explicit reads (DirectIo)
+};
+inline constexpr std::size_t num_stages = 3;
+
+// Per-lookup counts
+enum class Event : std::size_t {
+  Keys,         // Keys requested
+  MissingKeys,  // Keys not in the store
+  BytesCopied,  // Bytes written for found rows
+};
+inline constexpr std::size_t num_events = 3;
+
+inline constexpr std::array<std::string_view, num_stages> stage_names{
+    "lookup.index", "lookup.copy", "lookup.read"};
+inline constexpr std::array<std::string_view, num_events> event_names{
+    "lookup.keys", "lookup.missing_keys", "lookup.bytes_copied"};
+
+#ifdef GGB_ENABLE_METRICS
+
+// Lookup counters and stage timings of one store, sharded so that threads
+// add to their own cache lines: a thread keeps the shard it first touched,
+// and threads only share one past `num_shards` threads. Readers sum the
+// shards without stopping writers.
+class LookupMetrics {
+ public:
+  static constexpr std::size_t num_shards = 16;
+
+  // Counts a lookup of `keys` keys, `missing` of them absent, whose found
+  // rows took `row_bytes` each in the output
+  auto add_lookup(std::size_t keys, std::size_t missing, std::size_t row_bytes)
+      -> void {
+    auto& events = shard().events;
+    events[static_cast<std::size_t>(Event::Keys)].fetch_add(
+        keys, std::memory_order_relaxed);
+    events[static_cast<std::size_t>(Event::MissingKeys)].fetch_add(
+        missing, std::memory_order_relaxed);
+    events[static_cast<std::size_t>(Event::BytesCopied)].fetch_add(
+        (keys - missing) * row_bytes, std::memory_order_relaxed);
+  }
+
+  auto record(Stage stage, std::uint64_t ns) -> void {
+    auto& times = shard().stages[static_cast<std::size_t>(stage)];
+    times.count.fetch_add(1, std::memory_order_relaxed);
+    times.total_ns.fetch_add(ns, std::memory_order_relaxed);
+    times.buckets[ns == 0 ? 0 : std::bit_width(ns) - 1].fetch_add(
+        1, std::memory_order_relaxed);
+  }
+
+  // Adds the events and every stage timed so far to `metrics`
+  auto snapshot(Metrics& metrics) const -> void {
+    for (std::size_t e = 0; e < num_events; ++e) {
+      auto& total = metrics.counters[std::string(event_names[e])];
+      for (const auto& shard : shards_) {
+        total += shard.events[e].load(std::memory_order_relaxed);
+      }
+    }
+    for (std::size_t s = 0; s < num_stages; ++s) {
+      StageTimes total;
+      for (const auto& shard : shards_) {
+        const auto& times = shard.stages[s];
+        total.count += times.count.load(std::memory_order_relaxed);
+        total.total_ns += times.total_ns.load(std::memory_order_relaxed);
+        for (std::size_t b = 0; b < total.buckets.size(); ++b) {
+          total.buckets[b] += times.buckets[b].load(std::memory_order_relaxed);
+        }
+      }
+      if (total.count > 0) {
+        metrics.stages[std::string(stage_names[s])] = total;
+      }
+    }
+  }
+
+ private:
+  struct AtomicStageTimes {
+    std::atomic<std::uint64_t> count{0};
+    std::atomic<std::uint64_t> total_ns{0};
+    std::array<std::atomic<std::uint64_t>, StageTimes::num_buckets> buckets{};
+  };
+
+  struct alignas(64) Shard {
+    std::array<std::atomic<std::uint64_t>, num_events> events{};
+    std::array<AtomicStageTimes, num_stages> stages{};
+  };
+
+  auto shard() -> Shard& {
+    static std::atomic<std::size_t> next_thread{0};
+    thread_local const auto thread =
+        next_thread.fetch_add(1, std::memory_order_relaxed);
+    return shards_[thread % num_shards];
+  }
+
+  std::array<Shard, num_shards> shards_{};
+};
+
+// Splits the time since construction between stages: `lap(stage)` charges
+// the time since the previous lap to `stage`. The totals are recorded as
+// one sample per stage when the clock is destroyed, so timing the slots of
+// a `for_each_slot` pass costs two clock reads per chunk of keys.
+class StageClock {
+ public:
+  explicit StageClock(LookupMetrics& metrics)
+      : metrics_(metrics), last_(Clock::now()) {}
+
+  ~StageClock() {
+    for (std::size_t s = 0; s < num_stages; ++s) {
+      if (lapped_[s]) {
+        metrics_.record(static_cast<Stage>(s), totals_[s]);
+      }
+    }
+  }
+
+  StageClock(const StageClock&) = delete;
+  auto operator=(const StageClock&) -> StageClock& = delete;
+  StageClock(StageClock&&) = delete;
+  auto operator=(StageClock&&) -> StageClock& = delete;
+
+  auto lap(Stage stage) -> void {
+    const auto now = Clock::now();
+    const auto s = static_cast<std::size_t>(stage);
+    totals_[s] += static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(now - last_)
+            .count());
+    lapped_[s] = true;
+    last_ = now;
+  }
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  LookupMetrics& metrics_;
+  Clock::time_point last_;
+  std::array<std::uint64_t, num_stages> totals_{};
+  std::array<bool, num_stages> lapped_{};
+};
+
+#else
+
+// Built without GGB_WITH_METRICS: every call compiles to nothing
+class LookupMetrics {
+ public:
+  auto add_lookup([[maybe_unused]] std::size_t keys,
+                  [[maybe_unused]] std::size_t missing,
+                  [[maybe_unused]] std::size_t row_bytes) -> void {}
+  auto record([[maybe_unused]] Stage stage, [[maybe_unused]] std::uint64_t ns)
+      -> void {}
+  auto snapshot([[maybe_unused]] Metrics& metrics) const -> void {}
+};
+
+class StageClock {
+ public:
+  explicit StageClock([[maybe_unused]] LookupMetrics& metrics) {}
+  auto lap([[maybe_unused]] Stage stage) -> void {}
+};
+
+#endif
+
+}  // namespace ggb::detail
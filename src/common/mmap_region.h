@@ -3,21 +3,31 @@
 #include <fcntl.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/vfs.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <cerrno>
 #include <cstddef>
 #include <stdexcept>
 #include <string>
 #include <utility>
 
+#include "ggb/core.h"
 #include "logging.h"
+#include "page_buffer.h"
 
 namespace ggb::detail {
 
+// Read-only mapping of a whole file. With `huge_pages` set the mapping is
+// advised onto transparent huge pages, which the kernel honours on file
+// systems that support them for files; Explicit requires a hugetlbfs file
+// and falls back to Transparent otherwise.
 class MmapRegion {
  public:
-  explicit MmapRegion(std::string path) : path_(std::move(path)) {
+  explicit MmapRegion(std::string path,
+                      HugePages huge_pages = HugePages::None)
+      : path_(std::move(path)) {
     auto fd = open(path_.c_str(), O_RDONLY);
     if (fd == -1) {
       GGB_LOG_ERROR("Failed to open file: {}", path_);
@@ -38,12 +48,26 @@ class MmapRegion {
       return;
     }
 
-    data_ = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (huge_pages == HugePages::Explicit && !on_hugetlbfs(fd)) {
+      GGB_LOG_WARN("{} is not on hugetlbfs, using transparent huge pages",
+                   path_);
+      huge_pages = HugePages::Transparent;
+    }
+    // hugetlbfs maps whole huge pages only
+    mapped_bytes_ = huge_pages == HugePages::Explicit
+                        ? (size_ + huge_page_bytes - 1) / huge_page_bytes *
+                              huge_page_bytes
+                        : size_;
+    data_ = mmap(nullptr, mapped_bytes_, PROT_READ, MAP_PRIVATE, fd, 0);
     close(fd);
     if (!mmap_data_ptr_is_valid(data_)) {
       GGB_LOG_ERROR("MMap failed for {}, errno: {}", path_, errno);
       throw std::runtime_error("MmapRegion: mmap failed");
     }
+    // No MADV_COLLAPSE: on a file it would read the whole mapping in
+    if (huge_pages == HugePages::Transparent) {
+      advise(MADV_HUGEPAGE);
+    }
     GGB_LOG_DEBUG("Mapped {} ({:.4f} GB)", path_,
                   static_cast<double>(size_) / (1024 * 1024 * 1024));
   }
@@ -51,7 +75,7 @@ class MmapRegion {
   ~MmapRegion() {
     if (mmap_data_ptr_is_valid(data_)) {
       try {
-        munmap(data_, size_);
+        munmap(data_, mapped_bytes_);
         GGB_LOG_DEBUG("Unmapped {}", path_);
       } catch (...) {
         GGB_LOG_ERROR("Unmap failed for {}", path_);
@@ -67,6 +91,7 @@ class MmapRegion {
   auto operator=(MmapRegion&& other) noexcept -> MmapRegion& {
     std::swap(data_, other.data_);
     std::swap(size_, other.size_);
+    std::swap(mapped_bytes_, other.mapped_bytes_);
     std::swap(path_, other.path_);
     return *this;
   }
@@ -77,14 +102,31 @@ class MmapRegion {
     }
   }
 
+  // `offset` must be page aligned
+  auto advise(std::size_t offset, std::size_t length, int advice) const
+      -> void {
+    if (mmap_data_ptr_is_valid(data_) && offset < size_) {
+      madvise(static_cast<char*>(data_) + offset,
+              std::min(length, size_ - offset), advice);
+    }
+  }
+
   [[nodiscard]] auto data() const -> void* { return data_; }
   [[nodiscard]] auto size() const -> std::size_t { return size_; }
 
  private:
   std::string path_;
   std::size_t size_;
+  std::size_t mapped_bytes_{0};
   void* data_ = nullptr;
 
+  static auto on_hugetlbfs(int fd) -> bool {
+    constexpr long hugetlbfs_magic = 0x958458f6;
+    struct statfs fs {};
+    return fstatfs(fd, &fs) == 0 &&
+           static_cast<long>(fs.f_type) == hugetlbfs_magic;
+  }
+
   static auto mmap_data_ptr_is_valid(void* ptr) -> bool {
     return ptr != nullptr && ptr != MAP_FAILED;
   }
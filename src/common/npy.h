@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "common/logging.h"
+
+namespace ggb::detail {
+
+// Element types of .npy arrays the ingesters understand
+enum class NpyDtype : std::uint8_t { F32, F16 };
+
+// A C-ordered, little-endian 1-D or 2-D array inside a mapped .npy file.
+// 1-D arrays are read as a single column.
+struct NpyArray {
+  NpyDtype dtype{NpyDtype::F32};
+  std::size_t rows{0};
+  std::size_t cols{0};
+  std::span<const std::byte> data;
+
+  [[nodiscard]] auto element_bytes() const -> std::size_t {
+    return dtype == NpyDtype::F32 ? 4 : 2;
+  }
+
+  // Parses the header of the .npy format (versions 1 to 3) and validates that
+  // the data that follows has the announced size
+  [[nodiscard]] static auto parse(std::span<const std::byte> file,
+                                  const std::string& path) -> NpyArray {
+    constexpr std::string_view magic = "\x93NUMPY";
+    const auto fail = [&](std::string_view reason) -> NpyArray {
+      GGB_LOG_ERROR("Unsupported .npy file {}: {}", path, reason);
+      throw std::runtime_error("NpyArray: " + std::string(reason));
+    };
+
+    if (file.size() < magic.size() + 4 ||
+        std::memcmp(file.data(), magic.data(), magic.size()) != 0) {
+      return fail("bad magic");
+    }
+    const auto major = static_cast<std::uint8_t>(file[magic.size()]);
+    const auto* const len_ptr = file.data() + magic.size() + 2;
+    std::size_t prefix = magic.size() + 4;
+    std::size_t header_len = 0;
+    if (major == 1) {
+      header_len = static_cast<std::size_t>(len_ptr[0]) |
+                   (static_cast<std::size_t>(len_ptr[1]) << 8);
+    } else if (major == 2 || major == 3) {
+      if (file.size() < magic.size() + 6) {
+        return fail("truncated header");
+      }
+      for (int i = 3; i >= 0; --i) {
+        header_len = (header_len << 8) | static_cast<std::size_t>(len_ptr[i]);
+      }
+      prefix += 2;
+    } else {
+      return fail("unknown version");
+    }
+    if (file.size() < prefix + header_len) {
+      return fail("truncated header");
+    }
+    const std::string_view header(
+        reinterpret_cast<const char*>(file.data() + prefix), header_len);
+
+    NpyArray array;
+    // e.g. '<f4', the quotes included
+    auto descr = dict_value(header, "descr");
+    descr = descr.substr(0, descr.find('\'', 1) + 1);
+    if (descr.find("f4") != std::string_view::npos) {
+      array.dtype = NpyDtype::F32;
+    } else if (descr.find("f2") != std::string_view::npos) {
+      array.dtype = NpyDtype::F16;
+    } else {
+      return fail("dtype is not float32 or float16");
+    }
+    if (descr.find('>') != std::string_view::npos) {
+      return fail("big-endian data");
+    }
+    if (dict_value(header, "fortran_order").starts_with("True")) {
+      return fail("Fortran order");
+    }
+
+    // "(rows,)" or "(rows, cols)"
+    auto shape = dict_value(header, "shape");
+    std::size_t dims[2] = {0, 1};
+    std::size_t num_dims = 0;
+    for (std::size_t i = 0; i < shape.size() && shape[i] != ')'; ++i) {
+      if (shape[i] < '0' || shape[i] > '9') {
+        continue;
+      }
+      if (num_dims == 2) {
+        return fail("more than two dimensions");
+      }
+      std::size_t value = 0;
+      while (i < shape.size() && shape[i] >= '0' && shape[i] <= '9') {
+        value = (value * 10) + static_cast<std::size_t>(shape[i++] - '0');
+      }
+      dims[num_dims++] = value;
+      // The loop's ++i would step over the closing paren into later keys
+      if (i < shape.size() && shape[i] == ')') {
+        break;
+      }
+    }
+    if (num_dims == 0) {
+      return fail("scalar array");
+    }
+    array.rows = dims[0];
+    array.cols = dims[1];
+
+    const auto data_bytes = array.rows * array.cols * array.element_bytes();
+    if (file.size() - (prefix + header_len) < data_bytes) {
+      return fail("truncated data");
+    }
+    array.data = file.subspan(prefix + header_len, data_bytes);
+    return array;
+  }
+
+ private:
+  // Text following `'key':` in the header dict, up to the end of the dict
+  static auto dict_value(std::string_view header, std::string_view key)
+      -> std::string_view {
+    const auto quoted = "'" + std::string(key) + "'";
+    auto pos = header.find(quoted);
+    if (pos == std::string_view::npos) {
+      return {};
+    }
+    pos = header.find(':', pos + quoted.size());
+    if (pos == std::string_view::npos) {
+      return {};
+    }
+    pos = header.find_first_not_of(' ', pos + 1);
+    return pos == std::string_view::npos ? std::string_view{}
+                                         : header.substr(pos);
+  }
+};
+
+}  // namespace ggb::detail
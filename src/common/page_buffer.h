@@ -0,0 +1,195 @@
+#pragma once
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#include "ggb/core.h"
+#include "logging.h"
+
+namespace ggb::detail {
+
+inline constexpr std::size_t huge_page_bytes = std::size_t{2} << 20;
+
+// Asks for transparent huge pages on the whole 2 MiB pages inside
+// `[data, data + bytes)`, then tries to collapse the ones already resident
+// (MADV_COLLAPSE, Linux 6.1+). Best effort; returns whether the advice took.
+inline auto advise_huge_pages(const void* data, std::size_t bytes) -> bool {
+  const auto addr = reinterpret_cast<std::uintptr_t>(data);
+  const auto begin = (addr + huge_page_bytes - 1) / huge_page_bytes *
+                     huge_page_bytes;
+  const auto end = (addr + bytes) / huge_page_bytes * huge_page_bytes;
+  if (end <= begin) {
+    return false;
+  }
+  auto* ptr = reinterpret_cast<void*>(begin);
+  if (madvise(ptr, end - begin, MADV_HUGEPAGE) != 0) {
+    GGB_LOG_DEBUG("madvise(MADV_HUGEPAGE) failed, errno: {}", errno);
+    return false;
+  }
+#ifdef MADV_COLLAPSE
+  madvise(ptr, end - begin, MADV_COLLAPSE);
+#endif
+  return true;
+}
+
+// Growable, zero-filled anonymous mapping, optionally backed by huge pages,
+// in which case it starts on a 2 MiB boundary. Growth remaps the pages
+// rather than copying them, except on hugetlbfs pages, which cannot be
+// remapped. Move-only.
+class PageBuffer {
+ public:
+  explicit PageBuffer(HugePages huge_pages = HugePages::None)
+      : huge_pages_(huge_pages) {}
+
+  ~PageBuffer() {
+    if (data_ != nullptr) {
+      munmap(data_, capacity_);
+    }
+  }
+
+  PageBuffer(const PageBuffer&) = delete;
+  auto operator=(const PageBuffer&) -> PageBuffer& = delete;
+
+  PageBuffer(PageBuffer&& other) noexcept { *this = std::move(other); }
+
+  auto operator=(PageBuffer&& other) noexcept -> PageBuffer& {
+    std::swap(data_, other.data_);
+    std::swap(size_, other.size_);
+    std::swap(capacity_, other.capacity_);
+    std::swap(huge_pages_, other.huge_pages_);
+    return *this;
+  }
+
+  // Grows the mapping to hold at least `bytes`; contents are kept
+  auto reserve(std::size_t bytes) -> void {
+    if (bytes <= capacity_) {
+      return;
+    }
+    const auto capacity = round_to_pages(bytes);
+    if (data_ == nullptr) {
+      data_ = map(capacity);
+    } else if (huge_pages_ == HugePages::Explicit) {
+      auto* grown = map(capacity);
+      std::memcpy(grown, data_, size_);
+      munmap(data_, capacity_);
+      data_ = grown;
+    } else if (huge_pages_ == HugePages::Transparent) {
+      // A plain MREMAP_MAYMOVE may land anywhere, so the pages are moved
+      // onto a fresh aligned mapping, which MREMAP_FIXED replaces
+      auto* target = map(capacity);
+      if (mremap(data_, capacity_, capacity, MREMAP_MAYMOVE | MREMAP_FIXED,
+                 target) == MAP_FAILED) {
+        GGB_LOG_ERROR("mremap to {} bytes failed, errno: {}", capacity, errno);
+        munmap(target, capacity);
+        throw std::runtime_error("PageBuffer: mremap failed");
+      }
+      data_ = target;
+    } else {
+      auto* grown = mremap(data_, capacity_, capacity, MREMAP_MAYMOVE);
+      if (grown == MAP_FAILED) {
+        GGB_LOG_ERROR("mremap to {} bytes failed, errno: {}", capacity, errno);
+        throw std::runtime_error("PageBuffer: mremap failed");
+      }
+      data_ = static_cast<std::byte*>(grown);
+    }
+    capacity_ = capacity;
+  }
+
+  // Sets the size in use, at least doubling the capacity when it grows so
+  // that appends are amortized
+  auto resize(std::size_t bytes) -> void {
+    if (bytes > capacity_) {
+      reserve(std::max(bytes, 2 * capacity_));
+    }
+    size_ = bytes;
+  }
+
+  // Unmaps the whole pages past `size()`
+  auto shrink_to_fit() -> void {
+    const auto capacity = round_to_pages(size_);
+    if (capacity >= capacity_) {
+      return;
+    }
+    munmap(data_ + capacity, capacity_ - capacity);
+    if (capacity == 0) {
+      data_ = nullptr;
+    }
+    capacity_ = capacity;
+  }
+
+  [[nodiscard]] auto data() -> std::byte* { return data_; }
+  [[nodiscard]] auto data() const -> const std::byte* { return data_; }
+  [[nodiscard]] auto size() const -> std::size_t { return size_; }
+  [[nodiscard]] auto capacity() const -> std::size_t { return capacity_; }
+
+  // Pages actually in use, after any fallback from Explicit
+  [[nodiscard]] auto huge_pages() const -> HugePages { return huge_pages_; }
+
+ private:
+  [[nodiscard]] auto round_to_pages(std::size_t bytes) const -> std::size_t {
+    const auto page = huge_pages_ == HugePages::None
+                          ? static_cast<std::size_t>(sysconf(_SC_PAGESIZE))
+                          : huge_page_bytes;
+    return (bytes + page - 1) / page * page;
+  }
+
+  // Falls back from Explicit to Transparent when no hugetlbfs pages are
+  // reserved (see /proc/sys/vm/nr_hugepages). Huge page mappings start on a
+  // 2 MiB boundary, as only aligned 2 MiB ranges can be backed by one.
+  auto map(std::size_t bytes) -> std::byte* {
+    if (huge_pages_ == HugePages::Explicit) {
+      auto* ptr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+      if (ptr != MAP_FAILED) {
+        return static_cast<std::byte*>(ptr);
+      }
+      GGB_LOG_WARN(
+          "No hugetlbfs pages for {} bytes (errno: {}), using transparent "
+          "huge pages",
+          bytes, errno);
+      huge_pages_ = HugePages::Transparent;
+    }
+    // Transparent mappings take one huge page of slack to align within
+    const auto slack =
+        huge_pages_ == HugePages::Transparent ? huge_page_bytes : 0;
+    auto* ptr = mmap(nullptr, bytes + slack, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) {
+      GGB_LOG_ERROR("mmap of {} bytes failed, errno: {}", bytes, errno);
+      throw std::runtime_error("PageBuffer: mmap failed");
+    }
+    auto* data = static_cast<std::byte*>(ptr);
+    if (slack > 0) {
+      const auto addr = reinterpret_cast<std::uintptr_t>(ptr);
+      const auto head = ((addr + slack - 1) / slack * slack) - addr;
+      if (head > 0) {
+        munmap(data, head);
+      }
+      if (head < slack) {
+        munmap(data + head + bytes, slack - head);
+      }
+      data += head;
+    }
+    // Before the first touch, so pages fault in huge from the start
+    if (huge_pages_ == HugePages::Transparent &&
+        madvise(data, bytes, MADV_HUGEPAGE) != 0) {
+      GGB_LOG_DEBUG("madvise(MADV_HUGEPAGE) failed, errno: {}", errno);
+    }
+    return data;
+  }
+
+  std::byte* data_{nullptr};
+  std::size_t size_{0};
+  std::size_t capacity_{0};
+  HugePages huge_pages_{HugePages::None};
+};
+
+}  // namespace ggb::detail
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace ggb::detail {
+
+// A found row of a batch: where it is stored, and where its result goes
+struct RowRef {
+  std::size_t slot;
+  std::size_t position;
+};
+
+// One contiguous, aligned read serving `rows[first, first + count)`
+struct RowRange {
+  std::uint64_t offset;
+  std::size_t length;
+  std::size_t first;
+  std::size_t count;
+};
+
+// Plans the reads of rows of `row_bytes` stored at `data_offset + slot *
+// row_bytes`, each widened to `alignment`. With `max_range_bytes > 0`, `rows`
+// are sorted into file order and rows whose extents touch or overlap share a
+// range of at most `max_range_bytes`, so repeated slots are read once. A row
+// larger than that still gets a range of its own. With 0, every row is read
+// on its own, in request order.
+inline auto plan_reads(std::span<RowRef> rows, std::uint64_t data_offset,
+                       std::size_t row_bytes, std::size_t alignment,
+                       std::size_t max_range_bytes) -> std::vector<RowRange> {
+  if (max_range_bytes > 0) {
+    std::ranges::sort(rows, {}, &RowRef::slot);
+  }
+
+  std::vector<RowRange> ranges;
+  for (std::size_t i = 0; i < rows.size(); ++i) {
+    const auto offset = data_offset + (rows[i].slot * row_bytes);
+    const auto start = offset / alignment * alignment;
+    const auto end =
+        (offset + row_bytes + alignment - 1) / alignment * alignment;
+    if (max_range_bytes > 0 && !ranges.empty()) {
+      auto& last = ranges.back();
+      const auto merged_end = std::max(end, last.offset + last.length);
+      if (start <= last.offset + last.length &&
+          merged_end - last.offset <= max_range_bytes) {
+        last.length = merged_end - last.offset;
+        ++last.count;
+        continue;
+      }
+    }
+    ranges.push_back(
+        {.offset = start, .length = end - start, .first = i, .count = 1});
+  }
+  return ranges;
+}
+
+}  // namespace ggb::detail
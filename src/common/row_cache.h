@@ -0,0 +1,322 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "ggb/core.h"
+
+namespace ggb::detail {
+
+// Replacement policies track entries of a fixed-size pool by index. A shard
+// calls `on_admit` for every filled entry, `on_hit` on every hit, and
+// `evict` only once the pool is full.
+
+class ClockPolicy {
+ public:
+  explicit ClockPolicy(std::size_t capacity) : referenced_(capacity, 0) {}
+
+  auto on_hit(std::uint32_t entry) -> void { referenced_[entry] = 1; }
+  auto on_admit(std::uint32_t entry, NodeID) -> void {
+    referenced_[entry] = 0;
+  }
+
+  auto evict(std::span<const NodeID>) -> std::uint32_t {
+    while (referenced_[hand_] != 0) {
+      referenced_[hand_] = 0;
+      advance();
+    }
+    const auto victim = hand_;
+    advance();
+    return victim;
+  }
+
+ private:
+  auto advance() -> void {
+    hand_ = (hand_ + 1 == referenced_.size()) ? 0 : hand_ + 1;
+  }
+
+  std::vector<std::uint8_t> referenced_;
+  std::uint32_t hand_{0};
+};
+
+// Intrusive doubly linked list over entry indices, most recent first
+class LruPolicy {
+ public:
+  explicit LruPolicy(std::size_t capacity)
+      : sentinel_(static_cast<std::uint32_t>(capacity)),
+        prev_(capacity + 1, sentinel_),
+        next_(capacity + 1, sentinel_) {}
+
+  auto on_hit(std::uint32_t entry) -> void {
+    unlink(entry);
+    push_front(entry);
+  }
+  auto on_admit(std::uint32_t entry, NodeID) -> void { push_front(entry); }
+
+  auto evict(std::span<const NodeID>) -> std::uint32_t {
+    const auto victim = prev_[sentinel_];
+    unlink(victim);
+    return victim;
+  }
+
+ private:
+  auto unlink(std::uint32_t entry) -> void {
+    next_[prev_[entry]] = next_[entry];
+    prev_[next_[entry]] = prev_[entry];
+  }
+
+  auto push_front(std::uint32_t entry) -> void {
+    prev_[entry] = sentinel_;
+    next_[entry] = next_[sentinel_];
+    prev_[next_[sentinel_]] = entry;
+    next_[sentinel_] = entry;
+  }
+
+  std::uint32_t sentinel_;
+  std::vector<std::uint32_t> prev_;
+  std::vector<std::uint32_t> next_;
+};
+
+// S3-FIFO (Yang et al., SOSP '23). New rows enter a small FIFO holding ~10%
+// of the entries; rows re-read while there are promoted to the main FIFO,
+// the rest are evicted and remembered in a ghost list. A ghost hit admits
+// straight into main, so one-off reads of a sampled batch never displace the
+// working set.
+class S3FifoPolicy {
+ public:
+  explicit S3FifoPolicy(std::size_t capacity)
+      : small_capacity_(std::max<std::size_t>(1, capacity / 10)),
+        ghost_capacity_(capacity - std::min(capacity, small_capacity_)),
+        freq_(capacity, 0) {}
+
+  auto on_hit(std::uint32_t entry) -> void {
+    freq_[entry] = std::min<std::uint8_t>(freq_[entry] + 1, max_freq);
+  }
+
+  auto on_admit(std::uint32_t entry, NodeID id) -> void {
+    freq_[entry] = 0;
+    if (ghost_.erase(id) > 0) {
+      main_.push_back(entry);
+    } else {
+      small_.push_back(entry);
+    }
+  }
+
+  auto evict(std::span<const NodeID> keys) -> std::uint32_t {
+    while (true) {
+      if (small_.size() >= small_capacity_ || main_.empty()) {
+        const auto entry = small_.front();
+        small_.pop_front();
+        if (freq_[entry] > 1) {
+          freq_[entry] = 0;
+          main_.push_back(entry);
+          continue;
+        }
+        remember(keys[entry]);
+        return entry;
+      }
+
+      const auto entry = main_.front();
+      main_.pop_front();
+      if (freq_[entry] > 0) {
+        --freq_[entry];
+        main_.push_back(entry);
+        continue;
+      }
+      return entry;
+    }
+  }
+
+ private:
+  static constexpr std::uint8_t max_freq = 3;
+
+  auto remember(NodeID id) -> void {
+    if (ghost_capacity_ == 0) {
+      return;
+    }
+    ghost_[id] = ++ghost_seq_;
+    ghost_fifo_.emplace_back(id, ghost_seq_);
+    // Expire the oldest ghosts; a stale FIFO record of a key that was
+    // remembered again later must not drop the newer entry
+    while (ghost_fifo_.size() > ghost_capacity_) {
+      const auto [old_id, seq] = ghost_fifo_.front();
+      ghost_fifo_.pop_front();
+      const auto it = ghost_.find(old_id);
+      if (it != ghost_.end() && it->second == seq) {
+        ghost_.erase(it);
+      }
+    }
+  }
+
+  std::size_t small_capacity_;
+  std::size_t ghost_capacity_;
+  std::vector<std::uint8_t> freq_;
+  std::deque<std::uint32_t> small_;
+  std::deque<std::uint32_t> main_;
+  std::unordered_map<NodeID, std::uint64_t> ghost_;
+  std::deque<std::pair<NodeID, std::uint64_t>> ghost_fifo_;
+  std::uint64_t ghost_seq_{0};
+};
+
+// Fixed-budget cache of feature rows keyed by node. Keys are spread over
+// independently locked shards, each owning a preallocated pool of rows, so
+// concurrent batches only contend when they touch the same shard.
+class RowCache {
+ public:
+  struct Stats {
+    std::uint64_t hits{0};
+    std::uint64_t misses{0};
+    std::uint64_t insertions{0};
+    std::uint64_t evictions{0};
+  };
+
+  // Holds up to `capacity_bytes` of rows, but never more than `max_rows`
+  // since a cache larger than the store it fronts is wasted memory
+  RowCache(std::size_t capacity_bytes, std::size_t tensor_size,
+           CachePolicy policy, std::size_t num_shards,
+           std::size_t max_rows = SIZE_MAX)
+      : tensor_size_(tensor_size) {
+    const auto row_bytes = tensor_size * sizeof(float);
+    const auto capacity =
+        row_bytes == 0 ? 0 : std::min(max_rows, capacity_bytes / row_bytes);
+    num_shards = std::clamp<std::size_t>(num_shards, 1,
+                                         std::max<std::size_t>(1, capacity));
+
+    shards_.reserve(num_shards);
+    for (std::size_t i = 0; i < num_shards; ++i) {
+      // Spread the remainder over the first shards
+      const auto rows = (capacity / num_shards) + (i < capacity % num_shards);
+      shards_.push_back(std::make_unique<Shard>(rows, tensor_size, policy));
+    }
+  }
+
+  // Copies the cached row of `key` into `dst` and returns true on a hit
+  auto lookup(const Key& key, float* dst) -> bool {
+    auto& shard = shard_of(key);
+    const std::lock_guard lock(shard.mutex);
+    const auto it = shard.entries.find(key.NodeID);
+    if (it == shard.entries.end()) {
+      ++shard.stats.misses;
+      return false;
+    }
+    ++shard.stats.hits;
+    std::visit([&](auto& policy) { policy.on_hit(it->second); },
+               shard.policy);
+    std::copy_n(shard.row(it->second), tensor_size_, dst);
+    return true;
+  }
+
+  // Whether `key` is cached, without counting a lookup or touching recency
+  [[nodiscard]] auto contains(const Key& key) -> bool {
+    auto& shard = shard_of(key);
+    const std::lock_guard lock(shard.mutex);
+    return shard.entries.contains(key.NodeID);
+  }
+
+  // Admits the row of `key`, evicting another row if the shard is full
+  auto insert(const Key& key, const float* row) -> void {
+    auto& shard = shard_of(key);
+    const std::lock_guard lock(shard.mutex);
+    if (shard.capacity == 0 || shard.entries.contains(key.NodeID)) {
+      return;
+    }
+
+    std::uint32_t entry = 0;
+    if (shard.keys.size() < shard.capacity) {
+      entry = static_cast<std::uint32_t>(shard.keys.size());
+      shard.keys.push_back(key.NodeID);
+    } else {
+      entry = std::visit(
+          [&](auto& policy) { return policy.evict(shard.keys); },
+          shard.policy);
+      shard.entries.erase(shard.keys[entry]);
+      shard.keys[entry] = key.NodeID;
+      ++shard.stats.evictions;
+    }
+
+    ++shard.stats.insertions;
+    shard.entries.emplace(key.NodeID, entry);
+    std::copy_n(row, tensor_size_, shard.row(entry));
+    std::visit([&](auto& policy) { policy.on_admit(entry, key.NodeID); },
+               shard.policy);
+  }
+
+  [[nodiscard]] auto stats() const -> Stats {
+    Stats total;
+    for (const auto& shard : shards_) {
+      const std::lock_guard lock(shard->mutex);
+      total.hits += shard->stats.hits;
+      total.misses += shard->stats.misses;
+      total.insertions += shard->stats.insertions;
+      total.evictions += shard->stats.evictions;
+    }
+    return total;
+  }
+
+  [[nodiscard]] auto capacity() const -> std::size_t {
+    std::size_t rows = 0;
+    for (const auto& shard : shards_) {
+      rows += shard->capacity;
+    }
+    return rows;
+  }
+
+ private:
+  using Policy = std::variant<ClockPolicy, S3FifoPolicy, LruPolicy>;
+
+  struct Shard {
+    Shard(std::size_t num_rows, std::size_t row_size, CachePolicy kind)
+        : capacity(num_rows),
+          tensor_size(row_size),
+          rows(num_rows * row_size),
+          policy(make_policy(kind, num_rows)) {
+      keys.reserve(num_rows);
+      entries.reserve(num_rows);
+    }
+
+    auto row(std::uint32_t entry) -> float* {
+      return rows.data() + (entry * tensor_size);
+    }
+
+    mutable std::mutex mutex;
+    const std::size_t capacity;
+    const std::size_t tensor_size;
+    std::unordered_map<NodeID, std::uint32_t> entries;
+    std::vector<NodeID> keys;  // Key of each filled entry
+    std::vector<float> rows;
+    Policy policy;
+    Stats stats;
+  };
+
+  static auto make_policy(CachePolicy kind, std::size_t rows) -> Policy {
+    switch (kind) {
+      case CachePolicy::Clock:
+        return ClockPolicy(rows);
+      case CachePolicy::Lru:
+        return LruPolicy(rows);
+      case CachePolicy::S3Fifo:
+      default:
+        return S3FifoPolicy(rows);
+    }
+  }
+
+  // Fibonacci hashing, so strided node ids still spread across shards
+  auto shard_of(const Key& key) -> Shard& {
+    const auto hash = key.NodeID * 0x9E3779B97F4A7C15ULL;
+    return *shards_[(hash >> 32) % shards_.size()];
+  }
+
+  std::size_t tensor_size_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+}  // namespace ggb::detail
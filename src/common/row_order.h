@@ -0,0 +1,142 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <numeric>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "ggb/core.h"
+
+namespace ggb::detail {
+
+// Undirected adjacency over the live rows of a store, in compressed sparse
+// row form. Vertex `v` is `entries[v]` of the (key-sorted) entries it was
+// built from; edges whose endpoints are not stored are skipped.
+class RowGraph {
+ public:
+  RowGraph(std::span<const std::pair<NodeID, std::size_t>> entries,
+           const GraphTopology& graph)
+      : offsets_(entries.size() + 1, 0) {
+    const auto vertex_of = [&](NodeID id) -> std::optional<std::size_t> {
+      const auto it = std::ranges::lower_bound(
+          entries, id, {}, [](const auto& entry) { return entry.first; });
+      if (it == entries.end() || it->first != id) {
+        return std::nullopt;
+      }
+      return static_cast<std::size_t>(it - entries.begin());
+    };
+
+    std::vector<std::pair<std::size_t, std::size_t>> edges;
+    edges.reserve(graph.edges.size());
+    for (const auto& [src, dst] : graph.edges) {
+      const auto u = vertex_of(src);
+      const auto v = vertex_of(dst);
+      if (u && v && *u != *v) {
+        edges.emplace_back(*u, *v);
+        ++offsets_[*u + 1];
+        ++offsets_[*v + 1];
+      }
+    }
+
+    std::partial_sum(offsets_.begin(), offsets_.end(), offsets_.begin());
+    neighbours_.resize(offsets_.back());
+    auto next = offsets_;
+    for (const auto& [u, v] : edges) {
+      neighbours_[next[u]++] = v;
+      neighbours_[next[v]++] = u;
+    }
+  }
+
+  [[nodiscard]] auto num_vertices() const -> std::size_t {
+    return offsets_.size() - 1;
+  }
+  [[nodiscard]] auto degree(std::size_t v) const -> std::size_t {
+    return offsets_[v + 1] - offsets_[v];
+  }
+  [[nodiscard]] auto neighbours(std::size_t v) const
+      -> std::span<const std::size_t> {
+    return std::span(neighbours_).subspan(offsets_[v], degree(v));
+  }
+
+ private:
+  std::vector<std::size_t> offsets_;
+  std::vector<std::size_t> neighbours_;
+};
+
+// Vertices by descending degree. `order` starts out in insertion order,
+// which breaks ties.
+[[nodiscard]] inline auto degree_order(const RowGraph& graph,
+                                       std::vector<std::size_t> order)
+    -> std::vector<std::size_t> {
+  std::ranges::stable_sort(order, std::greater{},
+                           [&](auto v) { return graph.degree(v); });
+  return order;
+}
+
+// Reverse Cuthill-McKee: a BFS from a low-degree vertex of each component,
+// visiting neighbours in ascending degree, then reversed. Nodes a few hops
+// apart end up a few rows apart.
+[[nodiscard]] inline auto rcm_order(const RowGraph& graph,
+                                    std::vector<std::size_t> starts)
+    -> std::vector<std::size_t> {
+  const auto n = graph.num_vertices();
+  std::ranges::stable_sort(starts, {}, [&](auto v) { return graph.degree(v); });
+
+  std::vector<std::size_t> order;
+  order.reserve(n);
+  std::vector<bool> visited(n, false);
+  for (const auto start : starts) {
+    if (visited[start]) {
+      continue;
+    }
+    visited[start] = true;
+    order.push_back(start);
+
+    // `order` doubles as the BFS queue
+    for (auto head = order.size() - 1; head < order.size(); ++head) {
+      const auto first_child = order.size();
+      for (const auto v : graph.neighbours(order[head])) {
+        if (!visited[v]) {
+          visited[v] = true;
+          order.push_back(v);
+        }
+      }
+      std::stable_sort(
+          order.begin() + static_cast<std::ptrdiff_t>(first_child), order.end(),
+          [&](auto a, auto b) { return graph.degree(a) < graph.degree(b); });
+    }
+  }
+  std::ranges::reverse(order);
+  return order;
+}
+
+// Plans the physical row layout for `order`. `entries` are the live
+// (key, slot) pairs sorted by key, as returned by
+// `KeyIndexBuilder::live_entries`. Returns the old slot of every new slot.
+[[nodiscard]] inline auto plan_row_order(
+    RowOrder order, std::span<const std::pair<NodeID, std::size_t>> entries,
+    const GraphTopology& graph) -> std::vector<std::size_t> {
+  std::vector<std::size_t> vertices(entries.size());
+  std::iota(vertices.begin(), vertices.end(), std::size_t{0});
+  std::ranges::sort(vertices, {}, [&](auto v) { return entries[v].second; });
+
+  if (order != RowOrder::Insertion) {
+    const RowGraph row_graph(entries, graph);
+    vertices = (order == RowOrder::Degree)
+                   ? degree_order(row_graph, std::move(vertices))
+                   : rcm_order(row_graph, std::move(vertices));
+  }
+
+  std::vector<std::size_t> old_slots;
+  old_slots.reserve(vertices.size());
+  for (const auto v : vertices) {
+    old_slots.push_back(entries[v].second);
+  }
+  return old_slots;
+}
+
+}  // namespace ggb::detail
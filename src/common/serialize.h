@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace ggb::detail {
+
+// Minimal native-endian binary (de)serialization for trivially copyable
+// values and arrays. Arrays are written as a u64 element count followed by
+// the raw elements, so they can be read back with a single memcpy.
+
+class BinaryWriter {
+ public:
+  explicit BinaryWriter(std::ostream& out) : out_(out) {}
+
+  template <typename T>
+    requires std::is_trivially_copyable_v<T>
+  auto put(const T& value) -> void {
+    write(&value, sizeof(T));
+  }
+
+  template <typename T>
+    requires std::is_trivially_copyable_v<T>
+  auto put_array(std::span<const T> values) -> void {
+    put(static_cast<std::uint64_t>(values.size()));
+    write(values.data(), values.size_bytes());
+  }
+
+  [[nodiscard]] auto bytes_written() const -> std::size_t {
+    return bytes_written_;
+  }
+
+ private:
+  auto write(const void* data, std::size_t num_bytes) -> void {
+    out_.write(static_cast<const char*>(data),
+               static_cast<std::streamsize>(num_bytes));
+    bytes_written_ += num_bytes;
+  }
+
+  std::ostream& out_;
+  std::size_t bytes_written_{0};
+};
+
+class BinaryReader {
+ public:
+  explicit BinaryReader(std::span<const std::byte> in) : in_(in) {}
+
+  template <typename T>
+    requires std::is_trivially_copyable_v<T>
+  [[nodiscard]] auto get() -> T {
+    T value;
+    std::memcpy(&value, take(sizeof(T)).data(), sizeof(T));
+    return value;
+  }
+
+  template <typename T>
+    requires std::is_trivially_copyable_v<T>
+  [[nodiscard]] auto get_array() -> std::vector<T> {
+    const auto count = get<std::uint64_t>();
+    if (count > in_.size() / sizeof(T)) {
+      throw std::runtime_error("BinaryReader: array length exceeds input");
+    }
+    std::vector<T> values(count);
+    std::memcpy(values.data(), take(count * sizeof(T)).data(),
+                count * sizeof(T));
+    return values;
+  }
+
+ private:
+  auto take(std::size_t num_bytes) -> std::span<const std::byte> {
+    if (num_bytes > in_.size()) {
+      throw std::runtime_error("BinaryReader: unexpected end of input");
+    }
+    auto head = in_.first(num_bytes);
+    in_ = in_.subspan(num_bytes);
+    return head;
+  }
+
+  std::span<const std::byte> in_;
+};
+
+}  // namespace ggb::detail
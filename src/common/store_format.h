@@ -0,0 +1,94 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string>
+
+#include "common/logging.h"
+#include "ggb/core.h"
+
+namespace ggb::detail {
+
+// On-disk layout of a FlatMmap store (native little-endian):
+//
+//   [0, data_offset)                 StoreHeader, zero padded
+//   [data_offset, +data_bytes)       rows of `dtype`, `slot * row_bytes` apart
+//   [index_offset, +index_bytes)     serialized KeyIndex
+//   [hot_offset, +hot_bytes)         slots of the hot row cache, optional
+//
+// `data_offset` is a multiple of `alignment` (a page), so the data section
+// can be mapped and read with O_DIRECT without copying.
+
+inline constexpr std::array<char, 8> store_magic{'G', 'G', 'B', 'F',
+                                                 'L', 'A', 'T', '\0'};
+inline constexpr std::uint32_t store_format_version = 1;
+inline constexpr std::size_t store_alignment = 4096;
+
+struct StoreHeader {
+  std::array<char, 8> magic{store_magic};
+  std::uint32_t version{store_format_version};
+  StorageDType dtype{StorageDType::F32};
+  std::uint64_t dim{0};        // Elements per row, 0 for an empty store
+  std::uint64_t num_rows{0};   // Rows in the data section
+  std::uint64_t alignment{store_alignment};
+  std::uint64_t data_offset{store_alignment};
+  std::uint64_t data_bytes{0};
+  std::uint64_t index_offset{0};
+  std::uint64_t index_bytes{0};
+  std::uint64_t hot_offset{0};
+  std::uint64_t hot_bytes{0};  // 0 when the store has no hot row cache
+
+  [[nodiscard]] auto row_bytes() const -> std::size_t {
+    return storage_row_bytes(dtype, dim);
+  }
+
+  // Parses and validates the header at the start of a mapped store file
+  [[nodiscard]] static auto read(std::span<const std::byte> file,
+                                 const std::string& path) -> StoreHeader {
+    return parse(file, file.size(), path);
+  }
+
+  // Parses and validates the header from the first bytes of a store file
+  // of `file_size` bytes
+  [[nodiscard]] static auto parse(std::span<const std::byte> head,
+                                  std::size_t file_size,
+                                  const std::string& path) -> StoreHeader {
+    StoreHeader header;
+    if (head.size() < sizeof(StoreHeader)) {
+      GGB_LOG_ERROR("File too small to be a GGB store: {}", path);
+      throw std::runtime_error("StoreHeader: truncated header");
+    }
+    std::memcpy(&header, head.data(), sizeof(StoreHeader));
+
+    if (header.magic != store_magic) {
+      GGB_LOG_ERROR("Not a GGB store (bad magic): {}", path);
+      throw std::runtime_error("StoreHeader: bad magic");
+    }
+    if (header.version != store_format_version) {
+      GGB_LOG_ERROR("Unsupported GGB store version {} (expected {}): {}",
+                    header.version, store_format_version, path);
+      throw std::runtime_error("StoreHeader: unsupported version");
+    }
+    if (header.dtype > StorageDType::Int8) {
+      GGB_LOG_ERROR("Unsupported GGB store dtype {}: {}",
+                    static_cast<std::uint32_t>(header.dtype), path);
+      throw std::runtime_error("StoreHeader: unsupported dtype");
+    }
+    if (header.data_offset + header.data_bytes > file_size ||
+        header.index_offset + header.index_bytes > file_size ||
+        header.hot_offset + header.hot_bytes > file_size ||
+        header.data_bytes < header.num_rows * header.row_bytes()) {
+      GGB_LOG_ERROR("GGB store sections exceed file size: {}", path);
+      throw std::runtime_error("StoreHeader: truncated store");
+    }
+    return header;
+  }
+};
+
+static_assert(sizeof(StoreHeader) <= store_alignment);
+
+}  // namespace ggb::detail
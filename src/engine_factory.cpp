@@ -1,8 +1,11 @@
 #include <memory>
+#include <string>
 #include <type_traits>
 #include <variant>
 
 #include "common/logging.h"
+#include "engines/cached/cached.h"
+#include "engines/direct_io/direct_io.h"
 #include "engines/flat_mmap/flat_mmap.h"
 #include "engines/in_memory/in_memory.h"
 #include "ggb/core.h"
@@ -21,8 +24,25 @@ auto create_builder(const EngineConfig& cfg)
         } else if constexpr (std::is_same_v<T, InMemoryConfig>) {
           GGB_LOG_DEBUG("Creating InMemory builder");
           return std::make_unique<engine::InMemoryFeatureStoreBuilder>(arg);
+        } else if constexpr (std::is_same_v<T, DirectIoConfig>) {
+          GGB_LOG_DEBUG("Creating DirectIo builder");
+          return std::make_unique<engine::DirectIoFeatureStoreBuilder>(arg);
+        } else if constexpr (std::is_same_v<T, CachedConfig>) {
+          GGB_LOG_DEBUG("Creating Cached builder");
+          return std::make_unique<engine::CachedFeatureStoreBuilder>(arg);
         }
       },
       cfg);
 }
+
+auto FeatureStore::open(const FlatMmapConfig& cfg)
+    -> std::unique_ptr<FeatureStore> {
+  GGB_LOG_DEBUG("Opening FlatMmap store at {}", cfg.db_path);
+  return std::make_unique<engine::FlatMmapFeatureStore>(cfg);
+}
+
+auto FeatureStore::open(const std::string& path)
+    -> std::unique_ptr<FeatureStore> {
+  return open(FlatMmapConfig{.db_path = path});
+}
 }  // namespace ggb
@@ -0,0 +1,211 @@
+#include "cached.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <future>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "common/logging.h"
+
+namespace ggb::engine {
+
+CachedFeatureStore::CachedFeatureStore(CachedConfig cfg,
+                                       std::unique_ptr<FeatureStore> base)
+    : cfg_(std::move(cfg)),
+      base_(std::move(base)),
+      cache_(cfg_.capacity_bytes, base_->get_tensor_size().value_or(0),
+             cfg_.policy, cfg_.num_shards, base_->get_num_keys()),
+      executor_(cfg_.executor) {}
+
+[[nodiscard]] auto CachedFeatureStore::name() const -> std::string_view {
+  return name_;
+}
+
+[[nodiscard]] auto CachedFeatureStore::get_num_keys() const -> std::size_t {
+  return base_->get_num_keys();
+}
+
+[[nodiscard]] auto CachedFeatureStore::get_tensor_size() const
+    -> std::optional<std::size_t> {
+  return base_->get_tensor_size();
+}
+
+[[nodiscard]] auto CachedFeatureStore::get_index_memory_bytes() const
+    -> std::size_t {
+  return base_->get_index_memory_bytes();
+}
+
+[[nodiscard]] auto CachedFeatureStore::get_counters() const -> Counters {
+  auto counters = base_->get_counters();
+  const auto stats = cache_.stats();
+  counters["row_cache.hits"] = stats.hits;
+  counters["row_cache.misses"] = stats.misses;
+  counters["row_cache.insertions"] = stats.insertions;
+  counters["row_cache.evictions"] = stats.evictions;
+  return counters;
+}
+
+// The wrapped store's metrics cover the misses fetched from it
+[[nodiscard]] auto CachedFeatureStore::get_metrics() const -> Metrics {
+  auto metrics = base_->get_metrics();
+  for (const auto &[name, value] : get_counters()) {
+    metrics.counters[name] = value;
+  }
+  return metrics;
+}
+
+[[nodiscard]] auto CachedFeatureStore::get_missing_keys(
+    std::span<const Key> keys) const -> std::vector<std::size_t> {
+  return base_->get_missing_keys(keys);
+}
+
+[[nodiscard]] auto CachedFeatureStore::get_multi_tensor_async(
+    std::span<const Key> keys) const
+    -> std::future<std::vector<std::optional<Value>>> {
+  return executor_.submit(
+      [this, owned_keys = std::vector<Key>(keys.begin(), keys.end())] {
+        return gather_values(owned_keys);
+      });
+}
+
+[[nodiscard]] auto CachedFeatureStore::get_multi_tensor_into_async_impl(
+    std::span<const Key> keys, std::span<float> out) const
+    -> std::future<std::vector<std::size_t>> {
+  return executor_.submit(
+      [this, owned_keys = std::vector<Key>(keys.begin(), keys.end()), out] {
+        return get_multi_tensor_into_impl(owned_keys, out);
+      });
+}
+
+auto CachedFeatureStore::prefetch(std::span<const Key> keys) const -> void {
+  executor_.post(
+      [this, owned_keys = std::vector<Key>(keys.begin(), keys.end())] {
+        std::vector<Key> uncached;
+        for (const auto &key : owned_keys) {
+          if (!cache_.contains(key)) {
+            uncached.push_back(key);
+          }
+        }
+        if (uncached.empty()) {
+          return;
+        }
+
+        const auto tensor_size = get_tensor_size().value_or(0);
+        std::vector<float> fetched(uncached.size() * tensor_size);
+        const auto absent = base_->get_multi_tensor_into(uncached, fetched);
+        auto next_absent = absent.begin();
+        for (std::size_t j = 0; j < uncached.size(); ++j) {
+          if (next_absent != absent.end() && *next_absent == j) {
+            ++next_absent;
+          } else {
+            cache_.insert(uncached[j], fetched.data() + (j * tensor_size));
+          }
+        }
+      });
+}
+
+auto CachedFeatureStore::gather_values(std::span<const Key> keys) const
+    -> std::vector<std::optional<Value>> {
+  const auto tensor_size = get_tensor_size().value_or(0);
+  std::vector<float> rows(keys.size() * tensor_size);
+  const auto missing = get_multi_tensor_into_impl(keys, rows);
+
+  std::vector<std::optional<Value>> results;
+  results.reserve(keys.size());
+  auto next_missing = missing.begin();
+  for (std::size_t i = 0; i < keys.size(); ++i) {
+    if (next_missing != missing.end() && *next_missing == i) {
+      results.emplace_back(std::nullopt);
+      ++next_missing;
+    } else {
+      const auto *start = rows.data() + (i * tensor_size);
+      results.emplace_back(Value(start, start + tensor_size));
+    }
+  }
+  return results;
+}
+
+[[nodiscard]] auto CachedFeatureStore::get_multi_tensor_into_impl(
+    std::span<const Key> keys, std::span<float> out) const
+    -> std::vector<std::size_t> {
+  const auto tensor_size = get_tensor_size().value_or(0);
+
+  // Serve what we can from the cache and collect the rest
+  std::vector<std::size_t> miss_positions;
+  std::vector<Key> miss_keys;
+  for (std::size_t i = 0; i < keys.size(); ++i) {
+    if (!cache_.lookup(keys[i], out.data() + (i * tensor_size))) {
+      miss_positions.push_back(i);
+      miss_keys.push_back(keys[i]);
+    }
+  }
+  if (miss_keys.empty()) {
+    return {};
+  }
+
+  std::vector<float> fetched(miss_keys.size() * tensor_size);
+  const auto absent = base_->get_multi_tensor_into(miss_keys, fetched);
+
+  // Scatter fetched rows (zero-filled for absent keys) and admit the found
+  std::vector<std::size_t> missing;
+  missing.reserve(absent.size());
+  auto next_absent = absent.begin();
+  for (std::size_t j = 0; j < miss_keys.size(); ++j) {
+    const auto *row = fetched.data() + (j * tensor_size);
+    std::copy_n(row, tensor_size,
+                out.data() + (miss_positions[j] * tensor_size));
+    if (next_absent != absent.end() && *next_absent == j) {
+      missing.push_back(miss_positions[j]);
+      ++next_absent;
+    } else {
+      cache_.insert(miss_keys[j], row);
+    }
+  }
+  return missing;
+}
+
+CachedFeatureStoreBuilder::CachedFeatureStoreBuilder(const CachedConfig &cfg)
+    : cfg_(cfg),
+      base_(std::visit(
+          [](const auto &base_cfg) { return create_builder(base_cfg); },
+          cfg.base)) {}
+
+auto CachedFeatureStoreBuilder::put_tensor_impl(const Key &key,
+                                                const Value &tensor) -> bool {
+  return base_->put_tensor(key, tensor);
+}
+
+auto CachedFeatureStoreBuilder::put_tensor_impl(const Key &key,
+                                                Value &&tensor) -> bool {
+  return base_->put_tensor(key, std::move(tensor));
+}
+
+auto CachedFeatureStoreBuilder::put_tensors_impl(std::span<const Key> keys,
+                                                 std::span<const float> rows,
+                                                 std::size_t dim) -> bool {
+  return base_->put_tensors(keys, rows, dim);
+}
+
+auto CachedFeatureStoreBuilder::reserve_impl(std::size_t num_rows,
+                                             std::size_t dim) -> void {
+  base_->reserve(num_rows, dim);
+}
+
+[[nodiscard]] auto CachedFeatureStoreBuilder::build_impl(
+    std::optional<GraphTopology> graph) -> std::unique_ptr<FeatureStore> {
+  auto base = base_->build(graph);
+  GGB_LOG_INFO(
+      "Building CachedFeatureStore\n\tCapacity: {:.3f} MB\n\tShards: "
+      "{}\n\tWraps: {}",
+      static_cast<double>(cfg_.capacity_bytes) / (1024 * 1024),
+      cfg_.num_shards, base->name());
+  return std::make_unique<CachedFeatureStore>(cfg_, std::move(base));
+}
+
+}  // namespace ggb::engine
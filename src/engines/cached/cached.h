@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <future>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "common/executor.h"
+#include "common/row_cache.h"
+#include "ggb/core.h"
+
+namespace ggb::engine {
+
+// Decorator that serves rows from a `RowCache` and fetches only the misses
+// from the wrapped store, admitting them into the cache afterwards
+class CachedFeatureStore final : public FeatureStore {
+ public:
+  CachedFeatureStore(CachedConfig cfg, std::unique_ptr<FeatureStore> base);
+
+  [[nodiscard]] auto name() const -> std::string_view override;
+  [[nodiscard]] auto get_num_keys() const -> std::size_t override;
+  [[nodiscard]] auto get_tensor_size() const
+      -> std::optional<std::size_t> override;
+  [[nodiscard]] auto get_index_memory_bytes() const -> std::size_t override;
+  [[nodiscard]] auto get_counters() const -> Counters override;
+  [[nodiscard]] auto get_metrics() const -> Metrics override;
+  [[nodiscard]] auto get_missing_keys(std::span<const Key> keys) const
+      -> std::vector<std::size_t> override;
+  [[nodiscard]] auto get_multi_tensor_async(std::span<const Key> keys) const
+      -> std::future<std::vector<std::optional<Value>>> override;
+
+  // Fetches the rows not yet cached from the wrapped store and admits them
+  auto prefetch(std::span<const Key> keys) const -> void override;
+
+ protected:
+  [[nodiscard]] auto get_multi_tensor_into_impl(std::span<const Key> keys,
+                                                std::span<float> out) const
+      -> std::vector<std::size_t> override;
+  [[nodiscard]] auto get_multi_tensor_into_async_impl(
+      std::span<const Key> keys, std::span<float> out) const
+      -> std::future<std::vector<std::size_t>> override;
+
+ private:
+  static constexpr std::string_view name_ = "CachedFeatureStore";
+
+  [[nodiscard]] auto gather_values(std::span<const Key> keys) const
+      -> std::vector<std::optional<Value>>;
+
+  const CachedConfig cfg_;
+  const std::unique_ptr<FeatureStore> base_;
+  mutable detail::RowCache cache_;
+
+  // Declared last so in-flight lookups drain before the cache is destroyed
+  mutable detail::Executor executor_;
+};
+
+class CachedFeatureStoreBuilder final : public FeatureStoreBuilder {
+ public:
+  // Creates the builder of the wrapped engine from `cfg.base`
+  explicit CachedFeatureStoreBuilder(const CachedConfig &cfg);
+
+  auto put_tensor_impl(const Key &key, const Value &tensor) -> bool override;
+  auto put_tensor_impl(const Key &key, Value &&tensor) -> bool override;
+  auto put_tensors_impl(std::span<const Key> keys, std::span<const float> rows,
+                        std::size_t dim) -> bool override;
+  auto reserve_impl(std::size_t num_rows, std::size_t dim) -> void override;
+
+  [[nodiscard]] auto build_impl(
+      std::optional<GraphTopology> graph = std::nullopt)
+      -> std::unique_ptr<FeatureStore> override;
+
+ private:
+  const CachedConfig cfg_;
+  std::unique_ptr<FeatureStoreBuilder> base_;
+};
+
+}  // namespace ggb::engine
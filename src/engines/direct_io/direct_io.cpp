@@ -0,0 +1,410 @@
+#include "direct_io.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "common/dtype.h"
+#include "common/logging.h"
+#include "common/serialize.h"
+
+namespace ggb::engine {
+namespace {
+
+auto open_or_throw(const std::string &path, int flags) -> int {
+  const auto fd = ::open(path.c_str(), flags);
+  if (fd == -1) {
+    GGB_LOG_ERROR("Failed to open file: {} (errno: {})", path, errno);
+    throw std::runtime_error("DirectIoFeatureStore: open failed");
+  }
+  return fd;
+}
+
+// O_DIRECT is not supported everywhere (e.g. tmpfs), fall back to buffered
+auto open_data_file(const DirectIoConfig &cfg) -> int {
+  if (cfg.direct_io) {
+    const auto fd = ::open(cfg.db_path.c_str(), O_RDONLY | O_DIRECT);
+    if (fd != -1) {
+      return fd;
+    }
+    if (errno != EINVAL) {
+      GGB_LOG_ERROR("Failed to open file: {} (errno: {})", cfg.db_path, errno);
+      throw std::runtime_error("DirectIoFeatureStore: open failed");
+    }
+    GGB_LOG_WARN("O_DIRECT not supported for {}, using buffered reads",
+                 cfg.db_path);
+  }
+  return open_or_throw(cfg.db_path, O_RDONLY);
+}
+
+// Reads `length` bytes at `offset` through a buffered descriptor
+auto read_section(const std::string &path, std::uint64_t offset,
+                  std::size_t length) -> std::vector<std::byte> {
+  const FileHandle file(open_or_throw(path, O_RDONLY));
+  std::vector<std::byte> bytes(length);
+  const auto n = pread_full(file.get(), bytes.data(), length, offset);
+  if (n < 0 || static_cast<std::size_t>(n) != length) {
+    GGB_LOG_ERROR("Short read of {} bytes at {} in {}", length, offset, path);
+    throw std::runtime_error("DirectIoFeatureStore: short read");
+  }
+  return bytes;
+}
+
+auto read_header(const std::string &path) -> detail::StoreHeader {
+  struct stat st {};
+  if (::stat(path.c_str(), &st) == -1) {
+    GGB_LOG_ERROR("Failed to stat file: {}", path);
+    throw std::runtime_error("DirectIoFeatureStore: stat failed");
+  }
+  const auto file_size = static_cast<std::size_t>(st.st_size);
+  const auto head = read_section(
+      path, 0, std::min(file_size, sizeof(detail::StoreHeader)));
+  return detail::StoreHeader::parse(head, file_size, path);
+}
+
+auto read_index(const std::string &path, const detail::StoreHeader &header)
+    -> detail::KeyIndex {
+  const auto bytes =
+      read_section(path, header.index_offset, header.index_bytes);
+  detail::BinaryReader reader(bytes);
+  return detail::KeyIndex::load(reader);
+}
+
+auto to_tensor_size(const detail::StoreHeader &header)
+    -> std::optional<std::size_t> {
+  if (header.dim == 0) {
+    return std::nullopt;
+  }
+  return header.dim;
+}
+
+// A row straddles at most one extra block when it does not start aligned;
+// a coalesced range is at most `max_range_bytes`
+auto max_read_bytes(const detail::StoreHeader &header,
+                    const CoalesceConfig &coalesce) -> std::size_t {
+  const auto row = detail::AlignedBufferPool::round_up(
+                       header.row_bytes(), detail::store_alignment) +
+                   detail::store_alignment;
+  return coalesce.enabled ? std::max(row, coalesce.max_range_bytes) : row;
+}
+
+}  // namespace
+
+FileHandle::~FileHandle() {
+  if (fd_ != -1) {
+    ::close(fd_);
+  }
+}
+
+DirectIoFeatureStore::DirectIoFeatureStore(DirectIoConfig cfg)
+    : cfg_(std::move(cfg)),
+      file_(open_data_file(cfg_)),
+      page_cached_((::fcntl(file_.get(), F_GETFL) & O_DIRECT) == 0),
+      header_(read_header(cfg_.db_path)),
+      index_(read_index(cfg_.db_path, header_)),
+      tensor_size_(to_tensor_size(header_)),
+      reader_(make_row_reader(file_.get(), cfg_)),
+      buffers_(max_read_bytes(header_, cfg_.coalesce),
+               std::max<std::size_t>(1, cfg_.queue_depth) *
+                   std::max<std::size_t>(1, cfg_.executor.num_threads),
+               detail::store_alignment),
+      executor_(cfg_.executor) {
+  GGB_LOG_INFO(
+      "Opened DirectIoStore\n\tTotal Keys: {}\n\tIndex: {}\n\tBackend: {} "
+      "(queue depth {})\n\tPath: {}",
+      index_.size(), index_.kind(), reader_->name(), cfg_.queue_depth,
+      cfg_.db_path);
+}
+
+[[nodiscard]] auto DirectIoFeatureStore::name() const -> std::string_view {
+  return name_;
+}
+
+[[nodiscard]] auto DirectIoFeatureStore::get_num_keys() const -> std::size_t {
+  return index_.size();
+}
+
+[[nodiscard]] auto DirectIoFeatureStore::get_tensor_size() const
+    -> std::optional<std::size_t> {
+  return tensor_size_;
+}
+
+[[nodiscard]] auto DirectIoFeatureStore::get_index_memory_bytes() const
+    -> std::size_t {
+  return index_.memory_bytes();
+}
+
+[[nodiscard]] auto DirectIoFeatureStore::get_storage_dtype() const
+    -> StorageDType {
+  return header_.dtype;
+}
+
+[[nodiscard]] auto DirectIoFeatureStore::get_counters() const -> Counters {
+  return {{"direct_io.reads", num_reads_.load(std::memory_order_relaxed)},
+          {"direct_io.rows", num_rows_.load(std::memory_order_relaxed)},
+          {"direct_io.bytes", bytes_read_.load(std::memory_order_relaxed)}};
+}
+
+[[nodiscard]] auto DirectIoFeatureStore::get_metrics() const -> Metrics {
+  auto metrics = FeatureStore::get_metrics();
+  metrics_.snapshot(metrics);
+  return metrics;
+}
+
+[[nodiscard]] auto DirectIoFeatureStore::get_missing_keys(
+    std::span<const Key> keys) const -> std::vector<std::size_t> {
+  std::vector<std::size_t> missing;
+  index_.for_each_slot(
+      keys, [&](std::size_t first, std::span<const std::size_t> slots) {
+        for (std::size_t i = 0; i < slots.size(); ++i) {
+          if (slots[i] == detail::missing_slot) {
+            missing.push_back(first + i);
+          }
+        }
+      });
+  return missing;
+}
+
+[[nodiscard]] auto DirectIoFeatureStore::get_multi_tensor_async(
+    std::span<const Key> keys) const
+    -> std::future<std::vector<std::optional<Value>>> {
+  return executor_.submit(
+      [this, owned_keys = std::vector<Key>(keys.begin(), keys.end())] {
+        return gather_values(owned_keys);
+      });
+}
+
+[[nodiscard]] auto DirectIoFeatureStore::get_multi_tensor_into_async_impl(
+    std::span<const Key> keys, std::span<float> out) const
+    -> std::future<std::vector<std::size_t>> {
+  return executor_.submit(
+      [this, owned_keys = std::vector<Key>(keys.begin(), keys.end()), out] {
+        return get_multi_tensor_into_impl(owned_keys, out);
+      });
+}
+
+auto DirectIoFeatureStore::prefetch(std::span<const Key> keys) const -> void {
+  if (!page_cached_ || !tensor_size_.has_value()) {
+    return;
+  }
+  executor_.post(
+      [this, owned_keys = std::vector<Key>(keys.begin(), keys.end())] {
+        std::vector<detail::RowRef> rows;
+        rows.reserve(owned_keys.size());
+        index_.for_each_slot(
+            owned_keys,
+            [&](std::size_t first, std::span<const std::size_t> slots) {
+              for (std::size_t i = 0; i < slots.size(); ++i) {
+                if (slots[i] != detail::missing_slot) {
+                  rows.push_back({.slot = slots[i], .position = first + i});
+                }
+              }
+            });
+        const auto ranges = detail::plan_reads(
+            rows, header_.data_offset, header_.row_bytes(),
+            detail::store_alignment, cfg_.coalesce.max_range_bytes);
+        for (const auto &range : ranges) {
+          ::posix_fadvise(file_.get(), static_cast<off_t>(range.offset),
+                          static_cast<off_t>(range.length),
+                          POSIX_FADV_WILLNEED);
+        }
+      });
+}
+
+auto DirectIoFeatureStore::gather_values(std::span<const Key> keys) const
+    -> std::vector<std::optional<Value>> {
+  const auto tensor_size = tensor_size_.value_or(0);
+  std::vector<float> rows(keys.size() * tensor_size);
+  const auto missing = get_multi_tensor_into_impl(keys, rows);
+
+  std::vector<std::optional<Value>> results;
+  results.reserve(keys.size());
+  auto next_missing = missing.begin();
+  for (std::size_t i = 0; i < keys.size(); ++i) {
+    if (next_missing != missing.end() && *next_missing == i) {
+      results.emplace_back(std::nullopt);
+      ++next_missing;
+    } else {
+      const auto *start = rows.data() + (i * tensor_size);
+      results.emplace_back(Value(start, start + tensor_size));
+    }
+  }
+  return results;
+}
+
+[[nodiscard]] auto DirectIoFeatureStore::get_multi_tensor_into_impl(
+    std::span<const Key> keys, std::span<float> out) const
+    -> std::vector<std::size_t> {
+  return gather_into(keys, StorageDType::F32, std::as_writable_bytes(out));
+}
+
+[[nodiscard]] auto DirectIoFeatureStore::get_multi_tensor_native_into_impl(
+    std::span<const Key> keys, std::span<std::byte> out) const
+    -> std::vector<std::size_t> {
+  return gather_into(keys, header_.dtype, out);
+}
+
+auto DirectIoFeatureStore::gather_into(std::span<const Key> keys,
+                                       StorageDType out_dtype,
+                                       std::span<std::byte> out) const
+    -> std::vector<std::size_t> {
+  std::vector<std::size_t> missing;
+  if (!tensor_size_.has_value()) {
+    GGB_LOG_WARN("Empty tensor dimension found");
+    missing.resize(keys.size());
+    std::iota(missing.begin(), missing.end(), std::size_t{0});
+    return missing;
+  }
+
+  // Resolve the whole batch first so every read can be submitted at once
+  const auto out_row_bytes =
+      storage_row_bytes(out_dtype, tensor_size_.value());
+  detail::StageClock clock(metrics_);
+  std::vector<detail::RowRef> rows;
+  rows.reserve(keys.size());
+  index_.for_each_slot(
+      keys, [&](std::size_t first, std::span<const std::size_t> chunk) {
+        for (std::size_t i = 0; i < chunk.size(); ++i) {
+          if (chunk[i] != detail::missing_slot) {
+            rows.push_back({.slot = chunk[i], .position = first + i});
+          } else {
+            std::fill_n(out.data() + ((first + i) * out_row_bytes),
+                        out_row_bytes, std::byte{0});
+            missing.push_back(first + i);
+          }
+        }
+      });
+
+  clock.lap(detail::Stage::Index);
+
+  read_rows(rows, out_dtype, out, clock);
+  metrics_.add_lookup(keys.size(), missing.size(), out_row_bytes);
+  return missing;
+}
+
+auto DirectIoFeatureStore::read_rows(std::span<detail::RowRef> rows,
+                                     StorageDType out_dtype,
+                                     std::span<std::byte> out,
+                                     detail::StageClock &clock) const
+    -> void {
+  const auto tensor_size = tensor_size_.value();
+  const auto row_bytes = header_.row_bytes();
+  const auto out_row_bytes = storage_row_bytes(out_dtype, tensor_size);
+  const auto queue_depth = std::max<std::size_t>(1, cfg_.queue_depth);
+  const auto ranges = detail::plan_reads(
+      rows, header_.data_offset, row_bytes, detail::store_alignment,
+      cfg_.coalesce.enabled ? cfg_.coalesce.max_range_bytes : 0);
+
+  std::vector<std::byte *> blocks;
+  std::vector<ReadRequest> requests;
+  std::uint64_t total_bytes = 0;
+  for (std::size_t first = 0; first < ranges.size();) {
+    blocks.clear();
+    const auto n = buffers_.acquire(
+        std::min(queue_depth, ranges.size() - first), blocks);
+
+    requests.clear();
+    for (std::size_t i = 0; i < n; ++i) {
+      const auto &range = ranges[first + i];
+      requests.push_back({.offset = range.offset,
+                          .length = range.length,
+                          .buffer = blocks[i]});
+      total_bytes += range.length;
+    }
+    try {
+      reader_->read(requests);
+    } catch (...) {
+      // Blocks kept out of the pool would eventually stall every lookup
+      buffers_.release(blocks);
+      throw;
+    }
+    clock.lap(detail::Stage::Read);
+
+    // Scatter every row of each range back to its request position
+    bool failed = false;
+    for (std::size_t i = 0; i < n; ++i) {
+      const auto &range = ranges[first + i];
+      for (std::size_t r = range.first; r < range.first + range.count; ++r) {
+        const auto offset = header_.data_offset + (rows[r].slot * row_bytes);
+        const auto skip = offset - range.offset;
+        if (requests[i].result < 0 ||
+            static_cast<std::size_t>(requests[i].result) < skip + row_bytes) {
+          failed = true;
+          continue;
+        }
+        auto *dst = out.data() + (rows[r].position * out_row_bytes);
+        if (out_dtype == header_.dtype) {
+          std::copy_n(blocks[i] + skip, row_bytes, dst);
+        } else {
+          detail::decode_row(header_.dtype, blocks[i] + skip, tensor_size,
+                             reinterpret_cast<float *>(dst));
+        }
+      }
+    }
+    buffers_.release(blocks);
+    clock.lap(detail::Stage::Copy);
+    if (failed) {
+      GGB_LOG_ERROR("Failed to read rows from {}", cfg_.db_path);
+      throw std::runtime_error("DirectIoFeatureStore: read failed");
+    }
+    first += n;
+  }
+
+  num_reads_.fetch_add(ranges.size(), std::memory_order_relaxed);
+  num_rows_.fetch_add(rows.size(), std::memory_order_relaxed);
+  bytes_read_.fetch_add(total_bytes, std::memory_order_relaxed);
+}
+
+DirectIoFeatureStoreBuilder::DirectIoFeatureStoreBuilder(
+    const DirectIoConfig &cfg)
+    : cfg_(cfg),
+      writer_(FlatMmapConfig{.db_path = cfg.db_path,
+                             .index = cfg.index,
+                             .row_order = cfg.row_order,
+                             .writer = cfg.writer,
+                             .dtype = cfg.dtype}) {}
+
+auto DirectIoFeatureStoreBuilder::put_tensor_impl(const Key &key,
+                                                  const Value &tensor) -> bool {
+  return writer_.put_tensor(key, tensor);
+}
+
+auto DirectIoFeatureStoreBuilder::put_tensor_impl(const Key &key,
+                                                  Value &&tensor) -> bool {
+  return writer_.put_tensor(key, std::move(tensor));
+}
+
+auto DirectIoFeatureStoreBuilder::put_tensors_impl(std::span<const Key> keys,
+                                                   std::span<const float> rows,
+                                                   std::size_t dim) -> bool {
+  return writer_.put_tensors(keys, rows, dim);
+}
+
+auto DirectIoFeatureStoreBuilder::reserve_impl(std::size_t num_rows,
+                                               std::size_t dim) -> void {
+  writer_.reserve(num_rows, dim);
+}
+
+[[nodiscard]] auto DirectIoFeatureStoreBuilder::build_impl(
+    std::optional<GraphTopology> graph) -> std::unique_ptr<FeatureStore> {
+  // Drop the mapped store right away; only the file it wrote is needed
+  writer_.build(graph).reset();
+  return std::make_unique<DirectIoFeatureStore>(cfg_);
+}
+
+}  // namespace ggb::engine
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "common/aligned_buffer_pool.h"
+#include "common/executor.h"
+#include "common/key_index.h"
+#include "common/metrics.h"
+#include "common/read_plan.h"
+#include "common/store_format.h"
+#include "engines/direct_io/row_reader.h"
+#include "engines/flat_mmap/flat_mmap.h"
+#include "ggb/core.h"
+
+namespace ggb::engine {
+
+// Owns a file descriptor
+class FileHandle {
+ public:
+  explicit FileHandle(int fd) : fd_(fd) {}
+  ~FileHandle();
+
+  FileHandle(const FileHandle&) = delete;
+  auto operator=(const FileHandle&) -> FileHandle& = delete;
+
+  [[nodiscard]] auto get() const -> int { return fd_; }
+
+ private:
+  int fd_;
+};
+
+// Serves rows of a store in the FlatMmap format through explicit reads
+// instead of page faults, so a batch's misses are all in flight at once
+class DirectIoFeatureStore final : public FeatureStore {
+ public:
+  explicit DirectIoFeatureStore(DirectIoConfig cfg);
+
+  [[nodiscard]] auto name() const -> std::string_view override;
+  [[nodiscard]] auto get_num_keys() const -> std::size_t override;
+  [[nodiscard]] auto get_tensor_size() const
+      -> std::optional<std::size_t> override;
+  [[nodiscard]] auto get_index_memory_bytes() const -> std::size_t override;
+  [[nodiscard]] auto get_storage_dtype() const -> StorageDType override;
+  [[nodiscard]] auto get_counters() const -> Counters override;
+  [[nodiscard]] auto get_metrics() const -> Metrics override;
+  [[nodiscard]] auto get_missing_keys(std::span<const Key> keys) const
+      -> std::vector<std::size_t> override;
+  [[nodiscard]] auto get_multi_tensor_async(std::span<const Key> keys) const
+      -> std::future<std::vector<std::optional<Value>>> override;
+
+  // Reads the coalesced ranges into the page cache with
+  // POSIX_FADV_WILLNEED. O_DIRECT reads never consult the page cache, so
+  // then there is nowhere to prefetch to and this does nothing; wrap the
+  // store in a `CachedConfig` engine to prefetch into its row cache instead.
+  auto prefetch(std::span<const Key> keys) const -> void override;
+
+ protected:
+  [[nodiscard]] auto get_multi_tensor_into_impl(std::span<const Key> keys,
+                                                std::span<float> out) const
+      -> std::vector<std::size_t> override;
+  [[nodiscard]] auto get_multi_tensor_into_async_impl(
+      std::span<const Key> keys, std::span<float> out) const
+      -> std::future<std::vector<std::size_t>> override;
+  [[nodiscard]] auto get_multi_tensor_native_into_impl(
+      std::span<const Key> keys, std::span<std::byte> out) const
+      -> std::vector<std::size_t> override;
+
+ private:
+  static constexpr std::string_view name_ = "DirectIoFeatureStore";
+
+  [[nodiscard]] auto gather_values(std::span<const Key> keys) const
+      -> std::vector<std::optional<Value>>;
+
+  // Gathers `keys` into `out` as rows of `out_dtype`, which is either the
+  // stored dtype or F32. Rows of missing keys are zero bytes.
+  [[nodiscard]] auto gather_into(std::span<const Key> keys,
+                                 StorageDType out_dtype,
+                                 std::span<std::byte> out) const
+      -> std::vector<std::size_t>;
+
+  // Reads `rows` (any order) into their positions of `out`, converted to
+  // `out_dtype`, coalescing neighbouring rows as `cfg_.coalesce` allows.
+  // The waits are lapped on `clock` as reads, the scatters as copies.
+  auto read_rows(std::span<detail::RowRef> rows, StorageDType out_dtype,
+                 std::span<std::byte> out, detail::StageClock& clock) const
+      -> void;
+
+  const DirectIoConfig cfg_;
+  const FileHandle file_;
+  const bool page_cached_;  // Opened without O_DIRECT
+  const detail::StoreHeader header_;
+  const detail::KeyIndex index_;
+  const std::optional<std::size_t> tensor_size_;
+  const std::unique_ptr<RowReader> reader_;
+  mutable detail::AlignedBufferPool buffers_;
+
+  mutable std::atomic<std::uint64_t> num_reads_{0};  // After coalescing
+  mutable std::atomic<std::uint64_t> num_rows_{0};
+  mutable std::atomic<std::uint64_t> bytes_read_{0};
+
+  // Keys, bytes and stage timings of lookups, see `get_metrics`
+  mutable detail::LookupMetrics metrics_;
+
+  // Declared last so in-flight lookups drain before the file is closed
+  mutable detail::Executor executor_;
+};
+
+// Writes the store with the FlatMmap builder, then reopens it for direct I/O
+class DirectIoFeatureStoreBuilder final : public FeatureStoreBuilder {
+ public:
+  explicit DirectIoFeatureStoreBuilder(const DirectIoConfig& cfg);
+
+  auto put_tensor_impl(const Key& key, const Value& tensor) -> bool override;
+  auto put_tensor_impl(const Key& key, Value&& tensor) -> bool override;
+  auto put_tensors_impl(std::span<const Key> keys, std::span<const float> rows,
+                        std::size_t dim) -> bool override;
+  auto reserve_impl(std::size_t num_rows, std::size_t dim) -> void override;
+
+  [[nodiscard]] auto build_impl(
+      std::optional<GraphTopology> graph = std::nullopt)
+      -> std::unique_ptr<FeatureStore> override;
+
+ private:
+  const DirectIoConfig cfg_;
+  FlatMmapFeatureStoreBuilder writer_;
+};
+
+}  // namespace ggb::engine
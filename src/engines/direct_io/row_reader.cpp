@@ -0,0 +1,234 @@
+#include "row_reader.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#include "common/executor.h"
+#include "common/logging.h"
+
+#ifdef GGB_HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+namespace ggb::engine {
+
+auto pread_full(int fd, std::byte *buffer, std::size_t length,
+                std::uint64_t offset) -> ssize_t {
+  std::size_t done = 0;
+  while (done < length) {
+    const auto n = ::pread(fd, buffer + done, length - done,
+                           static_cast<off_t>(offset + done));
+    if (n == 0) {
+      break;
+    }
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -errno;
+    }
+    done += static_cast<std::size_t>(n);
+  }
+  return static_cast<ssize_t>(done);
+}
+
+namespace {
+
+// Spreads the requests of a call over a pool of blocking readers, so up to
+// `num_threads` reads are in flight at once
+class PreadRowReader final : public RowReader {
+ public:
+  PreadRowReader(int fd, std::size_t num_threads)
+      : fd_(fd), io_(ExecutorConfig{.num_threads = num_threads}) {}
+
+  [[nodiscard]] auto name() const -> std::string_view override {
+    return "pread";
+  }
+
+  auto read(std::span<ReadRequest> requests) -> void override {
+    const auto num_tasks =
+        std::min(requests.size(), std::max<std::size_t>(1, io_.num_threads()));
+    if (num_tasks <= 1) {
+      read_strided(requests, 0, 1);
+      return;
+    }
+
+    std::vector<std::future<void>> pending;
+    pending.reserve(num_tasks);
+    for (std::size_t task = 0; task < num_tasks; ++task) {
+      pending.push_back(io_.submit([this, requests, task, num_tasks] {
+        read_strided(requests, task, num_tasks);
+      }));
+    }
+    // Let every task finish before rethrowing, none may outlive the
+    // caller's buffers
+    for (auto &future : pending) {
+      future.wait();
+    }
+    for (auto &future : pending) {
+      future.get();
+    }
+  }
+
+ private:
+  auto read_strided(std::span<ReadRequest> requests, std::size_t first,
+                    std::size_t stride) const -> void {
+    for (auto i = first; i < requests.size(); i += stride) {
+      auto &req = requests[i];
+      req.result = pread_full(fd_, req.buffer, req.length, req.offset);
+    }
+  }
+
+  const int fd_;
+  detail::Executor io_;
+};
+
+#ifdef GGB_HAVE_LIBURING
+// Submits up to `queue_depth` reads per io_uring_enter. Rings are not
+// thread-safe, so each concurrent caller borrows its own from a small pool.
+class UringRowReader final : public RowReader {
+ public:
+  UringRowReader(int fd, std::size_t queue_depth)
+      : fd_(fd), queue_depth_(static_cast<unsigned>(queue_depth)) {
+    // Fail construction, and so fall back, if io_uring is not permitted
+    release(acquire());
+  }
+
+  ~UringRowReader() override {
+    for (auto &ring : rings_) {
+      io_uring_queue_exit(ring.get());
+    }
+  }
+
+  UringRowReader(const UringRowReader &) = delete;
+  auto operator=(const UringRowReader &) -> UringRowReader & = delete;
+
+  [[nodiscard]] auto name() const -> std::string_view override {
+    return "io_uring";
+  }
+
+  auto read(std::span<ReadRequest> requests) -> void override {
+    auto *ring = acquire();
+    try {
+      read_batches(ring, requests);
+    } catch (...) {
+      // Completions may still be pending on the ring, so it is torn down
+      // rather than handed to the next caller
+      retire(ring);
+      throw;
+    }
+    release(ring);
+
+    // Finish short reads synchronously, they are rare
+    for (auto &req : requests) {
+      if (req.result >= 0 &&
+          static_cast<std::size_t>(req.result) < req.length) {
+        req.result = pread_full(fd_, req.buffer, req.length, req.offset);
+      }
+    }
+  }
+
+ private:
+  auto read_batches(io_uring *ring, std::span<ReadRequest> requests) const
+      -> void {
+    for (std::size_t first = 0; first < requests.size();
+         first += queue_depth_) {
+      const auto n = std::min<std::size_t>(queue_depth_,
+                                            requests.size() - first);
+      for (std::size_t i = first; i < first + n; ++i) {
+        auto *sqe = io_uring_get_sqe(ring);
+        io_uring_prep_read(sqe, fd_, requests[i].buffer,
+                           static_cast<unsigned>(requests[i].length),
+                           requests[i].offset);
+        io_uring_sqe_set_data64(sqe, i);
+      }
+      io_uring_submit_and_wait(ring, static_cast<unsigned>(n));
+
+      for (std::size_t reaped = 0; reaped < n; ++reaped) {
+        io_uring_cqe *cqe = nullptr;
+        if (const auto err = io_uring_wait_cqe(ring, &cqe); err < 0) {
+          GGB_LOG_ERROR("io_uring_wait_cqe failed: {}", -err);
+          throw std::runtime_error("UringRowReader: wait failed");
+        }
+        requests[io_uring_cqe_get_data64(cqe)].result = cqe->res;
+        io_uring_cqe_seen(ring, cqe);
+      }
+    }
+  }
+
+  auto acquire() -> io_uring * {
+    const std::lock_guard lock(mutex_);
+    if (!idle_.empty()) {
+      auto *ring = idle_.back();
+      idle_.pop_back();
+      return ring;
+    }
+    auto ring = std::make_unique<io_uring>();
+    if (const auto err = io_uring_queue_init(queue_depth_, ring.get(), 0);
+        err < 0) {
+      GGB_LOG_WARN("io_uring_queue_init failed: {}", -err);
+      throw std::runtime_error("UringRowReader: io_uring unavailable");
+    }
+    rings_.push_back(std::move(ring));
+    return rings_.back().get();
+  }
+
+  auto release(io_uring *ring) -> void {
+    const std::lock_guard lock(mutex_);
+    idle_.push_back(ring);
+  }
+
+  auto retire(io_uring *ring) -> void {
+    const std::lock_guard lock(mutex_);
+    io_uring_queue_exit(ring);
+    std::erase_if(rings_, [ring](const auto &owned) {
+      return owned.get() == ring;
+    });
+  }
+
+  const int fd_;
+  const unsigned queue_depth_;
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<io_uring>> rings_;
+  std::vector<io_uring *> idle_;
+};
+#endif
+
+}  // namespace
+
+auto make_row_reader(int fd, const DirectIoConfig &cfg)
+    -> std::unique_ptr<RowReader> {
+  const auto queue_depth = std::max<std::size_t>(1, cfg.queue_depth);
+  if (cfg.backend != IoBackend::Pread) {
+#ifdef GGB_HAVE_LIBURING
+    try {
+      return std::make_unique<UringRowReader>(fd, queue_depth);
+    } catch (const std::runtime_error &) {
+      if (cfg.backend == IoBackend::IoUring) {
+        throw;
+      }
+    }
+#else
+    if (cfg.backend == IoBackend::IoUring) {
+      GGB_LOG_ERROR("ggb was built without liburing");
+      throw std::runtime_error("make_row_reader: io_uring not available");
+    }
+#endif
+    GGB_LOG_INFO("io_uring unavailable, falling back to pread workers");
+  }
+  return std::make_unique<PreadRowReader>(
+      fd, std::min(queue_depth, cfg.pread_threads));
+}
+
+}  // namespace ggb::engine
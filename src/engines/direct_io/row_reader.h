@@ -0,0 +1,43 @@
+#pragma once
+
+#include <sys/types.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string_view>
+
+#include "ggb/core.h"
+
+namespace ggb::engine {
+
+struct ReadRequest {
+  std::uint64_t offset;
+  std::size_t length;
+  std::byte* buffer;
+  ssize_t result{0};  // Bytes read, or -errno
+};
+
+// Issues a set of positional reads against one file descriptor and returns
+// once all of them completed. Implementations must be safe to call from
+// several threads at once.
+class RowReader {
+ public:
+  virtual ~RowReader() = default;
+
+  [[nodiscard]] virtual auto name() const -> std::string_view = 0;
+  virtual auto read(std::span<ReadRequest> requests) -> void = 0;
+};
+
+// Reads until `length` bytes, EOF or an error, retrying on EINTR
+auto pread_full(int fd, std::byte* buffer, std::size_t length,
+                std::uint64_t offset) -> ssize_t;
+
+// Picks the backend requested by `cfg`, falling back from io_uring to pread
+// for `IoBackend::Auto`. Throws `std::runtime_error` if an explicitly
+// requested backend is unavailable.
+[[nodiscard]] auto make_row_reader(int fd, const DirectIoConfig& cfg)
+    -> std::unique_ptr<RowReader>;
+
+}  // namespace ggb::engine
@@ -2,29 +2,104 @@
 
 #include <sys/mman.h>
 
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <filesystem>
 #include <future>
 #include <iostream>
 #include <memory>
+#include <numeric>
 #include <optional>
+#include <sstream>
 #include <span>
+#include <stdexcept>
 #include <string_view>
-#include <unordered_map>
 #include <utility>
 #include <vector>
 
 #include "common/logging.h"
+#include "common/page_buffer.h"
+#include "common/row_order.h"
+#include "common/serialize.h"
 
 namespace ggb::engine {
+namespace {
 
-FlatMmapFeatureStore::FlatMmapFeatureStore(
-    FlatMmapConfig cfg,
-    std::unordered_map<Key, std::size_t, KeyHash> &&key_to_byte,
-    std::optional<std::size_t> tensor_size)
+auto file_bytes(const detail::MmapRegion &mmap) -> std::span<const std::byte> {
+  return {static_cast<const std::byte *>(mmap.data()), mmap.size()};
+}
+
+auto load_index(const detail::MmapRegion &mmap,
+                const detail::StoreHeader &header) -> detail::KeyIndex {
+  detail::BinaryReader reader(
+      file_bytes(mmap).subspan(header.index_offset, header.index_bytes));
+  return detail::KeyIndex::load(reader);
+}
+
+auto to_tensor_size(const detail::StoreHeader &header)
+    -> std::optional<std::size_t> {
+  if (header.dim == 0) {
+    return std::nullopt;
+  }
+  return header.dim;
+}
+
+// Reserves the header block; it is filled in once the layout is known
+auto write_header_placeholder(detail::BufferedWriter &out) -> void {
+  const std::array<char, detail::store_alignment> placeholder{};
+  out.write(placeholder.data(), placeholder.size());
+}
+
+// Appends what `save` serializes and returns its size in bytes
+template <typename SaveFn>
+auto append_serialized(detail::BufferedWriter &out, SaveFn &&save)
+    -> std::size_t {
+  std::ostringstream buffer;
+  detail::BinaryWriter writer(buffer);
+  save(writer);
+  const auto bytes = std::move(buffer).str();
+  out.write(bytes.data(), bytes.size());
+  return writer.bytes_written();
+}
+
+}  // namespace
+
+FlatMmapFeatureStore::FlatMmapFeatureStore(FlatMmapConfig cfg)
+    : cfg_(std::move(cfg)),
+      mmap_(cfg_.db_path, cfg_.huge_pages),
+      header_(detail::StoreHeader::read(file_bytes(mmap_), cfg_.db_path)),
+      index_(load_index(mmap_, header_)),
+      tensor_size_(to_tensor_size(header_)),
+      hot_cache_(load_hot_cache()),
+      copier_(tensor_size_.value_or(0)),
+      gather_pool_({.num_threads = cfg_.gather.num_threads}),
+      executor_(cfg_.executor) {
+  mmap_.advise(MADV_RANDOM);  // get some help from the kernel
+  if (cfg_.huge_pages != HugePages::None) {
+    index_.for_each_array(detail::advise_huge_pages);
+  }
+  GGB_LOG_INFO(
+      "Opened FlatMmapStore\n\tTotal Keys: {}\n\tIndex: {}\n\tHot Rows: "
+      "{}\n\tPath: {}",
+      index_.size(), index_.kind(), hot_cache_.size(), cfg_.db_path);
+}
+
+FlatMmapFeatureStore::FlatMmapFeatureStore(FlatMmapConfig cfg,
+                                           detail::KeyIndex &&index)
     : cfg_(std::move(cfg)),
-      key_to_byte_(std::move(key_to_byte)),
-      tensor_size_(tensor_size),
-      mmap_(cfg_.db_path) {
+      mmap_(cfg_.db_path, cfg_.huge_pages),
+      header_(detail::StoreHeader::read(file_bytes(mmap_), cfg_.db_path)),
+      index_(std::move(index)),
+      tensor_size_(to_tensor_size(header_)),
+      hot_cache_(load_hot_cache()),
+      copier_(tensor_size_.value_or(0)),
+      gather_pool_({.num_threads = cfg_.gather.num_threads}),
+      executor_(cfg_.executor) {
   mmap_.advise(MADV_RANDOM);  // get some help from the kernel
+  if (cfg_.huge_pages != HugePages::None) {
+    index_.for_each_array(detail::advise_huge_pages);
+  }
 }
 
 [[nodiscard]] auto FlatMmapFeatureStore::name() const -> std::string_view {
@@ -32,7 +107,7 @@ FlatMmapFeatureStore::FlatMmapFeatureStore(
 }
 
 [[nodiscard]] auto FlatMmapFeatureStore::get_num_keys() const -> std::size_t {
-  return key_to_byte_.size();
+  return index_.size();
 }
 
 [[nodiscard]] auto FlatMmapFeatureStore::get_tensor_size() const
@@ -40,40 +115,348 @@ FlatMmapFeatureStore::FlatMmapFeatureStore(
   return tensor_size_;
 }
 
+[[nodiscard]] auto FlatMmapFeatureStore::get_index_memory_bytes() const
+    -> std::size_t {
+  return index_.memory_bytes();
+}
+
+[[nodiscard]] auto FlatMmapFeatureStore::get_storage_dtype() const
+    -> StorageDType {
+  return header_.dtype;
+}
+
+[[nodiscard]] auto FlatMmapFeatureStore::get_counters() const -> Counters {
+  Counters counters{
+      {"hot_cache.hits", hot_hits_.load(std::memory_order_relaxed)},
+      {"hot_cache.misses", hot_misses_.load(std::memory_order_relaxed)}};
+  if (cfg_.coalesce.enabled) {
+    counters["flat_mmap.rows"] =
+        coalesced_rows_.load(std::memory_order_relaxed);
+    counters["flat_mmap.ranges"] =
+        coalesced_ranges_.load(std::memory_order_relaxed);
+  }
+  return counters;
+}
+
+[[nodiscard]] auto FlatMmapFeatureStore::get_metrics() const -> Metrics {
+  auto metrics = FeatureStore::get_metrics();
+  metrics_.snapshot(metrics);
+  return metrics;
+}
+
 [[nodiscard]] auto FlatMmapFeatureStore::get_multi_tensor_async(
     std::span<const Key> keys) const
     -> std::future<std::vector<std::optional<Value>>> {
-  std::vector<std::optional<Value>> results;
+  return executor_.submit(
+      [this, owned_keys = std::vector<Key>(keys.begin(), keys.end())] {
+        return gather_values(owned_keys);
+      });
+}
+
+[[nodiscard]] auto FlatMmapFeatureStore::get_multi_tensor_into_async_impl(
+    std::span<const Key> keys, std::span<float> out) const
+    -> std::future<std::vector<std::size_t>> {
+  return executor_.submit(
+      [this, owned_keys = std::vector<Key>(keys.begin(), keys.end()), out] {
+        return get_multi_tensor_into_impl(owned_keys, out);
+      });
+}
+
+auto FlatMmapFeatureStore::prefetch(std::span<const Key> keys) const -> void {
+  if (!tensor_size_.has_value()) {
+    return;
+  }
+  // Advice only queues reads, but resolving a large batch is not free, so
+  // it runs on the executor and is skipped when that has no workers
+  executor_.post(
+      [this, owned_keys = std::vector<Key>(keys.begin(), keys.end())] {
+        std::vector<detail::RowRef> rows;
+        rows.reserve(owned_keys.size());
+        index_.for_each_slot(
+            owned_keys,
+            [&](std::size_t first, std::span<const std::size_t> slots) {
+              for (std::size_t i = 0; i < slots.size(); ++i) {
+                if (slots[i] != detail::missing_slot &&
+                    hot_cache_.find(slots[i]) == nullptr) {
+                  rows.push_back({.slot = slots[i], .position = first + i});
+                }
+              }
+            });
+        advise_rows(rows);
+      });
+}
 
+auto FlatMmapFeatureStore::gather_values(std::span<const Key> keys) const
+    -> std::vector<std::optional<Value>> {
+  std::vector<std::optional<Value>> results(keys.size());
   if (!tensor_size_.has_value()) {
     GGB_LOG_WARN("Empty tensor dimension found");
-    results.assign(keys.size(), std::nullopt);
+    return results;
+  }
+
+  detail::parallel_chunks(gather_pool_, keys.size(), cfg_.gather.grain_size,
+                          [&](std::size_t begin, std::size_t end) {
+                            return gather_range(keys, begin, end, results);
+                          });
+  return results;
+}
+
+auto FlatMmapFeatureStore::gather_range(
+    std::span<const Key> keys, std::size_t begin, std::size_t end,
+    std::span<std::optional<Value>> results) const
+    -> std::vector<std::size_t> {
+  std::vector<std::size_t> missing;
+  std::uint64_t hits = 0;
+  detail::StageClock clock(metrics_);
+  if (cfg_.coalesce.enabled) {
+    std::vector<detail::RowRef> rows;
+    missing = plan_range(keys, begin, end, rows);
+    clock.lap(detail::Stage::Index);
+    for (const auto &row : rows) {
+      results[row.position] = row_value(row.slot, hits);
+    }
+    clock.lap(detail::Stage::Copy);
   } else {
-    results.reserve(keys.size());
-    const auto *const mapped_data = static_cast<const float *>(mmap_.data());
-
-    for (const auto &key : keys) {
-      if (auto it = key_to_byte_.find(key); it != key_to_byte_.end()) {
-        const float *start = mapped_data + (it->second / sizeof(float));
-        results.emplace_back(Value(start, start + tensor_size_.value()));
-      } else {
-        results.emplace_back(std::nullopt);
+    index_.for_each_slot(
+        keys.subspan(begin, end - begin),
+        [&](std::size_t first, std::span<const std::size_t> slots) {
+          clock.lap(detail::Stage::Index);
+          for (std::size_t i = 0; i < slots.size(); ++i) {
+            if (slots[i] != detail::missing_slot) {
+              results[begin + first + i] = row_value(slots[i], hits);
+            } else {
+              missing.push_back(begin + first + i);
+            }
+          }
+          clock.lap(detail::Stage::Copy);
+        });
+  }
+  metrics_.add_lookup(end - begin, missing.size(),
+                      tensor_size_.value() * sizeof(float));
+  hot_hits_.fetch_add(hits, std::memory_order_relaxed);
+  hot_misses_.fetch_add(end - begin - missing.size() - hits,
+                        std::memory_order_relaxed);
+  return missing;
+}
+
+auto FlatMmapFeatureStore::plan_range(std::span<const Key> keys,
+                                      std::size_t begin, std::size_t end,
+                                      std::vector<detail::RowRef> &rows) const
+    -> std::vector<std::size_t> {
+  std::vector<std::size_t> missing;
+  rows.reserve(end - begin);
+  index_.for_each_slot(
+      keys.subspan(begin, end - begin),
+      [&](std::size_t first, std::span<const std::size_t> slots) {
+        for (std::size_t i = 0; i < slots.size(); ++i) {
+          if (slots[i] != detail::missing_slot) {
+            rows.push_back({.slot = slots[i], .position = begin + first + i});
+          } else {
+            missing.push_back(begin + first + i);
+          }
+        }
+      });
+
+  // Start reading every range, in file order, before the first row is
+  // touched, so the faults that follow wait on reads already in flight
+  const auto num_ranges = advise_rows(rows);
+  coalesced_rows_.fetch_add(rows.size(), std::memory_order_relaxed);
+  coalesced_ranges_.fetch_add(num_ranges, std::memory_order_relaxed);
+  return missing;
+}
+
+auto FlatMmapFeatureStore::advise_rows(std::span<detail::RowRef> rows) const
+    -> std::size_t {
+  const auto ranges = detail::plan_reads(
+      rows, header_.data_offset, header_.row_bytes(), detail::store_alignment,
+      cfg_.coalesce.max_range_bytes);
+  for (const auto &range : ranges) {
+    mmap_.advise(range.offset, range.length, MADV_WILLNEED);
+  }
+  return ranges.size();
+}
+
+auto FlatMmapFeatureStore::row_value(std::size_t slot,
+                                     std::uint64_t &hot_hits) const -> Value {
+  const auto tensor_size = tensor_size_.value();
+  if (const auto *row = hot_cache_.find(slot)) {
+    ++hot_hits;
+    return {row, row + tensor_size};
+  }
+  if (header_.dtype == StorageDType::F32) {
+    const auto *row = reinterpret_cast<const float *>(row_at(slot));
+    return {row, row + tensor_size};
+  }
+  Value row(tensor_size);
+  detail::decode_row(header_.dtype, row_at(slot), tensor_size, row.data());
+  return row;
+}
+
+[[nodiscard]] auto FlatMmapFeatureStore::get_multi_tensor_into_impl(
+    std::span<const Key> keys, std::span<float> out) const
+    -> std::vector<std::size_t> {
+  if (!tensor_size_.has_value()) {
+    GGB_LOG_WARN("Empty tensor dimension found");
+    std::vector<std::size_t> missing(keys.size());
+    std::iota(missing.begin(), missing.end(), std::size_t{0});
+    return missing;
+  }
+
+  const bool streaming =
+      cfg_.gather.streaming_min_bytes > 0 &&
+      keys.size() * tensor_size_.value() * sizeof(float) >=
+          cfg_.gather.streaming_min_bytes;
+  // Split across threads, the page faults of one batch are taken
+  // concurrently instead of one after another
+  return detail::concat_chunks(detail::parallel_chunks(
+      gather_pool_, keys.size(), cfg_.gather.grain_size,
+      [&](std::size_t begin, std::size_t end) {
+        return gather_range_into(keys, begin, end, out, streaming);
+      }));
+}
+
+auto FlatMmapFeatureStore::gather_range_into(std::span<const Key> keys,
+                                             std::size_t begin,
+                                             std::size_t end,
+                                             std::span<float> out,
+                                             bool streaming) const
+    -> std::vector<std::size_t> {
+  std::vector<std::size_t> missing;
+  const auto tensor_size = tensor_size_.value();
+  const auto row_bytes = header_.row_bytes();
+  const auto prefetch_distance = cfg_.gather.prefetch_distance;
+  std::uint64_t hits = 0;
+  detail::StageClock clock(metrics_);
+  if (cfg_.coalesce.enabled) {
+    std::vector<detail::RowRef> rows;
+    missing = plan_range(keys, begin, end, rows);
+    clock.lap(detail::Stage::Index);
+    for (std::size_t i = 0; i < rows.size(); ++i) {
+      if (prefetch_distance > 0 && i + prefetch_distance < rows.size()) {
+        detail::prefetch_row(row_at(rows[i + prefetch_distance].slot),
+                             row_bytes);
       }
+      copy_row(rows[i].slot, out.data() + (rows[i].position * tensor_size),
+               streaming, hits);
+    }
+    for (const auto pos : missing) {
+      std::fill_n(out.data() + (pos * tensor_size), tensor_size, 0.0F);
     }
+    clock.lap(detail::Stage::Copy);
+  } else {
+    index_.for_each_slot(
+        keys.subspan(begin, end - begin),
+        [&](std::size_t first, std::span<const std::size_t> slots) {
+          clock.lap(detail::Stage::Index);
+          for (std::size_t i = 0; i < slots.size(); ++i) {
+            if (prefetch_distance > 0 && i + prefetch_distance < slots.size() &&
+                slots[i + prefetch_distance] != detail::missing_slot) {
+              detail::prefetch_row(row_at(slots[i + prefetch_distance]),
+                                   row_bytes);
+            }
+            const auto pos = begin + first + i;
+            float *dst = out.data() + (pos * tensor_size);
+            if (slots[i] != detail::missing_slot) {
+              copy_row(slots[i], dst, streaming, hits);
+            } else {
+              std::fill_n(dst, tensor_size, 0.0F);
+              missing.push_back(pos);
+            }
+          }
+          clock.lap(detail::Stage::Copy);
+        });
+  }
+  // Non-temporal stores are fenced on the thread that issued them
+  if (streaming) {
+    detail::store_fence();
+  }
+  metrics_.add_lookup(end - begin, missing.size(), tensor_size * sizeof(float));
+  hot_hits_.fetch_add(hits, std::memory_order_relaxed);
+  hot_misses_.fetch_add(end - begin - missing.size() - hits,
+                        std::memory_order_relaxed);
+  return missing;
+}
+
+// Copies stored bytes straight from the mapping; the hot cache holds
+// dequantized rows, so it is bypassed
+[[nodiscard]] auto FlatMmapFeatureStore::get_multi_tensor_native_into_impl(
+    std::span<const Key> keys, std::span<std::byte> out) const
+    -> std::vector<std::size_t> {
+  std::vector<std::size_t> missing;
+  const auto row_bytes = header_.row_bytes();
+  detail::StageClock clock(metrics_);
+  index_.for_each_slot(
+      keys, [&](std::size_t first, std::span<const std::size_t> slots) {
+        clock.lap(detail::Stage::Index);
+        for (std::size_t i = 0; i < slots.size(); ++i) {
+          std::byte *dst = out.data() + ((first + i) * row_bytes);
+          if (slots[i] != detail::missing_slot) {
+            std::copy_n(row_at(slots[i]), row_bytes, dst);
+          } else {
+            std::fill_n(dst, row_bytes, std::byte{0});
+            missing.push_back(first + i);
+          }
+        }
+        clock.lap(detail::Stage::Copy);
+      });
+  metrics_.add_lookup(keys.size(), missing.size(), row_bytes);
+  return missing;
+}
+
+[[nodiscard]] auto FlatMmapFeatureStore::get_missing_keys(
+    std::span<const Key> keys) const -> std::vector<std::size_t> {
+  std::vector<std::size_t> missing;
+  index_.for_each_slot(
+      keys, [&](std::size_t first, std::span<const std::size_t> slots) {
+        for (std::size_t i = 0; i < slots.size(); ++i) {
+          if (slots[i] == detail::missing_slot) {
+            missing.push_back(first + i);
+          }
+        }
+      });
+  return missing;
+}
+
+auto FlatMmapFeatureStore::row_at(std::size_t slot) const
+    -> const std::byte * {
+  return static_cast<const std::byte *>(mmap_.data()) + header_.data_offset +
+         (slot * header_.row_bytes());
+}
+
+auto FlatMmapFeatureStore::load_hot_cache() const -> detail::HotRowCache {
+  if (header_.hot_bytes == 0 || !tensor_size_.has_value()) {
+    return {};
   }
 
-  std::promise<std::vector<std::optional<Value>>> promise;
-  promise.set_value(std::move(results));
-  return promise.get_future();
+  detail::BinaryReader reader(
+      file_bytes(mmap_).subspan(header_.hot_offset, header_.hot_bytes));
+  const auto slots = reader.get_array<std::size_t>();
+  if (!std::ranges::is_sorted(slots) ||
+      (!slots.empty() && slots.back() >= header_.num_rows)) {
+    GGB_LOG_ERROR("Corrupt hot row section in {}", cfg_.db_path);
+    throw std::runtime_error("FlatMmapFeatureStore: corrupt hot rows");
+  }
+  // Pinned rows are kept dequantized, so hits skip the conversion
+  std::vector<float> row(tensor_size_.value());
+  return {slots, header_.num_rows, tensor_size_.value(),
+          [&](std::size_t slot) {
+            detail::decode_row(header_.dtype, row_at(slot), row.size(),
+                               row.data());
+            return row.data();
+          }};
 }
 
 FlatMmapFeatureStoreBuilder::FlatMmapFeatureStoreBuilder(
     const FlatMmapConfig &cfg)
-    : cfg_(cfg), out_file_(cfg.db_path, std::ios::binary) {}
+    : cfg_(cfg),
+      out_(std::make_unique<detail::BufferedWriter>(cfg.db_path, cfg.writer)),
+      index_(cfg.index) {
+  write_header_placeholder(*out_);
+}
 
 auto FlatMmapFeatureStoreBuilder::put_tensor_impl(const Key &key,
                                                   const Value &tensor) -> bool {
-  if (!out_file_) {
+  if (!out_->ok()) {
     GGB_LOG_ERROR("Could not write to file: {}", cfg_.db_path);
     return false;
   }
@@ -84,11 +467,8 @@ auto FlatMmapFeatureStoreBuilder::put_tensor_impl(const Key &key,
   }
   tensor_size_ = tensor.size();
 
-  key_to_byte_[key] = write_pos_;
-  auto bytes_to_write = tensor_size_.value() * sizeof(float);
-  out_file_.write(reinterpret_cast<const char *>(tensor.data()),
-                  bytes_to_write);
-  write_pos_ += bytes_to_write;
+  index_.insert(key);
+  write_rows(tensor);
   return true;
 }
 
@@ -97,17 +477,142 @@ auto FlatMmapFeatureStoreBuilder::put_tensor_impl(const Key &key,
   return put_tensor_impl(key, static_cast<const Value &>(tensor));
 }
 
+// One write for the whole batch instead of one per row
+auto FlatMmapFeatureStoreBuilder::put_tensors_impl(std::span<const Key> keys,
+                                                   std::span<const float> rows,
+                                                   std::size_t dim) -> bool {
+  if (!out_->ok()) {
+    GGB_LOG_ERROR("Could not write to file: {}", cfg_.db_path);
+    return false;
+  }
+  if (tensor_size_.has_value() && dim != tensor_size_.value()) {
+    GGB_LOG_ERROR("Mismatched tensor size: got {}, expected {}", dim,
+                  tensor_size_.value());
+    return false;
+  }
+  if (keys.empty()) {
+    return true;
+  }
+  tensor_size_ = dim;
+
+  for (const auto &key : keys) {
+    index_.insert(key);
+  }
+  write_rows(rows);
+  return true;
+}
+
+auto FlatMmapFeatureStoreBuilder::reserve_impl(std::size_t num_rows,
+                                               std::size_t dim) -> void {
+  if (tensor_size_.has_value() && dim != tensor_size_.value()) {
+    return;
+  }
+  // Rows follow the header block; the index appended at build is small
+  out_->preallocate(out_->size() +
+                    (num_rows * storage_row_bytes(cfg_.dtype, dim)));
+}
+
+auto FlatMmapFeatureStoreBuilder::write_rows(std::span<const float> rows)
+    -> void {
+  if (cfg_.dtype == StorageDType::F32) {
+    out_->write(rows.data(), rows.size_bytes());
+    write_pos_ += rows.size_bytes();
+    return;
+  }
+
+  const auto dim = tensor_size_.value();
+  const auto row_bytes = storage_row_bytes(cfg_.dtype, dim);
+  const auto num_rows = dim == 0 ? 0 : rows.size() / dim;
+  encoded_.resize(num_rows * row_bytes);
+  for (std::size_t i = 0; i < num_rows; ++i) {
+    detail::encode_row(cfg_.dtype, rows.subspan(i * dim, dim),
+                       encoded_.data() + (i * row_bytes));
+  }
+  out_->write(encoded_.data(), encoded_.size());
+  write_pos_ += encoded_.size();
+}
+
+auto FlatMmapFeatureStoreBuilder::reorder_rows(const GraphTopology &graph)
+    -> void {
+  const auto old_slots =
+      detail::plan_row_order(cfg_.row_order, index_.live_entries(), graph);
+  const auto row_bytes = storage_row_bytes(cfg_.dtype, tensor_size_.value());
+  const auto tmp_path = cfg_.db_path + ".reorder";
+
+  out_->flush();
+  {
+    // Gather rows from the file written so far into a copy in the new order
+    const detail::MmapRegion src(cfg_.db_path);
+    const auto *const data =
+        static_cast<const char *>(src.data()) + detail::store_alignment;
+    auto dst_cfg = cfg_.writer;
+    dst_cfg.preallocate_bytes =
+        std::max(dst_cfg.preallocate_bytes,
+                 detail::store_alignment + (old_slots.size() * row_bytes));
+    auto dst = std::make_unique<detail::BufferedWriter>(tmp_path, dst_cfg);
+    write_header_placeholder(*dst);
+    for (const auto old_slot : old_slots) {
+      dst->write(data + (old_slot * row_bytes), row_bytes);
+    }
+    dst->flush();
+    if (!dst->ok()) {
+      GGB_LOG_ERROR("Failed to write reordered rows to {}", tmp_path);
+      throw std::runtime_error("FlatMmapFeatureStoreBuilder: reorder failed");
+    }
+
+    // Keep appending to the copy, which replaces the original below
+    out_ = std::move(dst);
+  }
+  std::filesystem::rename(tmp_path, cfg_.db_path);
+  write_pos_ = old_slots.size() * row_bytes;
+  index_.permute(old_slots);
+}
+
 [[nodiscard]] auto FlatMmapFeatureStoreBuilder::build_impl(
-    [[maybe_unused]] std::optional<GraphTopology> graph)
-    -> std::unique_ptr<FeatureStore> {
-  out_file_.close();
+    std::optional<GraphTopology> graph) -> std::unique_ptr<FeatureStore> {
+  if (graph.has_value() && tensor_size_.has_value() &&
+      cfg_.row_order != RowOrder::Insertion) {
+    reorder_rows(graph.value());
+  }
+
+  const auto num_rows = index_.num_slots();
+  auto index = std::move(index_).build();
+
+  detail::StoreHeader header{.dtype = cfg_.dtype,
+                             .dim = tensor_size_.value_or(0),
+                             .num_rows = num_rows,
+                             .data_bytes = write_pos_};
+  header.index_offset = header.data_offset + header.data_bytes;
+
+  header.index_bytes = append_serialized(
+      *out_, [&](detail::BinaryWriter &writer) { index.save(writer); });
+
+  std::vector<std::size_t> hot_slots;
+  if (graph.has_value() && tensor_size_.has_value()) {
+    hot_slots = detail::select_hot_slots(index, num_rows, graph.value(),
+                                         cfg_.hot_cache,
+                                         tensor_size_.value() * sizeof(float));
+  }
+  if (!hot_slots.empty()) {
+    header.hot_offset = header.index_offset + header.index_bytes;
+    header.hot_bytes =
+        append_serialized(*out_, [&](detail::BinaryWriter &writer) {
+          writer.put_array<std::size_t>(hot_slots);
+        });
+  }
+
+  out_->write_at(0, &header, sizeof(header));
+  out_->close();
+
   GGB_LOG_INFO(
       "Building FlatMmapStore\n\tTotal Keys: {}\n\tFile Size: {:.3f} "
-      "GB\n\tPath: {}",
-      key_to_byte_.size(),
-      static_cast<double>(write_pos_) / (1024 * 1024 * 1024), cfg_.db_path);
-  return std::make_unique<FlatMmapFeatureStore>(cfg_, std::move(key_to_byte_),
-                                                tensor_size_);
+      "GB\n\tIndex: {} ({:.3f} MB)\n\tHot Rows: {}\n\tPath: {}",
+      index.size(),
+      static_cast<double>(header.index_offset + header.index_bytes) /
+          (1024 * 1024 * 1024),
+      index.kind(), static_cast<double>(index.memory_bytes()) / (1024 * 1024),
+      hot_slots.size(), cfg_.db_path);
+  return std::make_unique<FlatMmapFeatureStore>(cfg_, std::move(index));
 }
 
 }  // namespace ggb::engine
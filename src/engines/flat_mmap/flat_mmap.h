@@ -1,26 +1,36 @@
 #pragma once
 
+#include <atomic>
 #include <cstddef>
-#include <fstream>
+#include <cstdint>
 #include <future>
 #include <memory>
 #include <optional>
 #include <span>
 #include <string_view>
-#include <unordered_map>
 #include <vector>
 
+#include "common/buffered_writer.h"
+#include "common/dtype.h"
+#include "common/executor.h"
+#include "common/gather.h"
+#include "common/hot_row_cache.h"
+#include "common/key_index.h"
+#include "common/metrics.h"
 #include "common/mmap_region.h"
+#include "common/read_plan.h"
+#include "common/store_format.h"
 #include "ggb/core.h"
 
 namespace ggb::engine {
 
 class FlatMmapFeatureStore final : public FeatureStore {
  public:
-  explicit FlatMmapFeatureStore(
-      FlatMmapConfig cfg,
-      std::unordered_map<Key, std::size_t, KeyHash>&& key_to_byte,
-      std::optional<std::size_t> tensor_size);
+  // Maps an existing store at `cfg.db_path`, loading its serialized index
+  explicit FlatMmapFeatureStore(FlatMmapConfig cfg);
+
+  // Maps a freshly built store whose index is already in memory
+  FlatMmapFeatureStore(FlatMmapConfig cfg, detail::KeyIndex&& index);
 
   ~FlatMmapFeatureStore() override = default;
 
@@ -28,17 +38,99 @@ class FlatMmapFeatureStore final : public FeatureStore {
   [[nodiscard]] auto get_num_keys() const -> std::size_t override;
   [[nodiscard]] auto get_tensor_size() const
       -> std::optional<std::size_t> override;
+  [[nodiscard]] auto get_index_memory_bytes() const -> std::size_t override;
+  [[nodiscard]] auto get_storage_dtype() const -> StorageDType override;
+  [[nodiscard]] auto get_counters() const -> Counters override;
+  [[nodiscard]] auto get_metrics() const -> Metrics override;
+  [[nodiscard]] auto get_missing_keys(std::span<const Key> keys) const
+      -> std::vector<std::size_t> override;
   [[nodiscard]] auto get_multi_tensor_async(std::span<const Key> keys) const
       -> std::future<std::vector<std::optional<Value>>> override;
 
+  // Advises in the coalesced page ranges of rows not pinned in RAM
+  auto prefetch(std::span<const Key> keys) const -> void override;
+
+ protected:
+  [[nodiscard]] auto get_multi_tensor_into_impl(std::span<const Key> keys,
+                                                std::span<float> out) const
+      -> std::vector<std::size_t> override;
+  [[nodiscard]] auto get_multi_tensor_into_async_impl(
+      std::span<const Key> keys, std::span<float> out) const
+      -> std::future<std::vector<std::size_t>> override;
+  [[nodiscard]] auto get_multi_tensor_native_into_impl(
+      std::span<const Key> keys, std::span<std::byte> out) const
+      -> std::vector<std::size_t> override;
+
  private:
   static constexpr std::string_view name_ = "FlatMmapFeatureStore";
 
+  [[nodiscard]] auto gather_values(std::span<const Key> keys) const
+      -> std::vector<std::optional<Value>>;
+
+  // Gather keys [begin, end) of a batch, on whichever thread
+  // `parallel_chunks` assigns them to; return the positions not found
+  auto gather_range(std::span<const Key> keys, std::size_t begin,
+                    std::size_t end,
+                    std::span<std::optional<Value>> results) const
+      -> std::vector<std::size_t>;
+  auto gather_range_into(std::span<const Key> keys, std::size_t begin,
+                         std::size_t end, std::span<float> out,
+                         bool streaming) const -> std::vector<std::size_t>;
+
+  // Resolves keys [begin, end) into `rows` in file order, advises in the
+  // coalesced page ranges they span and returns the positions not found
+  auto plan_range(std::span<const Key> keys, std::size_t begin,
+                  std::size_t end, std::vector<detail::RowRef>& rows) const
+      -> std::vector<std::size_t>;
+
+  // Sorts `rows` into file order and starts reading the merged page ranges
+  // they span with MADV_WILLNEED; returns the number of ranges
+  auto advise_rows(std::span<detail::RowRef> rows) const -> std::size_t;
+  [[nodiscard]] auto row_at(std::size_t slot) const -> const std::byte*;
+  [[nodiscard]] auto row_value(std::size_t slot, std::uint64_t& hot_hits) const
+      -> Value;
+  [[nodiscard]] auto load_hot_cache() const -> detail::HotRowCache;
+
+  // Writes the fp32 row of `slot` to `dst`, from the hot cache if pinned
+  // there, else from the mapping, dequantizing reduced-precision rows
+  auto copy_row(std::size_t slot, float* dst, bool streaming,
+                std::uint64_t& hot_hits) const -> void {
+    if (const auto* row = hot_cache_.find(slot)) {
+      ++hot_hits;
+      copier_.copy(row, dst, streaming);
+    } else if (header_.dtype == StorageDType::F32) {
+      copier_.copy(reinterpret_cast<const float*>(row_at(slot)), dst,
+                   streaming);
+    } else {
+      detail::decode_row(header_.dtype, row_at(slot), tensor_size_.value(),
+                         dst);
+    }
+  }
+
   const FlatMmapConfig cfg_;
-  const std::unordered_map<Key, std::size_t, KeyHash> key_to_byte_;
+  detail::MmapRegion mmap_;
+  const detail::StoreHeader header_;
+  const detail::KeyIndex index_;
   const std::optional<std::size_t> tensor_size_;
+  const detail::HotRowCache hot_cache_;
+  const detail::RowCopier copier_;
 
-  detail::MmapRegion mmap_;
+  // Rows served from `hot_cache_` and from the mapping
+  mutable std::atomic<std::uint64_t> hot_hits_{0};
+  mutable std::atomic<std::uint64_t> hot_misses_{0};
+
+  // Rows and merged page ranges planned by `cfg_.coalesce`
+  mutable std::atomic<std::uint64_t> coalesced_rows_{0};
+  mutable std::atomic<std::uint64_t> coalesced_ranges_{0};
+
+  // Keys, bytes and stage timings of lookups, see `get_metrics`
+  mutable detail::LookupMetrics metrics_;
+
+  // Splits large batches; outlives `executor_`, whose tasks submit to it
+  mutable detail::Executor gather_pool_;
+
+  // Declared last so in-flight lookups drain before the mapping is released
+  mutable detail::Executor executor_;
 };
 
 class FlatMmapFeatureStoreBuilder final : public FeatureStoreBuilder {
@@ -47,17 +139,29 @@ class FlatMmapFeatureStoreBuilder final : public FeatureStoreBuilder {
 
   auto put_tensor_impl(const Key& key, const Value& tensor) -> bool override;
   auto put_tensor_impl(const Key& key, Value&& tensor) -> bool override;
+  auto put_tensors_impl(std::span<const Key> keys, std::span<const float> rows,
+                        std::size_t dim) -> bool override;
+
+  // Preallocates the file for `num_rows` more rows through the writer
+  auto reserve_impl(std::size_t num_rows, std::size_t dim) -> void override;
 
   [[nodiscard]] auto build_impl(
       std::optional<GraphTopology> graph = std::nullopt)
       -> std::unique_ptr<FeatureStore> override;
 
  private:
+  // Rewrites the data section and the slots in `index_` in `cfg_.row_order`
+  auto reorder_rows(const GraphTopology& graph) -> void;
+
+  // Appends rows of `tensor_size_` floats in `cfg_.dtype`
+  auto write_rows(std::span<const float> rows) -> void;
+
   const FlatMmapConfig cfg_;
-  std::ofstream out_file_;
-  std::unordered_map<Key, std::size_t, KeyHash> key_to_byte_;
+  std::unique_ptr<detail::BufferedWriter> out_;
+  detail::KeyIndexBuilder index_;
   std::optional<std::size_t> tensor_size_;
-  std::size_t write_pos_{0};
+  std::size_t write_pos_{0};  // Bytes written to the data section
+  std::vector<std::byte> encoded_;  // Staging for reduced-precision rows
 };
 
 }  // namespace ggb::engine
@@ -1,31 +1,44 @@
 #include "in_memory.h"
 
+#include <algorithm>
 #include <cstddef>
 #include <future>
 #include <memory>
+#include <numeric>
 #include <optional>
-#include <unordered_map>
+#include <span>
 #include <utility>
 #include <vector>
 
+#include "common/dtype.h"
 #include "common/logging.h"
+#include "common/row_order.h"
 
 namespace ggb::engine {
 
 InMemoryFeatureStore::InMemoryFeatureStore(
-    std::vector<float> &&blob,
-    std::unordered_map<Key, std::size_t, KeyHash> &&offsets,
-    std::optional<std::size_t> tensor_size)
-    : blob_(std::move(blob)),
-      offsets_(std::move(offsets)),
-      tensor_size_(tensor_size) {}
+    InMemoryConfig cfg, detail::PageBuffer &&blob,
+    detail::KeyIndex &&index, std::optional<std::size_t> tensor_size)
+    : cfg_(std::move(cfg)),
+      blob_(std::move(blob)),
+      index_(std::move(index)),
+      tensor_size_(tensor_size),
+      copier_(tensor_size.value_or(0)),
+      gather_pool_({.num_threads = cfg_.gather.num_threads}),
+      executor_(cfg_.executor) {
+  // The rows were mapped onto huge pages by the builder; the index arrays
+  // are regular allocations and can only be collapsed after the fact
+  if (cfg_.huge_pages != HugePages::None) {
+    index_.for_each_array(detail::advise_huge_pages);
+  }
+}
 
 [[nodiscard]] auto InMemoryFeatureStore::name() const -> std::string_view {
   return name_;
 }
 
 [[nodiscard]] auto InMemoryFeatureStore::get_num_keys() const -> std::size_t {
-  return offsets_.size();
+  return index_.size();
 }
 
 [[nodiscard]] auto InMemoryFeatureStore::get_tensor_size() const
@@ -33,37 +46,202 @@ InMemoryFeatureStore::InMemoryFeatureStore(
   return tensor_size_;
 }
 
+[[nodiscard]] auto InMemoryFeatureStore::get_index_memory_bytes() const
+    -> std::size_t {
+  return index_.memory_bytes();
+}
+
+[[nodiscard]] auto InMemoryFeatureStore::get_storage_dtype() const
+    -> StorageDType {
+  return cfg_.dtype;
+}
+
+[[nodiscard]] auto InMemoryFeatureStore::get_metrics() const -> Metrics {
+  auto metrics = FeatureStore::get_metrics();
+  metrics_.snapshot(metrics);
+  return metrics;
+}
+
 [[nodiscard]] auto InMemoryFeatureStore::get_multi_tensor_async(
     std::span<const Key> keys) const
     -> std::future<std::vector<std::optional<Value>>> {
-  std::vector<std::optional<Value>> results;
+  return executor_.submit(
+      [this, owned_keys = std::vector<Key>(keys.begin(), keys.end())] {
+        return gather_values(owned_keys);
+      });
+}
+
+[[nodiscard]] auto InMemoryFeatureStore::get_multi_tensor_into_async_impl(
+    std::span<const Key> keys, std::span<float> out) const
+    -> std::future<std::vector<std::size_t>> {
+  return executor_.submit(
+      [this, owned_keys = std::vector<Key>(keys.begin(), keys.end()), out] {
+        return get_multi_tensor_into_impl(owned_keys, out);
+      });
+}
+
+auto InMemoryFeatureStore::gather_values(std::span<const Key> keys) const
+    -> std::vector<std::optional<Value>> {
+  std::vector<std::optional<Value>> results(keys.size());
   if (!tensor_size_.has_value()) {
     GGB_LOG_WARN("Empty tensor dimension found");
-    results.assign(keys.size(), std::nullopt);
-  } else {
-    results.reserve(keys.size());
-
-    for (const auto &key : keys) {
-      if (auto it = offsets_.find(key); it != offsets_.end()) {
-        const float *start = blob_.data() + it->second;
-        results.emplace_back(Value(start, start + tensor_size_.value()));
-      } else {
-        results.emplace_back(std::nullopt);
-      }
-    }
+    return results;
   }
 
-  std::promise<std::vector<std::optional<Value>>> promise;
-  promise.set_value(std::move(results));
-  return promise.get_future();
+  detail::parallel_chunks(gather_pool_, keys.size(), cfg_.gather.grain_size,
+                          [&](std::size_t begin, std::size_t end) {
+                            return gather_range(keys, begin, end, results);
+                          });
+  return results;
+}
+
+auto InMemoryFeatureStore::gather_range(
+    std::span<const Key> keys, std::size_t begin, std::size_t end,
+    std::span<std::optional<Value>> results) const
+    -> std::vector<std::size_t> {
+  std::vector<std::size_t> missing;
+  const auto tensor_size = tensor_size_.value();
+  detail::StageClock clock(metrics_);
+  index_.for_each_slot(
+      keys.subspan(begin, end - begin),
+      [&](std::size_t first, std::span<const std::size_t> slots) {
+        clock.lap(detail::Stage::Index);
+        for (std::size_t i = 0; i < slots.size(); ++i) {
+          const auto pos = begin + first + i;
+          if (slots[i] == detail::missing_slot) {
+            missing.push_back(pos);
+          } else if (cfg_.dtype == StorageDType::F32) {
+            const auto *start =
+                reinterpret_cast<const float *>(row_at(slots[i]));
+            results[pos].emplace(start, start + tensor_size);
+          } else {
+            auto &row = results[pos].emplace(tensor_size);
+            detail::decode_row(cfg_.dtype, row_at(slots[i]), tensor_size,
+                               row.data());
+          }
+        }
+        clock.lap(detail::Stage::Copy);
+      });
+  metrics_.add_lookup(end - begin, missing.size(),
+                      tensor_size * sizeof(float));
+  return missing;
+}
+
+[[nodiscard]] auto InMemoryFeatureStore::get_multi_tensor_into_impl(
+    std::span<const Key> keys, std::span<float> out) const
+    -> std::vector<std::size_t> {
+  if (!tensor_size_.has_value()) {
+    GGB_LOG_WARN("Empty tensor dimension found");
+    std::vector<std::size_t> missing(keys.size());
+    std::iota(missing.begin(), missing.end(), std::size_t{0});
+    return missing;
+  }
+
+  const bool streaming =
+      cfg_.gather.streaming_min_bytes > 0 &&
+      keys.size() * tensor_size_.value() * sizeof(float) >=
+          cfg_.gather.streaming_min_bytes;
+  return detail::concat_chunks(detail::parallel_chunks(
+      gather_pool_, keys.size(), cfg_.gather.grain_size,
+      [&](std::size_t begin, std::size_t end) {
+        return gather_range_into(keys, begin, end, out, streaming);
+      }));
+}
+
+auto InMemoryFeatureStore::gather_range_into(std::span<const Key> keys,
+                                             std::size_t begin,
+                                             std::size_t end,
+                                             std::span<float> out,
+                                             bool streaming) const
+    -> std::vector<std::size_t> {
+  std::vector<std::size_t> missing;
+  const auto tensor_size = tensor_size_.value();
+  const auto row_bytes = storage_row_bytes(cfg_.dtype, tensor_size);
+  const auto prefetch_distance = cfg_.gather.prefetch_distance;
+  detail::StageClock clock(metrics_);
+  index_.for_each_slot(
+      keys.subspan(begin, end - begin),
+      [&](std::size_t first, std::span<const std::size_t> slots) {
+        clock.lap(detail::Stage::Index);
+        for (std::size_t i = 0; i < slots.size(); ++i) {
+          if (prefetch_distance > 0 && i + prefetch_distance < slots.size() &&
+              slots[i + prefetch_distance] != detail::missing_slot) {
+            detail::prefetch_row(row_at(slots[i + prefetch_distance]),
+                                 row_bytes);
+          }
+          const auto pos = begin + first + i;
+          float *dst = out.data() + (pos * tensor_size);
+          if (slots[i] == detail::missing_slot) {
+            std::fill_n(dst, tensor_size, 0.0F);
+            missing.push_back(pos);
+          } else if (cfg_.dtype == StorageDType::F32) {
+            copier_.copy(reinterpret_cast<const float *>(row_at(slots[i])),
+                         dst, streaming);
+          } else {
+            detail::decode_row(cfg_.dtype, row_at(slots[i]), tensor_size,
+                               dst);
+          }
+        }
+        clock.lap(detail::Stage::Copy);
+      });
+  // Non-temporal stores are fenced on the thread that issued them
+  if (streaming) {
+    detail::store_fence();
+  }
+  metrics_.add_lookup(end - begin, missing.size(),
+                      tensor_size * sizeof(float));
+  return missing;
+}
+
+[[nodiscard]] auto InMemoryFeatureStore::get_multi_tensor_native_into_impl(
+    std::span<const Key> keys, std::span<std::byte> out) const
+    -> std::vector<std::size_t> {
+  std::vector<std::size_t> missing;
+  const auto row_bytes =
+      storage_row_bytes(cfg_.dtype, tensor_size_.value_or(0));
+  detail::StageClock clock(metrics_);
+  index_.for_each_slot(
+      keys, [&](std::size_t first, std::span<const std::size_t> slots) {
+        clock.lap(detail::Stage::Index);
+        for (std::size_t i = 0; i < slots.size(); ++i) {
+          std::byte *dst = out.data() + ((first + i) * row_bytes);
+          if (slots[i] != detail::missing_slot) {
+            std::copy_n(row_at(slots[i]), row_bytes, dst);
+          } else {
+            std::fill_n(dst, row_bytes, std::byte{0});
+            missing.push_back(first + i);
+          }
+        }
+        clock.lap(detail::Stage::Copy);
+      });
+  metrics_.add_lookup(keys.size(), missing.size(), row_bytes);
+  return missing;
+}
+
+[[nodiscard]] auto InMemoryFeatureStore::get_missing_keys(
+    std::span<const Key> keys) const -> std::vector<std::size_t> {
+  std::vector<std::size_t> missing;
+  index_.for_each_slot(
+      keys, [&](std::size_t first, std::span<const std::size_t> slots) {
+        for (std::size_t i = 0; i < slots.size(); ++i) {
+          if (slots[i] == detail::missing_slot) {
+            missing.push_back(first + i);
+          }
+        }
+      });
+  return missing;
+}
+
+auto InMemoryFeatureStore::row_at(std::size_t slot) const
+    -> const std::byte * {
+  return blob_.data() +
+         (slot * storage_row_bytes(cfg_.dtype, tensor_size_.value()));
 }
 
 auto InMemoryFeatureStoreBuilder::put_tensor_impl(const Key &key,
                                                   const Value &tensor) -> bool {
   if (!tensor_size_.has_value()) {
-    tensor_size_ = tensor.size();
-    constexpr auto num_nodes_to_reserve = 10'000;
-    blob_.reserve(tensor_size_.value() * num_nodes_to_reserve);
+    init_tensor_size(tensor.size());
   }
 
   if (tensor.size() != tensor_size_.value()) {
@@ -72,8 +250,8 @@ auto InMemoryFeatureStoreBuilder::put_tensor_impl(const Key &key,
     return false;
   }
 
-  offsets_[key] = blob_.size();
-  blob_.insert(blob_.end(), tensor.begin(), tensor.end());
+  index_.insert(key);
+  append_rows(tensor);
   return true;
 }
 
@@ -82,14 +260,120 @@ auto InMemoryFeatureStoreBuilder::put_tensor_impl(const Key &key,
   return put_tensor_impl(key, static_cast<const Value &>(tensor));
 }
 
+// One append for the whole batch instead of one per row
+auto InMemoryFeatureStoreBuilder::put_tensors_impl(std::span<const Key> keys,
+                                                   std::span<const float> rows,
+                                                   std::size_t dim) -> bool {
+  if (tensor_size_.has_value() && dim != tensor_size_.value()) {
+    GGB_LOG_ERROR("Mismatched tensor size: got {}, expected {}", dim,
+                  tensor_size_.value());
+    return false;
+  }
+  if (keys.empty()) {
+    return true;
+  }
+  if (!tensor_size_.has_value()) {
+    init_tensor_size(dim);
+  }
+
+  for (const auto &key : keys) {
+    index_.insert(key);
+  }
+  append_rows(rows);
+  return true;
+}
+
+auto InMemoryFeatureStoreBuilder::reserve_impl(std::size_t num_rows,
+                                               std::size_t dim) -> void {
+  if (tensor_size_.has_value() && dim != tensor_size_.value()) {
+    return;
+  }
+  blob_.reserve(blob_.size() + (num_rows * storage_row_bytes(cfg_.dtype, dim)));
+}
+
+auto InMemoryFeatureStoreBuilder::init_tensor_size(std::size_t dim) -> void {
+  tensor_size_ = dim;
+  constexpr std::size_t default_rows = 10'000;
+  const auto rows =
+      cfg_.expected_rows > 0 ? cfg_.expected_rows : default_rows;
+  blob_.reserve(rows * storage_row_bytes(cfg_.dtype, dim));
+}
+
+auto InMemoryFeatureStoreBuilder::append_rows(std::span<const float> rows)
+    -> void {
+  const auto dim = tensor_size_.value();
+  const auto row_bytes = storage_row_bytes(cfg_.dtype, dim);
+  const auto num_rows = dim == 0 ? 0 : rows.size() / dim;
+  const auto end = blob_.size();
+  blob_.resize(end + (num_rows * row_bytes));
+  for (std::size_t i = 0; i < num_rows; ++i) {
+    detail::encode_row(cfg_.dtype, rows.subspan(i * dim, dim),
+                       blob_.data() + end + (i * row_bytes));
+  }
+}
+
+auto InMemoryFeatureStoreBuilder::reorder_rows(const GraphTopology &graph)
+    -> void {
+  const auto old_slots =
+      detail::plan_row_order(cfg_.row_order, index_.live_entries(), graph);
+  const auto row_bytes = storage_row_bytes(cfg_.dtype, tensor_size_.value());
+
+  // Stale rows take the slots past the live ones, turning `old_slots` into
+  // a permutation of every row that can be applied cycle by cycle with one
+  // row of scratch, instead of a second copy of the table
+  const auto num_live = old_slots.size();
+  const auto num_rows = index_.num_slots();
+  std::vector<std::size_t> sources(old_slots.begin(), old_slots.end());
+  std::vector<bool> live(num_rows, false);
+  for (const auto slot : old_slots) {
+    live[slot] = true;
+  }
+  for (std::size_t slot = 0; slot < num_rows; ++slot) {
+    if (!live[slot]) {
+      sources.push_back(slot);
+    }
+  }
+
+  std::vector<bool> placed(num_rows, false);
+  std::vector<std::byte> scratch(row_bytes);
+  auto row = [&](std::size_t slot) {
+    return blob_.data() + (slot * row_bytes);
+  };
+  for (std::size_t start = 0; start < num_live; ++start) {
+    if (placed[start] || sources[start] == start) {
+      continue;
+    }
+    std::copy_n(row(start), row_bytes, scratch.data());
+    auto slot = start;
+    while (sources[slot] != start) {
+      std::copy_n(row(sources[slot]), row_bytes, row(slot));
+      placed[slot] = true;
+      slot = sources[slot];
+    }
+    std::copy_n(scratch.data(), row_bytes, row(slot));
+    placed[slot] = true;
+  }
+  blob_.resize(num_live * row_bytes);
+  index_.permute(old_slots);
+}
+
 [[nodiscard]] auto InMemoryFeatureStoreBuilder::build_impl(
-    [[maybe_unused]] std::optional<GraphTopology> graph)
-    -> std::unique_ptr<FeatureStore> {
+    std::optional<GraphTopology> graph) -> std::unique_ptr<FeatureStore> {
+  if (graph.has_value() && tensor_size_.has_value() &&
+      cfg_.row_order != RowOrder::Insertion) {
+    reorder_rows(graph.value());
+  }
+
+  blob_.shrink_to_fit();
+
+  auto index = std::move(index_).build();
   GGB_LOG_INFO(
-      "Building InMemoryStore\n\tTotal Keys: {}\n\tEst. Memory: {:.3f} GB",
-      offsets_.size(),
-      static_cast<double>(blob_.size() * sizeof(float)) / (1024 * 1024 * 1024));
+      "Building InMemoryStore\n\tTotal Keys: {}\n\tEst. Memory: {:.3f} "
+      "GB\n\tIndex: {} ({:.3f} MB)",
+      index.size(),
+      static_cast<double>(blob_.size()) / (1024 * 1024 * 1024),
+      index.kind(), static_cast<double>(index.memory_bytes()) / (1024 * 1024));
   return std::make_unique<InMemoryFeatureStore>(
-      std::move(blob_), std::move(offsets_), tensor_size_);
+      cfg_, std::move(blob_), std::move(index), tensor_size_);
 }
 }  // namespace ggb::engine
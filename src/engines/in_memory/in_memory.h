@@ -1,13 +1,18 @@
 #pragma once
 
+#include <cstddef>
 #include <future>
 #include <memory>
 #include <optional>
 #include <span>
 #include <string_view>
-#include <unordered_map>
 #include <vector>
 
+#include "common/executor.h"
+#include "common/gather.h"
+#include "common/key_index.h"
+#include "common/metrics.h"
+#include "common/page_buffer.h"
 #include "ggb/core.h"
 
 namespace ggb::engine {
@@ -15,39 +20,95 @@ namespace ggb::engine {
 class InMemoryFeatureStore final : public FeatureStore {
  public:
   explicit InMemoryFeatureStore(
-      std::vector<float> &&blob,
-      std::unordered_map<Key, std::size_t, KeyHash> &&offsets,
-      std::optional<std::size_t> tensor_size);
+      InMemoryConfig cfg, detail::PageBuffer &&blob,
+      detail::KeyIndex &&index, std::optional<std::size_t> tensor_size);
 
   [[nodiscard]] auto name() const -> std::string_view override;
   [[nodiscard]] auto get_num_keys() const -> std::size_t override;
   [[nodiscard]] auto get_tensor_size() const
       -> std::optional<std::size_t> override;
+  [[nodiscard]] auto get_index_memory_bytes() const -> std::size_t override;
+  [[nodiscard]] auto get_storage_dtype() const -> StorageDType override;
+  [[nodiscard]] auto get_metrics() const -> Metrics override;
+  [[nodiscard]] auto get_missing_keys(std::span<const Key> keys) const
+      -> std::vector<std::size_t> override;
   [[nodiscard]] auto get_multi_tensor_async(std::span<const Key> keys) const
       -> std::future<std::vector<std::optional<Value>>> override;
 
+ protected:
+  [[nodiscard]] auto get_multi_tensor_into_impl(std::span<const Key> keys,
+                                                std::span<float> out) const
+      -> std::vector<std::size_t> override;
+  [[nodiscard]] auto get_multi_tensor_into_async_impl(
+      std::span<const Key> keys, std::span<float> out) const
+      -> std::future<std::vector<std::size_t>> override;
+  [[nodiscard]] auto get_multi_tensor_native_into_impl(
+      std::span<const Key> keys, std::span<std::byte> out) const
+      -> std::vector<std::size_t> override;
+
  private:
   static constexpr std::string_view name_ = "InMemoryFeatureStore";
-  const std::vector<float> blob_;
-  const std::unordered_map<Key, std::size_t, KeyHash> offsets_;
+
+  [[nodiscard]] auto gather_values(std::span<const Key> keys) const
+      -> std::vector<std::optional<Value>>;
+
+  // Gather keys [begin, end) of a batch, on whichever thread
+  // `parallel_chunks` assigns them to; return the positions not found
+  auto gather_range(std::span<const Key> keys, std::size_t begin,
+                    std::size_t end,
+                    std::span<std::optional<Value>> results) const
+      -> std::vector<std::size_t>;
+  auto gather_range_into(std::span<const Key> keys, std::size_t begin,
+                         std::size_t end, std::span<float> out,
+                         bool streaming) const -> std::vector<std::size_t>;
+  [[nodiscard]] auto row_at(std::size_t slot) const -> const std::byte *;
+
+  const InMemoryConfig cfg_;
+  const detail::PageBuffer blob_;  // Rows of `cfg_.dtype`
+  const detail::KeyIndex index_;
   const std::optional<std::size_t> tensor_size_;
+  const detail::RowCopier copier_;
+
+  // Keys, bytes and stage timings of lookups, see `get_metrics`
+  mutable detail::LookupMetrics metrics_;
+
+  // Splits large batches; outlives `executor_`, whose tasks submit to it
+  mutable detail::Executor gather_pool_;
+
+  // Declared last so in-flight lookups drain before the data is destroyed
+  mutable detail::Executor executor_;
 };
 
 class InMemoryFeatureStoreBuilder final : public FeatureStoreBuilder {
  public:
-  explicit InMemoryFeatureStoreBuilder(
-      [[maybe_unused]] const InMemoryConfig &cfg) {}
+  explicit InMemoryFeatureStoreBuilder(const InMemoryConfig &cfg)
+      : cfg_(cfg), blob_(cfg.huge_pages), index_(cfg.index) {}
 
   auto put_tensor_impl(const Key &key, const Value &tensor) -> bool override;
   auto put_tensor_impl(const Key &key, Value &&tensor) -> bool override;
+  auto put_tensors_impl(std::span<const Key> keys, std::span<const float> rows,
+                        std::size_t dim) -> bool override;
+  auto reserve_impl(std::size_t num_rows, std::size_t dim) -> void override;
 
   [[nodiscard]] auto build_impl(
       std::optional<GraphTopology> graph = std::nullopt)
       -> std::unique_ptr<FeatureStore> override;
 
  private:
-  std::vector<float> blob_;
-  std::unordered_map<Key, std::size_t, KeyHash> offsets_;
+  // Fixes the row width at the first insert and sizes `blob_` for
+  // `cfg_.expected_rows`
+  auto init_tensor_size(std::size_t dim) -> void;
+
+  // Permutes `blob_` in place and the slots in `index_` into
+  // `cfg_.row_order`, dropping the stale rows of re-inserted keys
+  auto reorder_rows(const GraphTopology &graph) -> void;
+
+  // Appends rows of `tensor_size_` floats to `blob_` in `cfg_.dtype`
+  auto append_rows(std::span<const float> rows) -> void;
+
+  const InMemoryConfig cfg_;
+  detail::PageBuffer blob_;
+  detail::KeyIndexBuilder index_;
   std::optional<std::size_t> tensor_size_;
 };
 
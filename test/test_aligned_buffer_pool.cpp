@@ -0,0 +1,45 @@
+#include "common/aligned_buffer_pool.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <thread>
+#include <vector>
+
+// Third-party
+#include <gtest/gtest.h>
+
+TEST(AlignedBufferPool, BlocksAreAlignedAndDisjoint) {
+  ggb::detail::AlignedBufferPool pool(100, 4, 4096);
+  EXPECT_EQ(pool.block_bytes(), 4096);
+
+  std::vector<std::byte*> blocks;
+  ASSERT_EQ(pool.acquire(8, blocks), 4);
+  for (const auto* block : blocks) {
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(block) % 4096, 0);
+  }
+  for (std::size_t i = 1; i < blocks.size(); ++i) {
+    const auto gap = blocks[i] > blocks[i - 1] ? blocks[i] - blocks[i - 1]
+                                               : blocks[i - 1] - blocks[i];
+    EXPECT_GE(static_cast<std::size_t>(gap), pool.block_bytes());
+  }
+  pool.release(blocks);
+}
+
+TEST(AlignedBufferPool, AcquireWaitsForRelease) {
+  ggb::detail::AlignedBufferPool pool(512, 2, 512);
+  std::vector<std::byte*> held;
+  ASSERT_EQ(pool.acquire(2, held), 2);
+
+  std::thread waiter([&] {
+    std::vector<std::byte*> blocks;
+    EXPECT_EQ(pool.acquire(2, blocks), 1);
+    pool.release(blocks);
+  });
+  pool.release(std::span(held).first(1));
+  waiter.join();
+  pool.release(std::span(held).last(1));
+
+  std::vector<std::byte*> all;
+  EXPECT_EQ(pool.acquire(4, all), 2);
+}
@@ -0,0 +1,72 @@
+#include "common/buffered_writer.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "ggb/core.h"
+
+// Third-party
+#include <gtest/gtest.h>
+
+namespace {
+
+auto read_file(const std::string& path) -> std::vector<char> {
+  std::ifstream in(path, std::ios::binary);
+  return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+}
+
+}  // namespace
+
+TEST(BufferedWriter, WritesSpanningManyBuffers) {
+  const std::string path = "test_writer.bin";
+  std::vector<char> expected(3 * 4096 * 5 + 123);
+  std::iota(expected.begin(), expected.end(), char{0});
+  {
+    ggb::detail::BufferedWriter writer(
+        path, {.buffer_bytes = 4096, .preallocate_bytes = 1 << 20});
+    // Odd sized pieces, some larger than a buffer
+    std::size_t pos = 0;
+    for (const std::size_t piece : {1, 4095, 4097, 10000}) {
+      writer.write(expected.data() + pos, piece);
+      pos += piece;
+    }
+    writer.write(expected.data() + pos, expected.size() - pos);
+    EXPECT_EQ(writer.size(), expected.size());
+
+    const std::uint32_t patch = 0xDEADBEEF;
+    writer.write_at(8, &patch, sizeof(patch));
+    std::memcpy(expected.data() + 8, &patch, sizeof(patch));
+    writer.close();
+    EXPECT_TRUE(writer.ok());
+  }
+  EXPECT_EQ(std::filesystem::file_size(path), expected.size());
+  EXPECT_EQ(read_file(path), expected);
+  std::filesystem::remove(path);
+}
+
+TEST(BufferedWriter, FlushMakesDataVisible) {
+  const std::string path = "test_writer.bin";
+  ggb::detail::BufferedWriter writer(path, {.sync = false});
+  const std::string text = "partial";
+  writer.write(text.data(), text.size());
+  writer.flush();
+  EXPECT_EQ(read_file(path), std::vector<char>(text.begin(), text.end()));
+  writer.close();
+  std::filesystem::remove(path);
+}
+
+TEST(BufferedWriter, OpenFailureIsReportedOnClose) {
+  ggb::detail::BufferedWriter writer("/nonexistent-dir/test_writer.bin", {});
+  EXPECT_FALSE(writer.ok());
+  const char byte = 'x';
+  writer.write(&byte, 1);
+  EXPECT_THROW(writer.close(), std::runtime_error);
+}
@@ -0,0 +1,82 @@
+#include "common/dtype.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Third-party
+#include <gtest/gtest.h>
+
+TEST(Dtype, HalfToFloatNormals) {
+  EXPECT_EQ(ggb::detail::half_to_float(0x3C00), 1.0F);
+  EXPECT_EQ(ggb::detail::half_to_float(0xC000), -2.0F);
+  EXPECT_EQ(ggb::detail::half_to_float(0x3555), 0.333251953125F);
+  EXPECT_EQ(ggb::detail::half_to_float(0x7BFF), 65504.0F);
+}
+
+TEST(Dtype, HalfToFloatSpecials) {
+  EXPECT_EQ(ggb::detail::half_to_float(0x0000), 0.0F);
+  EXPECT_TRUE(std::signbit(ggb::detail::half_to_float(0x8000)));
+  EXPECT_EQ(ggb::detail::half_to_float(0x0001), std::ldexp(1.0F, -24));
+  EXPECT_EQ(ggb::detail::half_to_float(0x03FF), std::ldexp(1023.0F, -24));
+  EXPECT_EQ(ggb::detail::half_to_float(0x7C00),
+            std::numeric_limits<float>::infinity());
+  EXPECT_TRUE(std::isnan(ggb::detail::half_to_float(0x7E00)));
+}
+
+TEST(Dtype, FloatToHalfRoundsToNearestEven) {
+  for (std::uint32_t h = 0; h < 0x7C00; ++h) {
+    const auto half = static_cast<std::uint16_t>(h);
+    ASSERT_EQ(ggb::detail::float_to_half(ggb::detail::half_to_float(half)),
+              half);
+  }
+  // 1 + 2^-11 is halfway between 1 and the next half, ties to even
+  EXPECT_EQ(ggb::detail::float_to_half(1.0F + std::ldexp(1.0F, -11)), 0x3C00);
+  EXPECT_EQ(ggb::detail::float_to_half(1.0F + std::ldexp(3.0F, -11)), 0x3C02);
+  EXPECT_EQ(ggb::detail::float_to_half(65520.0F), 0x7C00);
+  EXPECT_EQ(ggb::detail::float_to_half(std::ldexp(1.0F, -25)), 0x0000);
+  EXPECT_EQ(ggb::detail::float_to_half(std::ldexp(1.5F, -25)), 0x0001);
+  EXPECT_EQ(ggb::detail::float_to_half(-std::numeric_limits<float>::infinity()),
+            0xFC00);
+  EXPECT_TRUE(std::isnan(ggb::detail::half_to_float(
+      ggb::detail::float_to_half(std::numeric_limits<float>::quiet_NaN()))));
+}
+
+TEST(Dtype, BFloat16) {
+  EXPECT_EQ(ggb::detail::float_to_bfloat16(1.0F), 0x3F80);
+  EXPECT_EQ(ggb::detail::bfloat16_to_float(0xC040), -3.0F);
+  // 1 + 2^-8 is halfway between 1 and 1 + 2^-7, ties to even
+  EXPECT_EQ(ggb::detail::float_to_bfloat16(1.0F + std::ldexp(1.0F, -8)),
+            0x3F80);
+  EXPECT_EQ(ggb::detail::float_to_bfloat16(1.0F + std::ldexp(3.0F, -8)),
+            0x3F82);
+  const auto nan = std::numeric_limits<float>::quiet_NaN();
+  EXPECT_TRUE(std::isnan(
+      ggb::detail::bfloat16_to_float(ggb::detail::float_to_bfloat16(nan))));
+}
+
+TEST(Dtype, Int8RowRoundTrip) {
+  const std::vector<float> row = {0.5F, -1.27F, 0.0F, 1.0F, 0.01F};
+  const auto dtype = ggb::StorageDType::Int8;
+  ASSERT_EQ(ggb::storage_row_bytes(dtype, row.size()), 12);
+
+  std::vector<std::byte> encoded(12, std::byte{0xFF});
+  ggb::detail::encode_row(dtype, row, encoded.data());
+  EXPECT_EQ(encoded.back(), std::byte{0});  // Padding is zeroed
+
+  std::vector<float> decoded(row.size());
+  ggb::detail::decode_row(dtype, encoded.data(), row.size(), decoded.data());
+  EXPECT_FLOAT_EQ(decoded[1], -1.27F);  // The largest magnitude is exact
+  for (std::size_t i = 0; i < row.size(); ++i) {
+    EXPECT_NEAR(decoded[i], row[i], 0.005F);
+  }
+
+  // An all-zero row has a zero scale and decodes to zeros
+  const std::vector<float> zeros(3, 0.0F);
+  ggb::detail::encode_row(dtype, zeros, encoded.data());
+  ggb::detail::decode_row(dtype, encoded.data(), 3, decoded.data());
+  EXPECT_EQ(decoded[0], 0.0F);
+  EXPECT_EQ(decoded[2], 0.0F);
+}
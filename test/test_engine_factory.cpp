@@ -1,3 +1,5 @@
+#include "engines/cached/cached.h"
+#include "engines/direct_io/direct_io.h"
 #include "engines/flat_mmap/flat_mmap.h"
 #include "engines/in_memory/in_memory.h"
 #include "ggb/core.h"
@@ -23,3 +25,21 @@ TEST(EngineFactory, CreateFlatMmapBuilder) {
   EXPECT_NE(ptr, nullptr) << "Factory failed to return "
                              "FlatMmapFeatureStoreBuilder for FlatMmapConfig";
 }
+
+TEST(EngineFactory, CreateDirectIoBuilder) {
+  const auto cfg = ggb::DirectIoConfig{.db_path = {"/tmp/foo.ggb"}};
+  auto builder = create_builder(cfg);
+  auto* ptr =
+      dynamic_cast<ggb::engine::DirectIoFeatureStoreBuilder*>(builder.get());
+  EXPECT_NE(ptr, nullptr) << "Factory failed to return "
+                             "DirectIoFeatureStoreBuilder for DirectIoConfig";
+}
+
+TEST(EngineFactory, CreateCachedBuilder) {
+  const auto cfg = ggb::CachedConfig{.base = ggb::InMemoryConfig{}};
+  auto builder = create_builder(cfg);
+  auto* ptr =
+      dynamic_cast<ggb::engine::CachedFeatureStoreBuilder*>(builder.get());
+  EXPECT_NE(ptr, nullptr) << "Factory failed to return "
+                             "CachedFeatureStoreBuilder for CachedConfig";
+}
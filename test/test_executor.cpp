@@ -0,0 +1,130 @@
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <future>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "common/executor.h"
+#include "ggb/core.h"
+
+// Third-party
+#include <gtest/gtest.h>
+
+using ggb::ExecutorConfig;
+using ggb::detail::Executor;
+
+TEST(Executor, InlineExecutorReturnsReadyFuture) {
+  Executor executor(ExecutorConfig{});
+  EXPECT_EQ(executor.num_threads(), 0);
+
+  const auto caller = std::this_thread::get_id();
+  auto future = executor.submit([] { return std::this_thread::get_id(); });
+
+  ASSERT_EQ(future.wait_for(std::chrono::seconds(0)),
+            std::future_status::ready);
+  EXPECT_EQ(future.get(), caller);
+}
+
+TEST(Executor, WorkersRunTasksInBackground) {
+  Executor executor(ExecutorConfig{.num_threads = 2});
+  EXPECT_EQ(executor.num_threads(), 2);
+
+  const auto caller = std::this_thread::get_id();
+  auto future = executor.submit([] { return std::this_thread::get_id(); });
+  EXPECT_NE(future.get(), caller);
+}
+
+TEST(Executor, RunsAllTasks) {
+  for (const auto stealing : {false, true}) {
+    Executor executor(
+        ExecutorConfig{.num_threads = 4, .work_stealing = stealing});
+
+    std::vector<std::future<std::size_t>> futures;
+    for (std::size_t i = 0; i < 1000; ++i) {
+      futures.push_back(executor.submit([i] { return i * i; }));
+    }
+    for (std::size_t i = 0; i < futures.size(); ++i) {
+      EXPECT_EQ(futures[i].get(), i * i);
+    }
+  }
+}
+
+TEST(Executor, NestedSubmissionsWithWorkStealing) {
+  Executor executor(ExecutorConfig{.num_threads = 2, .work_stealing = true});
+
+  auto outer = executor.submit([&executor] {
+    std::vector<std::future<int>> inner;
+    for (int i = 0; i < 8; ++i) {
+      inner.push_back(executor.submit([i] { return i; }));
+    }
+    return inner;
+  });
+
+  int sum = 0;
+  for (auto& future : outer.get()) {
+    sum += future.get();
+  }
+  EXPECT_EQ(sum, 28);
+}
+
+TEST(Executor, PropagatesExceptions) {
+  for (const std::size_t num_threads : {0, 2}) {
+    Executor executor(ExecutorConfig{.num_threads = num_threads});
+    auto future =
+        executor.submit([]() -> int { throw std::runtime_error("boom"); });
+    EXPECT_THROW(future.get(), std::runtime_error);
+  }
+}
+
+TEST(Executor, DestructorDrainsQueuedTasks) {
+  std::atomic<std::size_t> completed{0};
+  {
+    Executor executor(ExecutorConfig{.num_threads = 1});
+    for (std::size_t i = 0; i < 100; ++i) {
+      auto future = executor.submit([&completed] { ++completed; });
+    }
+  }
+  EXPECT_EQ(completed.load(), 100);
+}
+
+TEST(Executor, ParallelChunksCoverRangeInOrder) {
+  Executor executor(ExecutorConfig{.num_threads = 3});
+  const auto chunks = ggb::detail::parallel_chunks(
+      executor, 1000, 100, [](std::size_t begin, std::size_t end) {
+        return std::vector<std::size_t>{begin, end};
+      });
+  // One chunk per worker plus the caller, contiguous and in order
+  ASSERT_EQ(chunks.size(), 4);
+  std::size_t next = 0;
+  for (const auto& chunk : chunks) {
+    EXPECT_EQ(chunk.front(), next);
+    next = chunk.back();
+  }
+  EXPECT_EQ(next, 1000);
+}
+
+TEST(Executor, ParallelChunksStaySerialBelowGrain) {
+  Executor executor(ExecutorConfig{.num_threads = 3});
+  const auto caller = std::this_thread::get_id();
+  const auto chunks = ggb::detail::parallel_chunks(
+      executor, 100, 100, [&](std::size_t begin, std::size_t end) {
+        EXPECT_EQ(std::this_thread::get_id(), caller);
+        return end - begin;
+      });
+  EXPECT_EQ(chunks, std::vector<std::size_t>{100});
+}
+
+TEST(Executor, ParallelChunksPropagateExceptions) {
+  Executor executor(ExecutorConfig{.num_threads = 2});
+  EXPECT_THROW(ggb::detail::parallel_chunks(
+                   executor, 30, 10,
+                   [](std::size_t begin, std::size_t) -> int {
+                     if (begin > 0) {
+                       throw std::runtime_error("boom");
+                     }
+                     return 0;
+                   }),
+               std::runtime_error);
+}
@@ -1,6 +1,19 @@
+#include <sys/stat.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <filesystem>
+#include <fstream>
+#include <span>
+#include <string>
+#include <thread>
+#include <utility>
 #include <vector>
 
+#include "common/dtype.h"
+#include "engines/cached/cached.h"
+#include "engines/direct_io/direct_io.h"
 #include "engines/flat_mmap/flat_mmap.h"
 #include "engines/in_memory/in_memory.h"
 #include "ggb/core.h"
@@ -67,6 +80,236 @@ void test_store(const TConfig& cfg) {
   const std::vector<ggb::Key> sync_keys = {{0}};
   const auto sync_results = store->get_multi_tensor(keys);
   ASSERT_EQ(sync_results, results);
+
+  // Data Retrieval (Into caller-provided buffer)
+  std::vector<float> out(keys.size() * 2, -1.0);
+  const auto missing = store->get_multi_tensor_into(keys, out);
+  ASSERT_EQ(missing, std::vector<std::size_t>{2});
+  EXPECT_EQ(out, (std::vector<float>{1.0, 2.0, 3.0, 4.0, 0.0, 0.0}));
+
+  // Undersized output buffer should throw
+  std::vector<float> small_out(keys.size());
+  EXPECT_THROW(
+      {
+        [[maybe_unused]] auto m =
+            store->get_multi_tensor_into(keys, small_out);
+      },
+      std::runtime_error);
+
+  // Data Retrieval (Async into caller-provided buffer)
+  std::vector<float> async_out(keys.size() * 2, -1.0);
+  auto into_future = store->get_multi_tensor_into_async(keys, async_out);
+  EXPECT_EQ(into_future.get(), std::vector<std::size_t>{2});
+  EXPECT_EQ(async_out, out);
+}
+
+template <typename TBuilder, typename TConfig>
+void test_sparse_store(const TConfig& cfg) {
+  TBuilder builder(cfg);
+  builder.put_tensor({10}, {1.0, 2.0});
+  builder.put_tensor({3}, {3.0, 4.0});
+  builder.put_tensor({7}, {5.0, 6.0});
+  const auto store = builder.build();
+
+  EXPECT_EQ(store->get_num_keys(), 3);
+
+  const std::vector<ggb::Key> keys = {{7}, {0}, {10}, {3}};
+  std::vector<float> out(keys.size() * 2);
+  const auto missing = store->get_multi_tensor_into(keys, out);
+  ASSERT_EQ(missing, std::vector<std::size_t>{1});
+  EXPECT_EQ(out,
+            (std::vector<float>{5.0, 6.0, 0.0, 0.0, 1.0, 2.0, 3.0, 4.0}));
+}
+
+template <typename TBuilder, typename TConfig>
+void test_bulk_store(const TConfig& cfg) {
+  TBuilder builder(cfg);
+  const std::vector<ggb::Key> keys = {{10}, {3}};
+  const std::vector<float> rows = {1.0, 2.0, 3.0, 4.0};
+  EXPECT_TRUE(builder.put_tensors(keys, rows, 2));
+
+  // Nodes 4 and 5 as a dense matrix, mixed with a single row
+  EXPECT_TRUE(builder.put_tensor({7}, {5.0, 6.0}));
+  const std::vector<float> matrix = {7.0, 8.0, 9.0, 10.0};
+  EXPECT_TRUE(builder.put_matrix(4, matrix, 2));
+
+  // Wrong width and a partial trailing row are rejected
+  EXPECT_FALSE(builder.put_tensors(keys, rows, 4));
+  EXPECT_FALSE(builder.put_tensors(std::span(keys).first(1), rows, 2));
+  EXPECT_FALSE(builder.put_matrix(8, std::span(matrix).first(3), 2));
+  const auto store = builder.build();
+
+  EXPECT_EQ(store->get_num_keys(), 5);
+  const std::vector<ggb::Key> lookup = {{5}, {3}, {7}, {4}, {10}, {8}};
+  std::vector<float> out(lookup.size() * 2);
+  const auto missing = store->get_multi_tensor_into(lookup, out);
+  ASSERT_EQ(missing, std::vector<std::size_t>{5});
+  EXPECT_EQ(out, (std::vector<float>{9.0, 10.0, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0,
+                                     1.0, 2.0, 0.0, 0.0}));
+}
+
+// Large enough to be split across the gather pool, with missing keys in
+// every chunk; results and missing positions must keep batch order
+template <typename TBuilder, typename TConfig>
+void test_parallel_gather_store(TConfig cfg) {
+  cfg.gather.num_threads = 3;
+  cfg.gather.grain_size = 64;
+  TBuilder builder(cfg);
+  for (std::uint64_t id = 0; id < 1000; id += 2) {
+    builder.put_tensor({id}, {static_cast<float>(id), 1.0F});
+  }
+  const auto store = builder.build();
+
+  std::vector<ggb::Key> keys;
+  for (std::uint64_t id = 1000; id-- > 0;) {
+    keys.push_back({id});
+  }
+  std::vector<float> out(keys.size() * 2, -1.0F);
+  const auto missing = store->get_multi_tensor_into(keys, out);
+  const auto values = store->get_multi_tensor(keys);
+
+  std::vector<std::size_t> expected_missing;
+  for (std::size_t i = 0; i < keys.size(); ++i) {
+    const auto id = static_cast<float>(keys[i].NodeID);
+    if (keys[i].NodeID % 2 == 1) {
+      expected_missing.push_back(i);
+      EXPECT_EQ(out[i * 2], 0.0F);
+      EXPECT_FALSE(values[i].has_value());
+    } else {
+      EXPECT_EQ(out[i * 2], id);
+      ASSERT_TRUE(values[i].has_value());
+      EXPECT_EQ(*values[i], (ggb::Value{id, 1.0F}));
+    }
+  }
+  EXPECT_EQ(missing, expected_missing);
+}
+
+// Prefetching is only a hint: lookups after it return exactly what they
+// would have without it
+template <typename TBuilder, typename TConfig>
+void test_prefetch_store(const TConfig& cfg) {
+  TBuilder builder(cfg);
+  for (std::uint64_t id = 0; id < 2000; ++id) {
+    builder.put_tensor({id}, {static_cast<float>(id), -1.0F});
+  }
+  const auto store = builder.build();
+
+  const std::vector<ggb::Key> keys = {{1999}, {7}, {5000}, {1024}, {7}};
+  store->prefetch(keys);
+  store->prefetch({});
+  std::vector<float> out(keys.size() * 2);
+  EXPECT_EQ(store->get_multi_tensor_into(keys, out),
+            (std::vector<std::size_t>{2}));
+  EXPECT_EQ(out, (std::vector<float>{1999.0, -1.0, 7.0, -1.0, 0.0, 0.0,
+                                     1024.0, -1.0, 7.0, -1.0}));
+}
+
+// Reordering must only change where rows live, never what a key maps to
+template <typename TBuilder, typename TConfig>
+void test_reordered_store(TConfig cfg) {
+  // A hub (5) with leaves, a path 1-2-3, a re-inserted key and an isolated
+  // node that does not appear in any edge
+  const std::vector<std::pair<ggb::NodeID, ggb::NodeID>> edges = {
+      {5, 0}, {5, 4}, {5, 6}, {1, 2}, {2, 3}, {3, 42}};
+  for (const auto order : {ggb::RowOrder::Degree, ggb::RowOrder::Rcm}) {
+    cfg.row_order = order;
+    TBuilder builder(cfg);
+    for (const std::uint64_t id : {0, 1, 2, 3, 4, 5, 6, 9}) {
+      builder.put_tensor({id}, {static_cast<float>(id), -1.0F});
+    }
+    builder.put_tensor({2}, {2.0, 2.0});
+    const auto store =
+        builder.build(ggb::GraphTopology{.edges = std::span(edges)});
+
+    EXPECT_EQ(store->get_num_keys(), 8);
+    const std::vector<ggb::Key> keys = {{9}, {5}, {2}, {7}, {0}, {6}};
+    std::vector<float> out(keys.size() * 2);
+    const auto missing = store->get_multi_tensor_into(keys, out);
+    ASSERT_EQ(missing, std::vector<std::size_t>{3});
+    EXPECT_EQ(out, (std::vector<float>{9.0, -1.0, 5.0, -1.0, 2.0, 2.0, 0.0,
+                                       0.0, 0.0, -1.0, 6.0, -1.0}));
+  }
+}
+
+// Rows come back within the rounding error of each dtype, and the stored
+// encoding decodes to the same values
+template <typename TBuilder, typename TConfig>
+void test_reduced_precision_store(TConfig cfg) {
+  const std::vector<float> rows = {1.0, -2.0, 0.5, 0.1, 3.0, -0.25};
+  for (const auto dtype :
+       {ggb::StorageDType::F16, ggb::StorageDType::BF16,
+        ggb::StorageDType::Int8}) {
+    cfg.dtype = dtype;
+    TBuilder builder(cfg);
+    EXPECT_TRUE(builder.put_tensors(std::vector<ggb::Key>{{4}, {2}}, rows, 3));
+    const auto store = builder.build();
+    EXPECT_EQ(store->get_storage_dtype(), dtype);
+    EXPECT_EQ(store->get_storage_row_bytes(), ggb::storage_row_bytes(dtype, 3));
+
+    const std::vector<ggb::Key> keys = {{2}, {9}, {4}};
+    std::vector<float> out(keys.size() * 3, -1.0);
+    ASSERT_EQ(store->get_multi_tensor_into(keys, out),
+              std::vector<std::size_t>{1});
+    const std::vector<float> expected = {0.1, 3.0, -0.25, 0.0, 0.0,
+                                         0.0, 1.0, -2.0,  0.5};
+    for (std::size_t i = 0; i < out.size(); ++i) {
+      // Int8 rounds to half a step of max|x| / 127
+      EXPECT_NEAR(out[i], expected[i], 3.0 / 254) << "element " << i;
+    }
+    const auto results = store->get_multi_tensor(keys);
+    ASSERT_TRUE(results[2].has_value());
+    EXPECT_EQ(results[2].value(), std::vector<float>(out.begin() + 6,
+                                                     out.end()));
+
+    std::vector<std::byte> native(keys.size() * store->get_storage_row_bytes(),
+                                  std::byte{0xFF});
+    ASSERT_EQ(store->get_multi_tensor_native_into(keys, native),
+              std::vector<std::size_t>{1});
+    std::vector<float> decoded(3);
+    ggb::detail::decode_row(dtype, native.data(), 3, decoded.data());
+    EXPECT_EQ(decoded, std::vector<float>(out.begin(), out.begin() + 3));
+    EXPECT_EQ(native[store->get_storage_row_bytes()], std::byte{0});
+    EXPECT_THROW(
+        {
+          [[maybe_unused]] auto m = store->get_multi_tensor_native_into(
+              keys, std::span(native).first(native.size() - 1));
+        },
+        std::runtime_error);
+  }
+}
+
+// A batch with one absent key, through `get_multi_tensor_into`
+template <typename TBuilder, typename TConfig>
+void test_store_metrics(
+    const TConfig& cfg,
+    [[maybe_unused]] const std::vector<std::string>& stages) {
+  TBuilder builder(cfg);
+  builder.put_tensor({0}, {1.0, 2.0});
+  builder.put_tensor({1}, {3.0, 4.0});
+  const auto store = builder.build();
+
+  const std::vector<ggb::Key> keys = {{1}, {7}, {0}};
+  std::vector<float> out(keys.size() * 2);
+  EXPECT_EQ(store->get_multi_tensor_into(keys, out),
+            std::vector<std::size_t>{1});
+
+  const auto metrics = store->get_metrics();
+#ifdef GGB_ENABLE_METRICS
+  EXPECT_EQ(metrics.counters.at("lookup.keys"), 3);
+  EXPECT_EQ(metrics.counters.at("lookup.missing_keys"), 1);
+  EXPECT_EQ(metrics.counters.at("lookup.bytes_copied"), 2 * 2 * sizeof(float));
+  EXPECT_EQ(metrics.stages.size(), stages.size());
+  for (const auto& stage : stages) {
+    ASSERT_TRUE(metrics.stages.contains(stage)) << stage;
+    EXPECT_EQ(metrics.stages.at(stage).count, 1) << stage;
+  }
+#else
+  EXPECT_TRUE(metrics.stages.empty());
+#endif
+  // Engine counters are reported either way
+  for (const auto& [name, value] : store->get_counters()) {
+    EXPECT_EQ(metrics.counters.at(name), value) << name;
+  }
 }
 
 }  // namespace
@@ -83,6 +326,82 @@ TEST(InMemoryFeatureStore, RetrievalTest) {
   test_store<ggb::engine::InMemoryFeatureStoreBuilder>(cfg);
 }
 
+TEST(InMemoryFeatureStore, SparseKeysTest) {
+  const ggb::InMemoryConfig cfg{};
+  test_sparse_store<ggb::engine::InMemoryFeatureStoreBuilder>(cfg);
+}
+
+TEST(InMemoryFeatureStore, ReorderedRowsTest) {
+  test_reordered_store<ggb::engine::InMemoryFeatureStoreBuilder>(
+      ggb::InMemoryConfig{});
+}
+
+TEST(InMemoryFeatureStore, RetrievalWithExecutorTest) {
+  const ggb::InMemoryConfig cfg{
+      .executor = {.num_threads = 2, .work_stealing = true}};
+  test_store<ggb::engine::InMemoryFeatureStoreBuilder>(cfg);
+}
+
+TEST(InMemoryFeatureStore, StreamingGatherTest) {
+  const ggb::InMemoryConfig cfg{
+      .gather = {.prefetch_distance = 1, .streaming_min_bytes = 1}};
+  test_store<ggb::engine::InMemoryFeatureStoreBuilder>(cfg);
+}
+
+TEST(InMemoryFeatureStore, ParallelGatherTest) {
+  test_parallel_gather_store<ggb::engine::InMemoryFeatureStoreBuilder>(
+      ggb::InMemoryConfig{});
+}
+
+TEST(InMemoryFeatureStore, PrefetchTest) {
+  test_prefetch_store<ggb::engine::InMemoryFeatureStoreBuilder>(
+      ggb::InMemoryConfig{});
+}
+
+TEST(InMemoryFeatureStore, HugePagesTest) {
+  for (const auto huge_pages :
+       {ggb::HugePages::Transparent, ggb::HugePages::Explicit}) {
+    const ggb::InMemoryConfig cfg{.huge_pages = huge_pages};
+    test_store<ggb::engine::InMemoryFeatureStoreBuilder>(cfg);
+    test_parallel_gather_store<ggb::engine::InMemoryFeatureStoreBuilder>(cfg);
+    test_reordered_store<ggb::engine::InMemoryFeatureStoreBuilder>(cfg);
+  }
+}
+
+TEST(InMemoryFeatureStore, ReservedRowsTest) {
+  // Fewer rows than expected, then more than reserved
+  test_store<ggb::engine::InMemoryFeatureStoreBuilder>(
+      ggb::InMemoryConfig{.expected_rows = 1'000'000});
+
+  ggb::engine::InMemoryFeatureStoreBuilder builder(
+      ggb::InMemoryConfig{.expected_rows = 1});
+  builder.reserve(2, 2);
+  for (std::uint64_t id = 0; id < 5000; ++id) {
+    builder.put_tensor({id}, {static_cast<float>(id), 1.0F});
+  }
+  const auto store = builder.build();
+  const std::vector<ggb::Key> keys = {{4999}, {0}, {5000}};
+  std::vector<float> out(keys.size() * 2);
+  EXPECT_EQ(store->get_multi_tensor_into(keys, out),
+            std::vector<std::size_t>{2});
+  EXPECT_EQ(out, (std::vector<float>{4999.0, 1.0, 0.0, 1.0, 0.0, 0.0}));
+}
+
+TEST(InMemoryFeatureStore, MetricsTest) {
+  test_store_metrics<ggb::engine::InMemoryFeatureStoreBuilder>(
+      ggb::InMemoryConfig{}, {"lookup.index", "lookup.copy"});
+}
+
+TEST(InMemoryFeatureStore, BulkInsertTest) {
+  test_bulk_store<ggb::engine::InMemoryFeatureStoreBuilder>(
+      ggb::InMemoryConfig{});
+}
+
+TEST(InMemoryFeatureStore, ReducedPrecisionTest) {
+  test_reduced_precision_store<ggb::engine::InMemoryFeatureStoreBuilder>(
+      ggb::InMemoryConfig{});
+}
+
 // --- FlatMmap Tests ---
 
 TEST(FlatMmapFeatureStore, BuilderTest) {
@@ -96,3 +415,479 @@ TEST(FlatMmapFeatureStore, RetrievalTest) {
   test_store<ggb::engine::FlatMmapFeatureStoreBuilder>(cfg);
   std::filesystem::remove(cfg.db_path);
 }
+
+TEST(FlatMmapFeatureStore, SparseKeysTest) {
+  const ggb::FlatMmapConfig cfg{.db_path = "test.ggb"};
+  test_sparse_store<ggb::engine::FlatMmapFeatureStoreBuilder>(cfg);
+  std::filesystem::remove(cfg.db_path);
+}
+
+TEST(FlatMmapFeatureStore, MetricsTest) {
+  for (const bool coalesce : {false, true}) {
+    const ggb::FlatMmapConfig cfg{.db_path = "test.ggb",
+                                  .coalesce = {.enabled = coalesce}};
+    test_store_metrics<ggb::engine::FlatMmapFeatureStoreBuilder>(
+        cfg, {"lookup.index", "lookup.copy"});
+  }
+  std::filesystem::remove("test.ggb");
+}
+
+TEST(FlatMmapFeatureStore, BulkInsertTest) {
+  const ggb::FlatMmapConfig cfg{.db_path = "test.ggb"};
+  test_bulk_store<ggb::engine::FlatMmapFeatureStoreBuilder>(cfg);
+  std::filesystem::remove(cfg.db_path);
+}
+
+TEST(FlatMmapFeatureStore, ReservedRowsTest) {
+  const ggb::FlatMmapConfig cfg{.db_path = "test.ggb"};
+  ggb::engine::FlatMmapFeatureStoreBuilder builder(cfg);
+  struct stat before{};
+  ASSERT_EQ(stat(cfg.db_path.c_str(), &before), 0);
+  builder.reserve(100'000, 2);
+  // Preallocation is best effort and never grows the file itself
+  struct stat st{};
+  ASSERT_EQ(stat(cfg.db_path.c_str(), &st), 0);
+  EXPECT_EQ(st.st_size, before.st_size);
+
+  for (std::uint64_t id = 0; id < 10; ++id) {
+    builder.put_tensor({id}, {static_cast<float>(id), 1.0F});
+  }
+  const auto store = builder.build();
+  // Blocks reserved for rows that never came are given back
+  ASSERT_EQ(stat(cfg.db_path.c_str(), &st), 0);
+  EXPECT_LT(static_cast<std::size_t>(st.st_blocks) * 512,
+            100'000 * 2 * sizeof(float));
+  const std::vector<ggb::Key> keys = {{9}, {10}};
+  std::vector<float> out(keys.size() * 2);
+  EXPECT_EQ(store->get_multi_tensor_into(keys, out),
+            std::vector<std::size_t>{1});
+  EXPECT_EQ(out, (std::vector<float>{9.0, 1.0, 0.0, 0.0}));
+  std::filesystem::remove(cfg.db_path);
+}
+
+TEST(FlatMmapFeatureStore, ReducedPrecisionTest) {
+  const ggb::FlatMmapConfig cfg{.db_path = "test.ggb"};
+  test_reduced_precision_store<ggb::engine::FlatMmapFeatureStoreBuilder>(cfg);
+
+  // The dtype is read back from the file, whatever the config says
+  const auto store = ggb::FeatureStore::open(cfg);
+  EXPECT_EQ(store->get_storage_dtype(), ggb::StorageDType::Int8);
+  const std::vector<ggb::Key> keys = {{4}};
+  std::vector<float> out(3);
+  EXPECT_TRUE(store->get_multi_tensor_into(keys, out).empty());
+  EXPECT_FLOAT_EQ(out[1], -2.0);
+  std::filesystem::remove(cfg.db_path);
+}
+
+TEST(FlatMmapFeatureStore, ReorderedRowsTest) {
+  const ggb::FlatMmapConfig cfg{.db_path = "test.ggb"};
+  test_reordered_store<ggb::engine::FlatMmapFeatureStoreBuilder>(cfg);
+
+  // The reordered layout and remapped index survive a reopen
+  const auto store = ggb::FeatureStore::open(cfg.db_path);
+  const std::vector<ggb::Key> keys = {{2}, {9}};
+  std::vector<float> out(keys.size() * 2);
+  EXPECT_TRUE(store->get_multi_tensor_into(keys, out).empty());
+  EXPECT_EQ(out, (std::vector<float>{2.0, 2.0, 9.0, -1.0}));
+  EXPECT_FALSE(std::filesystem::exists(cfg.db_path + ".reorder"));
+  std::filesystem::remove(cfg.db_path);
+}
+
+TEST(FlatMmapFeatureStore, HotCacheTest) {
+  const ggb::FlatMmapConfig cfg{.db_path = "test.ggb",
+                                .hot_cache = {.max_nodes = 2}};
+  // Key 5 is the hub, then key 1; key 9 has no edges
+  const std::vector<std::pair<ggb::NodeID, ggb::NodeID>> edges = {
+      {5, 0}, {5, 1}, {5, 2}, {1, 2}, {1, 3}};
+  {
+    ggb::engine::FlatMmapFeatureStoreBuilder builder(cfg);
+    for (const std::uint64_t id : {0, 1, 2, 3, 5, 9}) {
+      builder.put_tensor({id}, {static_cast<float>(id), 1.0F});
+    }
+    const auto store =
+        builder.build(ggb::GraphTopology{.edges = std::span(edges)});
+    EXPECT_EQ(store->get_counters().at("hot_cache.hits"), 0);
+
+    const std::vector<ggb::Key> keys = {{5}, {0}, {1}, {4}, {9}};
+    std::vector<float> out(keys.size() * 2);
+    ASSERT_EQ(store->get_multi_tensor_into(keys, out),
+              std::vector<std::size_t>{3});
+    EXPECT_EQ(out, (std::vector<float>{5.0, 1.0, 0.0, 1.0, 1.0, 1.0, 0.0, 0.0,
+                                       9.0, 1.0}));
+    const auto results = store->get_multi_tensor(keys);
+    ASSERT_TRUE(results[0].has_value());
+    EXPECT_EQ(results[0].value(), (std::vector<float>{5.0, 1.0}));
+
+    const auto counters = store->get_counters();
+    EXPECT_EQ(counters.at("hot_cache.hits"), 4);
+    EXPECT_EQ(counters.at("hot_cache.misses"), 4);
+  }
+
+  // The pinned rows are recorded in the file and reloaded on open
+  const auto store = ggb::FeatureStore::open(cfg.db_path);
+  const std::vector<ggb::Key> keys = {{1}, {2}};
+  std::vector<float> out(keys.size() * 2);
+  EXPECT_TRUE(store->get_multi_tensor_into(keys, out).empty());
+  EXPECT_EQ(out, (std::vector<float>{1.0, 1.0, 2.0, 1.0}));
+  EXPECT_EQ(store->get_counters().at("hot_cache.hits"), 1);
+  EXPECT_EQ(store->get_counters().at("hot_cache.misses"), 1);
+  std::filesystem::remove(cfg.db_path);
+}
+
+TEST(FlatMmapFeatureStore, RetrievalWithExecutorTest) {
+  const ggb::FlatMmapConfig cfg{.db_path = "test.ggb",
+                                .executor = {.num_threads = 2}};
+  test_store<ggb::engine::FlatMmapFeatureStoreBuilder>(cfg);
+  std::filesystem::remove(cfg.db_path);
+}
+
+TEST(FlatMmapFeatureStore, StreamingGatherTest) {
+  const ggb::FlatMmapConfig cfg{
+      .db_path = "test.ggb",
+      .gather = {.prefetch_distance = 1, .streaming_min_bytes = 1}};
+  test_store<ggb::engine::FlatMmapFeatureStoreBuilder>(cfg);
+  std::filesystem::remove(cfg.db_path);
+}
+
+TEST(FlatMmapFeatureStore, ParallelGatherTest) {
+  const ggb::FlatMmapConfig cfg{.db_path = "test.ggb",
+                                .executor = {.num_threads = 2}};
+  test_parallel_gather_store<ggb::engine::FlatMmapFeatureStoreBuilder>(cfg);
+  std::filesystem::remove(cfg.db_path);
+}
+
+TEST(FlatMmapFeatureStore, HugePagesTest) {
+  for (const auto huge_pages :
+       {ggb::HugePages::Transparent, ggb::HugePages::Explicit}) {
+    const ggb::FlatMmapConfig cfg{.db_path = "test.ggb",
+                                  .huge_pages = huge_pages};
+    test_store<ggb::engine::FlatMmapFeatureStoreBuilder>(cfg);
+  }
+  std::filesystem::remove("test.ggb");
+}
+
+TEST(FlatMmapFeatureStore, CoalescedGatherTest) {
+  const ggb::FlatMmapConfig cfg{.db_path = "test.ggb",
+                                .coalesce = {.enabled = true}};
+  test_store<ggb::engine::FlatMmapFeatureStoreBuilder>(cfg);
+  test_parallel_gather_store<ggb::engine::FlatMmapFeatureStoreBuilder>(cfg);
+
+  // 500 rows of 8 bytes fit in one page past the header
+  const auto store = ggb::FeatureStore::open(cfg);
+  const std::vector<ggb::Key> keys = {{998}, {3}, {500}, {0}, {500}};
+  std::vector<float> out(keys.size() * 2);
+  EXPECT_EQ(store->get_multi_tensor_into(keys, out),
+            (std::vector<std::size_t>{1}));
+  EXPECT_EQ(out, (std::vector<float>{998.0, 1.0, 0.0, 0.0, 500.0, 1.0, 0.0,
+                                     1.0, 500.0, 1.0}));
+  const auto counters = store->get_counters();
+  EXPECT_EQ(counters.at("flat_mmap.rows"), 4);
+  EXPECT_EQ(counters.at("flat_mmap.ranges"), 1);
+  std::filesystem::remove(cfg.db_path);
+}
+
+TEST(FlatMmapFeatureStore, PrefetchTest) {
+  for (const std::size_t num_threads : {0, 2}) {
+    const ggb::FlatMmapConfig cfg{.db_path = "test.ggb",
+                                  .executor = {.num_threads = num_threads},
+                                  .hot_cache = {.max_nodes = 4}};
+    test_prefetch_store<ggb::engine::FlatMmapFeatureStoreBuilder>(cfg);
+  }
+  std::filesystem::remove("test.ggb");
+}
+
+TEST(FlatMmapFeatureStore, ReopenTest) {
+  for (const auto index : {ggb::IndexKind::Hash, ggb::IndexKind::Eytzinger,
+                           ggb::IndexKind::PerfectHash}) {
+    const ggb::FlatMmapConfig cfg{.db_path = "test.ggb", .index = index};
+    {
+      ggb::engine::FlatMmapFeatureStoreBuilder builder(cfg);
+      builder.put_tensor({10}, {1.0, 2.0});
+      builder.put_tensor({3}, {3.0, 4.0});
+      builder.put_tensor({7}, {5.0, 6.0});
+      [[maybe_unused]] const auto built = builder.build();
+    }
+
+    const auto store = ggb::FeatureStore::open(cfg.db_path);
+    EXPECT_EQ(store->get_num_keys(), 3);
+    EXPECT_EQ(store->get_tensor_size(), 2);
+
+    const std::vector<ggb::Key> keys = {{7}, {0}, {10}, {3}};
+    std::vector<float> out(keys.size() * 2);
+    const auto missing = store->get_multi_tensor_into(keys, out);
+    ASSERT_EQ(missing, std::vector<std::size_t>{1});
+    EXPECT_EQ(out,
+              (std::vector<float>{5.0, 6.0, 0.0, 0.0, 1.0, 2.0, 3.0, 4.0}));
+  }
+  std::filesystem::remove("test.ggb");
+}
+
+TEST(FlatMmapFeatureStore, ReopenDenseAndEmptyTest) {
+  const ggb::FlatMmapConfig cfg{.db_path = "test.ggb"};
+  {
+    ggb::engine::FlatMmapFeatureStoreBuilder builder(cfg);
+    [[maybe_unused]] const auto built = builder.build();
+  }
+  const auto empty = ggb::FeatureStore::open(cfg);
+  EXPECT_EQ(empty->get_num_keys(), 0);
+  EXPECT_FALSE(empty->get_tensor_size().has_value());
+
+  test_store<ggb::engine::FlatMmapFeatureStoreBuilder>(cfg);
+  const auto store = ggb::FeatureStore::open(cfg);
+  const std::vector<ggb::Key> keys = {{1}, {0}};
+  std::vector<float> out(keys.size() * 2);
+  EXPECT_TRUE(store->get_multi_tensor_into(keys, out).empty());
+  EXPECT_EQ(out, (std::vector<float>{3.0, 4.0, 1.0, 2.0}));
+  std::filesystem::remove(cfg.db_path);
+}
+
+TEST(FlatMmapFeatureStore, OpenRejectsForeignFileTest) {
+  const std::string path = "test.ggb";
+  {
+    std::ofstream out(path, std::ios::binary);
+    const std::vector<char> garbage(8192, 'x');
+    out.write(garbage.data(), static_cast<std::streamsize>(garbage.size()));
+  }
+  EXPECT_THROW({ [[maybe_unused]] auto s = ggb::FeatureStore::open(path); },
+               std::runtime_error);
+  std::filesystem::remove(path);
+  EXPECT_THROW({ [[maybe_unused]] auto s = ggb::FeatureStore::open(path); },
+               std::runtime_error);
+}
+
+// --- DirectIo Tests ---
+
+TEST(DirectIoFeatureStore, BuilderTest) {
+  const ggb::DirectIoConfig cfg{.db_path = "test.ggb"};
+  test_builder<ggb::engine::DirectIoFeatureStoreBuilder>(cfg);
+  std::filesystem::remove(cfg.db_path);
+}
+
+TEST(DirectIoFeatureStore, RetrievalTest) {
+  for (const bool direct_io : {true, false}) {
+    const ggb::DirectIoConfig cfg{.db_path = "test.ggb",
+                                  .backend = ggb::IoBackend::Pread,
+                                  .direct_io = direct_io};
+    test_store<ggb::engine::DirectIoFeatureStoreBuilder>(cfg);
+  }
+  std::filesystem::remove("test.ggb");
+}
+
+TEST(DirectIoFeatureStore, SparseKeysTest) {
+  const ggb::DirectIoConfig cfg{.db_path = "test.ggb",
+                                .executor = {.num_threads = 2}};
+  test_sparse_store<ggb::engine::DirectIoFeatureStoreBuilder>(cfg);
+  std::filesystem::remove(cfg.db_path);
+}
+
+TEST(DirectIoFeatureStore, MetricsTest) {
+  const ggb::DirectIoConfig cfg{.db_path = "test.ggb",
+                                .backend = ggb::IoBackend::Pread};
+  test_store_metrics<ggb::engine::DirectIoFeatureStoreBuilder>(
+      cfg, {"lookup.index", "lookup.read", "lookup.copy"});
+  std::filesystem::remove(cfg.db_path);
+}
+
+TEST(DirectIoFeatureStore, BulkInsertTest) {
+  const ggb::DirectIoConfig cfg{.db_path = "test.ggb"};
+  test_bulk_store<ggb::engine::DirectIoFeatureStoreBuilder>(cfg);
+  std::filesystem::remove(cfg.db_path);
+}
+
+TEST(DirectIoFeatureStore, ReducedPrecisionTest) {
+  const ggb::DirectIoConfig cfg{.db_path = "test.ggb",
+                                .backend = ggb::IoBackend::Pread};
+  test_reduced_precision_store<ggb::engine::DirectIoFeatureStoreBuilder>(cfg);
+  std::filesystem::remove(cfg.db_path);
+}
+
+TEST(DirectIoFeatureStore, ReorderedRowsTest) {
+  const ggb::DirectIoConfig cfg{.db_path = "test.ggb"};
+  test_reordered_store<ggb::engine::DirectIoFeatureStoreBuilder>(cfg);
+  std::filesystem::remove(cfg.db_path);
+}
+
+TEST(DirectIoFeatureStore, PrefetchTest) {
+  for (const bool direct_io : {true, false}) {
+    const ggb::DirectIoConfig cfg{.db_path = "test.ggb",
+                                  .executor = {.num_threads = 1},
+                                  .backend = ggb::IoBackend::Pread,
+                                  .direct_io = direct_io};
+    test_prefetch_store<ggb::engine::DirectIoFeatureStoreBuilder>(cfg);
+  }
+  std::filesystem::remove("test.ggb");
+}
+
+TEST(DirectIoFeatureStore, BatchLargerThanQueueDepthTest) {
+  // Rows of three floats straddle block boundaries at varying offsets. Reads
+  // are issued one per row, in single-block ranges, and as a single range.
+  for (const auto coalesce :
+       {ggb::CoalesceConfig{.enabled = false},
+        ggb::CoalesceConfig{.max_range_bytes = 4096}, ggb::CoalesceConfig{}}) {
+    const ggb::DirectIoConfig cfg{.db_path = "test.ggb",
+                                  .backend = ggb::IoBackend::Pread,
+                                  .queue_depth = 3,
+                                  .pread_threads = 2,
+                                  .coalesce = coalesce};
+    ggb::engine::DirectIoFeatureStoreBuilder builder(cfg);
+    constexpr std::uint64_t num_rows = 1000;
+    for (std::uint64_t id = 0; id < num_rows; ++id) {
+      const auto v = static_cast<float>(id);
+      builder.put_tensor({id}, {v, v + 0.5F, -v});
+    }
+    const auto store = builder.build();
+
+    std::vector<ggb::Key> keys;
+    for (std::uint64_t id = 0; id < num_rows; id += 7) {
+      keys.push_back({num_rows - 1 - id});
+    }
+    keys.push_back(keys.front());  // Repeated rows share a read
+    std::vector<float> out(keys.size() * 3);
+    EXPECT_TRUE(store->get_multi_tensor_into(keys, out).empty());
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+      const auto v = static_cast<float>(keys[i].NodeID);
+      EXPECT_FLOAT_EQ(out[(i * 3) + 0], v);
+      EXPECT_FLOAT_EQ(out[(i * 3) + 1], v + 0.5F);
+      EXPECT_FLOAT_EQ(out[(i * 3) + 2], -v);
+    }
+
+    const auto counters = store->get_counters();
+    EXPECT_EQ(counters.at("direct_io.rows"), keys.size());
+    if (!coalesce.enabled) {
+      EXPECT_EQ(counters.at("direct_io.reads"), keys.size());
+    } else if (coalesce.max_range_bytes == 4096) {
+      EXPECT_GT(counters.at("direct_io.reads"), cfg.queue_depth);
+      EXPECT_LT(counters.at("direct_io.reads"), keys.size());
+    } else {
+      EXPECT_EQ(counters.at("direct_io.reads"), 1);
+    }
+  }
+  std::filesystem::remove("test.ggb");
+}
+
+// --- Cached Tests ---
+
+TEST(CachedFeatureStore, BuilderTest) {
+  const ggb::CachedConfig cfg{.base = ggb::InMemoryConfig{}};
+  test_builder<ggb::engine::CachedFeatureStoreBuilder>(cfg);
+}
+
+TEST(CachedFeatureStore, RetrievalTest) {
+  for (const auto policy : {ggb::CachePolicy::Clock, ggb::CachePolicy::S3Fifo,
+                            ggb::CachePolicy::Lru}) {
+    const ggb::CachedConfig cfg{.base = ggb::InMemoryConfig{},
+                                .policy = policy};
+    test_store<ggb::engine::CachedFeatureStoreBuilder>(cfg);
+  }
+}
+
+TEST(CachedFeatureStore, SparseKeysOverFlatMmapTest) {
+  const ggb::CachedConfig cfg{
+      .base = ggb::FlatMmapConfig{.db_path = "test.ggb"},
+      .executor = {.num_threads = 2}};
+  test_sparse_store<ggb::engine::CachedFeatureStoreBuilder>(cfg);
+  std::filesystem::remove("test.ggb");
+}
+
+TEST(CachedFeatureStore, BulkInsertTest) {
+  const ggb::CachedConfig cfg{.base = ggb::InMemoryConfig{}};
+  test_bulk_store<ggb::engine::CachedFeatureStoreBuilder>(cfg);
+}
+
+TEST(CachedFeatureStore, PrefetchWarmsCacheTest) {
+  const ggb::CachedConfig cfg{.base = ggb::InMemoryConfig{},
+                              .executor = {.num_threads = 1}};
+  test_prefetch_store<ggb::engine::CachedFeatureStoreBuilder>(cfg);
+
+  // Prefetched rows are admitted on the executor without counting lookups,
+  // so once they are in, the batch itself is served from the cache
+  ggb::engine::CachedFeatureStoreBuilder builder(cfg);
+  for (const std::uint64_t id : {0, 1, 2}) {
+    builder.put_tensor({id}, {static_cast<float>(id), 0.0F});
+  }
+  const auto store = builder.build();
+  const std::vector<ggb::Key> keys = {{2}, {0}, {9}};
+  store->prefetch(keys);
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (store->get_counters().at("row_cache.insertions") < 2 &&
+         std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_EQ(store->get_counters().at("row_cache.insertions"), 2);
+  EXPECT_EQ(store->get_counters().at("row_cache.misses"), 0);
+
+  std::vector<float> out(keys.size() * 2);
+  EXPECT_EQ(store->get_multi_tensor_into(keys, out),
+            (std::vector<std::size_t>{2}));
+  EXPECT_EQ(out, (std::vector<float>{2.0, 0.0, 0.0, 0.0, 0.0, 0.0}));
+  const auto counters = store->get_counters();
+  EXPECT_EQ(counters.at("row_cache.hits"), 2);
+  EXPECT_EQ(counters.at("row_cache.misses"), 1);
+}
+
+TEST(CachedFeatureStore, PrefetchWithoutWorkersTest) {
+  // Warming inline would block the caller, so the hint is dropped instead
+  const ggb::CachedConfig cfg{.base = ggb::InMemoryConfig{}};
+  test_prefetch_store<ggb::engine::CachedFeatureStoreBuilder>(cfg);
+
+  ggb::engine::CachedFeatureStoreBuilder builder(cfg);
+  builder.put_tensor({0}, {0.0F, 0.0F});
+  const auto store = builder.build();
+  store->prefetch(std::vector<ggb::Key>{{0}});
+  EXPECT_EQ(store->get_counters().at("row_cache.insertions"), 0);
+}
+
+TEST(CachedFeatureStore, CountersTest) {
+  // Room for exactly two rows of two floats in a single shard
+  const ggb::CachedConfig cfg{.base = ggb::InMemoryConfig{},
+                              .capacity_bytes = 2 * 2 * sizeof(float),
+                              .policy = ggb::CachePolicy::Lru,
+                              .num_shards = 1};
+  ggb::engine::CachedFeatureStoreBuilder builder(cfg);
+  for (const std::uint64_t id : {0, 1, 2}) {
+    builder.put_tensor({id}, {static_cast<float>(id), 0.0F});
+  }
+  const auto store = builder.build();
+
+  std::vector<float> out(2 * 2);
+  const std::vector<ggb::Key> first = {{0}, {1}};
+  EXPECT_TRUE(store->get_multi_tensor_into(first, out).empty());
+  EXPECT_TRUE(store->get_multi_tensor_into(first, out).empty());
+
+  // Key 2 evicts key 0, the least recently used row, so 0 misses again
+  for (const std::uint64_t id : {2, 0, 2}) {
+    const std::vector<ggb::Key> keys = {{id}};
+    EXPECT_TRUE(store->get_multi_tensor_into(keys, out).empty());
+    EXPECT_FLOAT_EQ(out[0], static_cast<float>(id));
+  }
+
+  const auto counters = store->get_counters();
+  EXPECT_EQ(counters.at("row_cache.hits"), 3);
+  EXPECT_EQ(counters.at("row_cache.misses"), 4);
+  EXPECT_EQ(counters.at("row_cache.insertions"), 4);
+  EXPECT_EQ(counters.at("row_cache.evictions"), 2);
+}
+
+TEST(CachedFeatureStore, MetricsTest) {
+  const ggb::CachedConfig cfg{.base = ggb::InMemoryConfig{},
+                              .capacity_bytes = 1 << 20};
+  ggb::engine::CachedFeatureStoreBuilder builder(cfg);
+  builder.put_tensor({0}, {1.0, 2.0});
+  const auto store = builder.build();
+
+  const std::vector<ggb::Key> keys = {{0}};
+  std::vector<float> out(2);
+  for (int i = 0; i < 2; ++i) {
+    EXPECT_TRUE(store->get_multi_tensor_into(keys, out).empty());
+  }
+
+  // Cache counters on top of the wrapped store's, which only saw the miss
+  const auto metrics = store->get_metrics();
+  EXPECT_EQ(metrics.counters.at("row_cache.hits"), 1);
+  EXPECT_EQ(metrics.counters.at("row_cache.misses"), 1);
+#ifdef GGB_ENABLE_METRICS
+  EXPECT_EQ(metrics.counters.at("lookup.keys"), 1);
+  EXPECT_TRUE(metrics.stages.contains("lookup.copy"));
+#endif
+}
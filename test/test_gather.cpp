@@ -0,0 +1,63 @@
+#include "common/gather.h"
+
+#include <cstddef>
+#include <vector>
+
+// Third-party
+#include <gtest/gtest.h>
+
+using ggb::detail::GatherIsa;
+using ggb::detail::RowCopier;
+
+namespace {
+
+// Every ISA this CPU can run, up to the best one
+auto supported_isas() -> std::vector<GatherIsa> {
+  std::vector<GatherIsa> isas;
+  for (const auto isa :
+       {GatherIsa::Scalar, GatherIsa::Avx2, GatherIsa::Avx512}) {
+    if (isa <= ggb::detail::best_gather_isa()) {
+      isas.push_back(isa);
+    }
+  }
+  return isas;
+}
+
+}  // namespace
+
+TEST(RowCopier, CopiesExactlyOneRow) {
+  // Specialized widths, widths around vector sizes and odd tails
+  for (const auto isa : supported_isas()) {
+    for (const std::size_t dim : {1, 7, 8, 9, 16, 17, 64, 100, 128, 602, 603}) {
+      const RowCopier copier(dim, isa);
+      std::vector<float> src(dim);
+      for (std::size_t i = 0; i < dim; ++i) {
+        src[i] = static_cast<float>(i) + 0.5F;
+      }
+      // Every float offset into a cache line, with and without streaming
+      for (std::size_t offset = 0; offset < 16; ++offset) {
+        for (const bool streaming : {false, true}) {
+          std::vector<float> dst(dim + 32, -1.0F);
+          copier.copy(src.data(), dst.data() + offset, streaming);
+          ggb::detail::store_fence();
+          ASSERT_EQ(std::vector<float>(dst.begin() + offset,
+                                       dst.begin() + offset + dim),
+                    src)
+              << copier.name() << " dim " << dim << " offset " << offset;
+          EXPECT_EQ(dst[offset + dim], -1.0F);
+          if (offset > 0) {
+            EXPECT_EQ(dst[offset - 1], -1.0F);
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST(RowCopier, NamesSpecializedWidths) {
+  EXPECT_EQ(RowCopier(128, GatherIsa::Scalar).name(), "scalar");
+  if (ggb::detail::best_gather_isa() >= GatherIsa::Avx2) {
+    EXPECT_EQ(RowCopier(128, GatherIsa::Avx2).name(), "avx2-fixed");
+    EXPECT_EQ(RowCopier(129, GatherIsa::Avx2).name(), "avx2");
+  }
+}
@@ -0,0 +1,77 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "common/hot_row_cache.h"
+#include "common/key_index.h"
+#include "ggb/core.h"
+
+// Third-party
+#include <gtest/gtest.h>
+
+using ggb::GraphTopology;
+using ggb::HotCacheConfig;
+using ggb::NodeID;
+using ggb::detail::HotRowCache;
+using ggb::detail::KeyIndexBuilder;
+using ggb::detail::select_hot_slots;
+
+TEST(HotRowCache, FindsOnlyCachedSlots) {
+  // Row of slot s is {s, s}
+  std::vector<float> rows;
+  for (std::size_t slot = 0; slot < 200; ++slot) {
+    rows.push_back(static_cast<float>(slot));
+    rows.push_back(static_cast<float>(slot));
+  }
+  const std::vector<std::size_t> slots = {3, 64, 65, 130, 199};
+  const HotRowCache cache(slots, 200, 2, [&](std::size_t slot) {
+    return rows.data() + (slot * 2);
+  });
+
+  EXPECT_EQ(cache.size(), slots.size());
+  for (std::size_t slot = 0; slot < 250; ++slot) {
+    const auto* row = cache.find(slot);
+    if (std::ranges::find(slots, slot) != slots.end()) {
+      ASSERT_NE(row, nullptr) << slot;
+      EXPECT_FLOAT_EQ(row[0], static_cast<float>(slot));
+      EXPECT_FLOAT_EQ(row[1], static_cast<float>(slot));
+    } else {
+      EXPECT_EQ(row, nullptr) << slot;
+    }
+  }
+  EXPECT_EQ(HotRowCache{}.find(0), nullptr);
+}
+
+TEST(HotRowCache, SelectsHighestDegreeWithinLimits) {
+  KeyIndexBuilder builder;
+  for (std::uint64_t id = 0; id < 6; ++id) {
+    builder.insert({id});
+  }
+  const auto index = std::move(builder).build();
+
+  // Degrees: 0 -> 4, 1 -> 2, 2 -> 2, 3 -> 1, 4 -> 1, 5 -> 0
+  const std::vector<std::pair<NodeID, NodeID>> edges = {
+      {0, 1}, {0, 2}, {0, 3}, {0, 4}, {1, 2}, {7, 8}};
+  const GraphTopology graph{.edges = std::span(edges)};
+  constexpr std::size_t row_bytes = 16;
+
+  EXPECT_TRUE(select_hot_slots(index, 6, graph, {}, row_bytes).empty());
+  EXPECT_EQ(select_hot_slots(index, 6, graph, {.max_nodes = 1}, row_bytes),
+            std::vector<std::size_t>{0});
+  EXPECT_EQ(select_hot_slots(index, 6, graph, {.max_nodes = 3}, row_bytes),
+            (std::vector<std::size_t>{0, 1, 2}));
+
+  // The tighter of the two limits wins
+  EXPECT_EQ(select_hot_slots(index, 6, graph,
+                             {.max_nodes = 4, .max_bytes = 2 * row_bytes},
+                             row_bytes),
+            (std::vector<std::size_t>{0, 1}));
+
+  // Rows without edges are never pinned
+  EXPECT_EQ(
+      select_hot_slots(index, 6, graph, {.max_nodes = 100}, row_bytes).size(),
+      5);
+}
@@ -1,6 +1,8 @@
 #include <common/io.h>
 
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
@@ -23,6 +25,7 @@ class MockBuilder : public ggb::FeatureStoreBuilder {
     ggb::Value values;
   };
   std::vector<Entry> received_;
+  std::vector<std::pair<std::size_t, std::size_t>> reserved_;
 
   auto put_tensor_impl(const ggb::Key& key, const ggb::Value& tensor)
       -> bool override {
@@ -36,6 +39,10 @@ class MockBuilder : public ggb::FeatureStoreBuilder {
     return true;
   }
 
+  auto reserve_impl(std::size_t num_rows, std::size_t dim) -> void override {
+    reserved_.emplace_back(num_rows, dim);
+  }
+
   auto build_impl([[maybe_unused]] std::optional<ggb::GraphTopology> graph)
       -> std::unique_ptr<ggb::FeatureStore> override {
     return nullptr;
@@ -50,6 +57,35 @@ class IOTest : public ::testing::Test {
     ofs.close();
   }
 
+  template <typename T>
+  void create_binary(const std::string& prefix, const std::vector<T>& values) {
+    std::ofstream ofs(test_file_, std::ios::binary);
+    ofs << prefix;
+    ofs.write(reinterpret_cast<const char*>(values.data()),
+              static_cast<std::streamsize>(values.size() * sizeof(T)));
+  }
+
+  // Version 1.0 .npy header, padded so the data starts 64-byte aligned
+  static auto npy_header(const std::string& descr, const std::string& shape)
+      -> std::string {
+    return npy_dict_header("{'descr': '" + descr +
+                           "', 'fortran_order': False, 'shape': " + shape +
+                           ", }");
+  }
+
+  static auto npy_dict_header(std::string dict) -> std::string {
+    while ((10 + dict.size() + 1) % 64 != 0) {
+      dict += ' ';
+    }
+    dict += '\n';
+    std::string header = "\x93NUMPY";
+    header += '\x01';
+    header += '\x00';
+    header += static_cast<char>(dict.size() & 0xFF);
+    header += static_cast<char>(dict.size() >> 8);
+    return header + dict;
+  }
+
   void TearDown() override {
     if (fs::exists(test_file_)) {
       fs::remove(test_file_);
@@ -80,6 +116,152 @@ TEST_F(IOTest, IngestFeatureCSV) {
   EXPECT_FLOAT_EQ(builder.received_[1].values[2], 6.0);
 }
 
+TEST_F(IOTest, IngestFeatureCSVInParallelSlices) {
+  // Tiny slices force every row into its own parse task
+  std::string content;
+  for (int i = 0; i < 200; ++i) {
+    content += std::to_string(i) + ", -1.5e-1,+" + std::to_string(i) +
+               ".25\r\n";
+    if (i % 50 == 0) {
+      content += "\n";  // Empty lines do not consume a node id
+    }
+  }
+  create_csv(content);
+  MockBuilder builder;
+
+  ggb::io::ingest_features_from_csv(test_file_, builder,
+                                    {.num_threads = 4, .chunk_bytes = 8});
+
+  ASSERT_EQ(builder.received_.size(), 200);
+  for (std::size_t i = 0; i < builder.received_.size(); ++i) {
+    const auto& entry = builder.received_[i];
+    EXPECT_EQ(entry.key, ggb::Key{.NodeID = i});
+    ASSERT_EQ(entry.values.size(), 3);
+    EXPECT_FLOAT_EQ(entry.values[0], static_cast<float>(i));
+    EXPECT_FLOAT_EQ(entry.values[1], -0.15F);
+    EXPECT_FLOAT_EQ(entry.values[2], static_cast<float>(i) + 0.25F);
+  }
+}
+
+TEST_F(IOTest, IngestFeatureCSVReservesEstimatedRows) {
+  std::string content;
+  for (int i = 0; i < 1000; ++i) {
+    content += "1.000,2.000\n";
+  }
+  create_csv(content);
+  MockBuilder builder;
+
+  // The first 1 KiB slice extrapolates to the file size, plus slack
+  ggb::io::ingest_features_from_csv(test_file_, builder,
+                                    {.num_threads = 2, .chunk_bytes = 1024});
+
+  ASSERT_EQ(builder.reserved_.size(), 1);
+  EXPECT_GE(builder.reserved_[0].first, 1000);
+  EXPECT_LE(builder.reserved_[0].first, 1100);
+  EXPECT_EQ(builder.reserved_[0].second, 2);
+}
+
+TEST_F(IOTest, IngestFeatureCSVMixedDimensions) {
+  create_csv("1,2\n3,4,5\nnot,a,number\n6,7");
+  MockBuilder builder;
+
+  ggb::io::ingest_features_from_csv(test_file_, builder, {.num_threads = 0});
+
+  // Rows are forwarded as parsed; rejecting odd ones is up to the builder
+  ASSERT_EQ(builder.received_.size(), 3);
+  EXPECT_EQ(builder.received_[1].values, (ggb::Value{3.0, 4.0, 5.0}));
+  EXPECT_EQ(builder.received_[2].key, ggb::Key{.NodeID = 2});
+  EXPECT_EQ(builder.received_[2].values, (ggb::Value{6.0, 7.0}));
+}
+
+TEST(IOSplitTest, SlicesEndAtLineBreaks) {
+  const std::string text = "aaaa\nbb\ncccccc\nd";
+  const auto slices = ggb::detail::split_at_lines(
+      text.data(), text.data() + text.size(), 3);
+  std::vector<std::string> parts;
+  for (const auto& [first, last] : slices) {
+    parts.emplace_back(first, last);
+  }
+  EXPECT_EQ(parts, (std::vector<std::string>{"aaaa\n", "bb\ncccccc\n", "d"}));
+}
+
+TEST_F(IOTest, IngestFeatureNpyFloat32) {
+  create_binary(npy_header("<f4", "(2, 3)"),
+                std::vector<float>{1.0, 2.0, 3.0, 4.0, 5.0, 6.0});
+  MockBuilder builder;
+
+  ggb::io::ingest_features_from_npy(test_file_, builder);
+
+  ASSERT_EQ(builder.received_.size(), 2);
+  EXPECT_EQ(builder.received_[1].key, ggb::Key{.NodeID = 1});
+  EXPECT_EQ(builder.received_[1].values, (ggb::Value{4.0, 5.0, 6.0}));
+  EXPECT_EQ(builder.reserved_,
+            (std::vector<std::pair<std::size_t, std::size_t>>{{2, 3}}));
+}
+
+TEST_F(IOTest, IngestFeatureNpyFloat16) {
+  // 1.0, -2.0, 0.5, 65504 (largest half)
+  create_binary(npy_header("<f2", "(2, 2)"),
+                std::vector<std::uint16_t>{0x3C00, 0xC000, 0x3800, 0x7BFF});
+  MockBuilder builder;
+
+  ggb::io::ingest_features_from_npy(test_file_, builder);
+
+  ASSERT_EQ(builder.received_.size(), 2);
+  EXPECT_EQ(builder.received_[0].values, (ggb::Value{1.0, -2.0}));
+  EXPECT_EQ(builder.received_[1].values, (ggb::Value{0.5, 65504.0}));
+}
+
+TEST_F(IOTest, IngestFeatureNpyShapeBeforeOtherKeys) {
+  // Other writers need not put 'shape' last; the '4' of '<f4' is no dim
+  create_binary(
+      npy_dict_header(
+          "{'shape': (2, 1), 'fortran_order': False, 'descr': '<f4', }"),
+      std::vector<float>{1.0, 2.0});
+  MockBuilder builder;
+
+  ggb::io::ingest_features_from_npy(test_file_, builder);
+
+  ASSERT_EQ(builder.received_.size(), 2);
+  EXPECT_EQ(builder.received_[1].values, (ggb::Value{2.0}));
+}
+
+TEST_F(IOTest, RejectsUnsupportedNpy) {
+  MockBuilder builder;
+  create_binary(npy_header("<f8", "(1, 1)"), std::vector<double>{1.0});
+  EXPECT_THROW(ggb::io::ingest_features_from_npy(test_file_, builder),
+               std::runtime_error);
+
+  // Header announces more data than the file holds
+  create_binary(npy_header("<f4", "(4, 4)"), std::vector<float>{1.0});
+  EXPECT_THROW(ggb::io::ingest_features_from_npy(test_file_, builder),
+               std::runtime_error);
+  EXPECT_TRUE(builder.received_.empty());
+}
+
+TEST_F(IOTest, IngestFeatureRawFloat32) {
+  create_binary("", std::vector<float>{1.0, 2.0, 3.0, 4.0, 5.0, 6.0});
+  MockBuilder builder;
+
+  ggb::io::ingest_features_from_raw(test_file_, builder, 2);
+
+  ASSERT_EQ(builder.received_.size(), 3);
+  EXPECT_EQ(builder.received_[2].key, ggb::Key{.NodeID = 2});
+  EXPECT_EQ(builder.received_[2].values, (ggb::Value{5.0, 6.0}));
+  EXPECT_THROW(ggb::io::ingest_features_from_raw(test_file_, builder, 4),
+               std::runtime_error);
+}
+
+TEST_F(IOTest, IngestsBinaryEdgeList) {
+  create_binary("", std::vector<std::int64_t>{0, 1, 1, 2, 2, 0});
+  std::vector<std::pair<ggb::NodeID, ggb::NodeID>> edges;
+
+  ggb::io::ingest_edgelist_from_binary(test_file_, edges);
+
+  using Edges = std::vector<std::pair<ggb::NodeID, ggb::NodeID>>;
+  EXPECT_EQ(edges, (Edges{{0, 1}, {1, 2}, {2, 0}}));
+}
+
 TEST_F(IOTest, IngestsEdgeList) {
   create_csv("0,1\n1,2\n2,0");
   std::vector<std::pair<ggb::NodeID, ggb::NodeID>> edges;
@@ -0,0 +1,151 @@
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <span>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "common/key_index.h"
+#include "common/serialize.h"
+#include "ggb/core.h"
+
+// Third-party
+#include <gtest/gtest.h>
+
+using ggb::IndexKind;
+using ggb::Key;
+using ggb::detail::KeyIndexBuilder;
+using ggb::detail::missing_slot;
+
+TEST(KeyIndex, ContiguousKeysBuildDenseIndex) {
+  KeyIndexBuilder builder;
+  for (std::uint64_t id = 5; id < 10; ++id) {
+    EXPECT_EQ(builder.insert({id}), id - 5);
+  }
+
+  const auto index = std::move(builder).build();
+  EXPECT_EQ(index.kind(), "dense");
+  EXPECT_EQ(index.size(), 5);
+  EXPECT_EQ(index.find({5}), std::optional<std::size_t>{0});
+  EXPECT_EQ(index.find({9}), std::optional<std::size_t>{4});
+
+  // Out of range on either side
+  EXPECT_EQ(index.find({4}), std::nullopt);
+  EXPECT_EQ(index.find({10}), std::nullopt);
+}
+
+TEST(KeyIndex, EmptyIndex) {
+  const auto index = KeyIndexBuilder{}.build();
+  EXPECT_EQ(index.size(), 0);
+  EXPECT_EQ(index.find({0}), std::nullopt);
+}
+
+class SparseKeyIndexTest : public ::testing::TestWithParam<IndexKind> {};
+
+TEST_P(SparseKeyIndexTest, SparseKeysLeaveDenseMode) {
+  KeyIndexBuilder builder(GetParam());
+  EXPECT_EQ(builder.insert({0}), 0);
+  EXPECT_EQ(builder.insert({1}), 1);
+  EXPECT_EQ(builder.insert({42}), 2);  // Breaks the dense run
+  EXPECT_EQ(builder.insert({2}), 3);
+
+  const auto index = std::move(builder).build();
+  EXPECT_NE(index.kind(), "dense");
+  EXPECT_EQ(index.size(), 4);
+  EXPECT_EQ(index.find({0}), std::optional<std::size_t>{0});
+  EXPECT_EQ(index.find({1}), std::optional<std::size_t>{1});
+  EXPECT_EQ(index.find({42}), std::optional<std::size_t>{2});
+  EXPECT_EQ(index.find({2}), std::optional<std::size_t>{3});
+  EXPECT_EQ(index.find({3}), std::nullopt);
+}
+
+TEST_P(SparseKeyIndexTest, DuplicateKeyPointsToLatestSlot) {
+  KeyIndexBuilder builder(GetParam());
+  builder.insert({0});
+  builder.insert({1});
+  builder.insert({0});
+
+  const auto index = std::move(builder).build();
+  EXPECT_EQ(index.size(), 2);
+  EXPECT_EQ(index.find({0}), std::optional<std::size_t>{2});
+  EXPECT_EQ(index.find({1}), std::optional<std::size_t>{1});
+}
+
+TEST_P(SparseKeyIndexTest, BatchLookupMatchesPointLookup) {
+  std::mt19937_64 rng(0);
+  KeyIndexBuilder builder(GetParam());
+  std::vector<Key> present;
+  for (std::size_t i = 0; i < 5000; ++i) {
+    present.push_back({rng() % 1'000'000});
+    builder.insert(present.back());
+  }
+  const auto index = std::move(builder).build();
+
+  // Mix of present keys, absent keys and both extremes of the key space
+  std::vector<Key> queries(present.begin(), present.begin() + 1000);
+  for (std::size_t i = 0; i < 1000; ++i) {
+    queries.push_back({1'000'000 + i});
+  }
+  queries.push_back({0});
+  queries.push_back({UINT64_MAX});
+
+  std::vector<std::size_t> slots(queries.size());
+  index.find_batch(queries, slots);
+  for (std::size_t i = 0; i < queries.size(); ++i) {
+    const auto expected = index.find(queries[i]).value_or(missing_slot);
+    EXPECT_EQ(slots[i], expected) << queries[i];
+    if (i < 1000) {
+      EXPECT_NE(slots[i], missing_slot) << queries[i];
+    } else if (i < 2000) {
+      EXPECT_EQ(slots[i], missing_slot) << queries[i];
+    }
+  }
+
+  std::size_t visited = 0;
+  index.for_each_slot(queries, [&](std::size_t first, auto chunk) {
+    EXPECT_EQ(first, visited);
+    for (std::size_t i = 0; i < chunk.size(); ++i) {
+      EXPECT_EQ(chunk[i], slots[first + i]);
+    }
+    visited += chunk.size();
+  });
+  EXPECT_EQ(visited, queries.size());
+}
+
+TEST_P(SparseKeyIndexTest, SaveLoadRoundTrip) {
+  std::mt19937_64 rng(1);
+  KeyIndexBuilder builder(GetParam());
+  for (std::size_t i = 0; i < 2000; ++i) {
+    builder.insert({rng() % 100'000});
+  }
+  const auto index = std::move(builder).build();
+
+  std::ostringstream out;
+  ggb::detail::BinaryWriter writer(out);
+  index.save(writer);
+  const auto bytes = out.str();
+  EXPECT_EQ(bytes.size(), writer.bytes_written());
+
+  ggb::detail::BinaryReader reader(std::as_bytes(std::span(bytes)));
+  const auto loaded = ggb::detail::KeyIndex::load(reader);
+  EXPECT_EQ(loaded.kind(), index.kind());
+  EXPECT_EQ(loaded.size(), index.size());
+  for (std::uint64_t id = 0; id < 100'000; ++id) {
+    EXPECT_EQ(loaded.find({id}), index.find({id})) << id;
+  }
+
+  // A truncated section must be rejected rather than read out of bounds
+  ggb::detail::BinaryReader truncated(
+      std::as_bytes(std::span(bytes)).first(bytes.size() / 2));
+  EXPECT_THROW(
+      { [[maybe_unused]] auto i = ggb::detail::KeyIndex::load(truncated); },
+      std::runtime_error);
+}
+
+INSTANTIATE_TEST_SUITE_P(KeyIndex, SparseKeyIndexTest,
+                         ::testing::Values(IndexKind::Hash,
+                                           IndexKind::Eytzinger,
+                                           IndexKind::PerfectHash));
@@ -0,0 +1,116 @@
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+#include "common/metrics.h"
+#include "ggb/core.h"
+
+// Third-party
+#include <gtest/gtest.h>
+
+using ggb::Metrics;
+using ggb::detail::LookupMetrics;
+using ggb::detail::Stage;
+using ggb::detail::StageClock;
+
+#ifdef GGB_ENABLE_METRICS
+
+TEST(LookupMetricsTest, StartsAtZero) {
+  const LookupMetrics metrics;
+  Metrics snapshot;
+  metrics.snapshot(snapshot);
+  EXPECT_EQ(snapshot.counters.at("lookup.keys"), 0);
+  EXPECT_EQ(snapshot.counters.at("lookup.missing_keys"), 0);
+  EXPECT_EQ(snapshot.counters.at("lookup.bytes_copied"), 0);
+  EXPECT_TRUE(snapshot.stages.empty());
+}
+
+TEST(LookupMetricsTest, AddLookupCountsFoundBytes) {
+  LookupMetrics metrics;
+  metrics.add_lookup(10, 3, 8);
+  metrics.add_lookup(5, 0, 8);
+  Metrics snapshot;
+  metrics.snapshot(snapshot);
+  EXPECT_EQ(snapshot.counters.at("lookup.keys"), 15);
+  EXPECT_EQ(snapshot.counters.at("lookup.missing_keys"), 3);
+  EXPECT_EQ(snapshot.counters.at("lookup.bytes_copied"), 12 * 8);
+}
+
+TEST(LookupMetricsTest, RecordBucketsByPowerOfTwo) {
+  LookupMetrics metrics;
+  for (const std::uint64_t ns : {0, 1, 3, 1024, 1500}) {
+    metrics.record(Stage::Copy, ns);
+  }
+  Metrics snapshot;
+  metrics.snapshot(snapshot);
+  ASSERT_EQ(snapshot.stages.size(), 1);
+  const auto& copy = snapshot.stages.at("lookup.copy");
+  EXPECT_EQ(copy.count, 5);
+  EXPECT_EQ(copy.total_ns, 0 + 1 + 3 + 1024 + 1500);
+  EXPECT_EQ(copy.buckets[0], 2);
+  EXPECT_EQ(copy.buckets[1], 1);
+  EXPECT_EQ(copy.buckets[10], 2);
+}
+
+TEST(LookupMetricsTest, ShardsSumAcrossThreads) {
+  constexpr std::size_t num_threads = 20;  // More than there are shards
+  constexpr std::size_t per_thread = 1000;
+  LookupMetrics metrics;
+  {
+    std::vector<std::jthread> threads;
+    for (std::size_t t = 0; t < num_threads; ++t) {
+      threads.emplace_back([&] {
+        for (std::size_t i = 0; i < per_thread; ++i) {
+          metrics.add_lookup(2, 1, 4);
+          metrics.record(Stage::Index, 100);
+        }
+      });
+    }
+  }
+  Metrics snapshot;
+  metrics.snapshot(snapshot);
+  EXPECT_EQ(snapshot.counters.at("lookup.keys"), 2 * num_threads * per_thread);
+  EXPECT_EQ(snapshot.counters.at("lookup.bytes_copied"),
+            4 * num_threads * per_thread);
+  const auto& index = snapshot.stages.at("lookup.index");
+  EXPECT_EQ(index.count, num_threads * per_thread);
+  EXPECT_EQ(index.total_ns, 100 * num_threads * per_thread);
+  EXPECT_EQ(std::accumulate(index.buckets.begin(), index.buckets.end(),
+                            std::uint64_t{0}),
+            index.count);
+}
+
+TEST(StageClockTest, RecordsOneSamplePerLappedStage) {
+  LookupMetrics metrics;
+  {
+    StageClock clock(metrics);
+    for (int chunk = 0; chunk < 3; ++chunk) {
+      clock.lap(Stage::Index);
+      clock.lap(Stage::Copy);
+    }
+  }
+  Metrics snapshot;
+  metrics.snapshot(snapshot);
+  EXPECT_EQ(snapshot.stages.at("lookup.index").count, 1);
+  EXPECT_EQ(snapshot.stages.at("lookup.copy").count, 1);
+  EXPECT_FALSE(snapshot.stages.contains("lookup.read"));
+}
+
+#else
+
+TEST(LookupMetricsTest, CompiledOut) {
+  LookupMetrics metrics;
+  metrics.add_lookup(10, 3, 8);
+  {
+    StageClock clock(metrics);
+    clock.lap(Stage::Index);
+  }
+  Metrics snapshot;
+  metrics.snapshot(snapshot);
+  EXPECT_TRUE(snapshot.counters.empty());
+  EXPECT_TRUE(snapshot.stages.empty());
+}
+
+#endif
@@ -80,3 +80,14 @@ TEST_F(MmapRegionTest, MoveSemantics) {
     EXPECT_EQ(mmap2.size(), original_size);
   }
 }
+
+TEST_F(MmapRegionTest, MmapWithHugePages) {
+  // Explicit falls back to transparent huge pages off hugetlbfs
+  for (const auto huge_pages :
+       {ggb::HugePages::Transparent, ggb::HugePages::Explicit}) {
+    const MmapRegion mmap(test_file_, huge_pages);
+    ASSERT_EQ(mmap.size(), data_.size() * sizeof(float));
+    const auto* const mapped_data = static_cast<const float*>(mmap.data());
+    EXPECT_FLOAT_EQ(mapped_data[3], data_[3]);
+  }
+}
@@ -0,0 +1,103 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "common/page_buffer.h"
+
+// Third-party
+#include <gtest/gtest.h>
+
+using ggb::HugePages;
+using ggb::detail::PageBuffer;
+
+class PageBufferTest : public ::testing::TestWithParam<HugePages> {};
+
+TEST_P(PageBufferTest, StartsEmpty) {
+  const PageBuffer buffer(GetParam());
+  EXPECT_EQ(buffer.size(), 0);
+  EXPECT_EQ(buffer.capacity(), 0);
+  EXPECT_EQ(buffer.data(), nullptr);
+}
+
+TEST_P(PageBufferTest, GrowthKeepsContents) {
+  PageBuffer buffer(GetParam());
+  std::vector<std::byte> expected;
+  // Appends well past the first huge page, as the builders do
+  for (std::size_t step = 0; step < 40; ++step) {
+    const auto end = buffer.size();
+    buffer.resize(end + 100'003);
+    ASSERT_GE(buffer.capacity(), buffer.size());
+    for (std::size_t i = end; i < buffer.size(); ++i) {
+      buffer.data()[i] = static_cast<std::byte>(i * 7);
+      expected.push_back(static_cast<std::byte>(i * 7));
+    }
+  }
+  EXPECT_TRUE(std::equal(expected.begin(), expected.end(), buffer.data()));
+  // Explicit may fall back to Transparent, but never to regular pages
+  EXPECT_EQ(buffer.huge_pages() == HugePages::None,
+            GetParam() == HugePages::None);
+}
+
+TEST_P(PageBufferTest, HugePagesStayAligned) {
+  PageBuffer buffer(GetParam());
+  for (const std::size_t bytes : {std::size_t{4096}, std::size_t{3} << 20,
+                                  std::size_t{17} << 20}) {
+    buffer.resize(bytes);
+    buffer.data()[bytes - 1] = std::byte{9};
+    if (buffer.huge_pages() != HugePages::None) {
+      EXPECT_EQ(reinterpret_cast<std::uintptr_t>(buffer.data()) %
+                    ggb::detail::huge_page_bytes,
+                0);
+    }
+  }
+  EXPECT_EQ(buffer.data()[(std::size_t{3} << 20) - 1], std::byte{9});
+}
+
+TEST_P(PageBufferTest, NewBytesAreZero) {
+  PageBuffer buffer(GetParam());
+  buffer.resize(5000);
+  EXPECT_TRUE(std::all_of(buffer.data(), buffer.data() + buffer.size(),
+                          [](std::byte b) { return b == std::byte{0}; }));
+}
+
+TEST_P(PageBufferTest, ShrinkToFitKeepsContents) {
+  PageBuffer buffer(GetParam());
+  buffer.reserve(std::size_t{8} << 20);
+  buffer.resize(3);
+  buffer.data()[2] = std::byte{7};
+
+  buffer.shrink_to_fit();
+  EXPECT_LT(buffer.capacity(), std::size_t{8} << 20);
+  EXPECT_GE(buffer.capacity(), 3);
+  EXPECT_EQ(buffer.data()[2], std::byte{7});
+
+  buffer.resize(0);
+  buffer.shrink_to_fit();
+  EXPECT_EQ(buffer.capacity(), 0);
+  EXPECT_EQ(buffer.data(), nullptr);
+}
+
+TEST_P(PageBufferTest, MoveSemantics) {
+  PageBuffer buffer(GetParam());
+  buffer.resize(64);
+  buffer.data()[63] = std::byte{42};
+  const auto* data = buffer.data();
+
+  const PageBuffer moved(std::move(buffer));
+  EXPECT_EQ(moved.data(), data);
+  EXPECT_EQ(moved.size(), 64);
+  EXPECT_EQ(moved.data()[63], std::byte{42});
+}
+
+INSTANTIATE_TEST_SUITE_P(PageBuffer, PageBufferTest,
+                         ::testing::Values(HugePages::None,
+                                           HugePages::Transparent,
+                                           HugePages::Explicit));
+
+TEST(AdviseHugePagesTest, SkipsRangesWithoutWholeHugePage) {
+  std::vector<float> small(1024);
+  EXPECT_FALSE(ggb::detail::advise_huge_pages(small.data(),
+                                              small.size() * sizeof(float)));
+}
@@ -0,0 +1,73 @@
+#include <cstddef>
+#include <vector>
+
+#include "common/read_plan.h"
+
+// Third-party
+#include <gtest/gtest.h>
+
+using ggb::detail::plan_reads;
+using ggb::detail::RowRef;
+
+namespace {
+
+constexpr std::size_t block = 4096;
+
+auto positions(const std::vector<RowRef>& rows) -> std::vector<std::size_t> {
+  std::vector<std::size_t> out;
+  for (const auto& row : rows) {
+    out.push_back(row.position);
+  }
+  return out;
+}
+
+}  // namespace
+
+TEST(ReadPlan, DisabledReadsEachRowInRequestOrder) {
+  std::vector<RowRef> rows = {{.slot = 9, .position = 0},
+                              {.slot = 1, .position = 1},
+                              {.slot = 2, .position = 2}};
+  const auto ranges = plan_reads(rows, block, 100, block, 0);
+  ASSERT_EQ(ranges.size(), 3);
+  EXPECT_EQ(positions(rows), (std::vector<std::size_t>{0, 1, 2}));
+  EXPECT_EQ(ranges[0].offset, block);
+  EXPECT_EQ(ranges[0].length, block);
+  EXPECT_EQ(ranges[2].first, 2);
+}
+
+TEST(ReadPlan, MergesTouchingRowsInFileOrder) {
+  // Slot 40 straddles the first two blocks, joining 0 and 41; 200 is two
+  // blocks past them
+  std::vector<RowRef> rows = {{.slot = 200, .position = 0},
+                              {.slot = 41, .position = 1},
+                              {.slot = 0, .position = 2},
+                              {.slot = 40, .position = 3},
+                              {.slot = 0, .position = 4}};
+  const auto ranges = plan_reads(rows, block, 100, block, 1 << 20);
+  EXPECT_EQ(positions(rows), (std::vector<std::size_t>{2, 4, 3, 1, 0}));
+  ASSERT_EQ(ranges.size(), 2);
+  EXPECT_EQ(ranges[0].offset, block);
+  EXPECT_EQ(ranges[0].length, 2 * block);
+  EXPECT_EQ(ranges[0].count, 4);
+  EXPECT_EQ(ranges[1].offset, 5 * block);
+  EXPECT_EQ(ranges[1].first, 4);
+  EXPECT_EQ(ranges[1].count, 1);
+}
+
+TEST(ReadPlan, SplitsAtMaxRangeBytes) {
+  std::vector<RowRef> rows;
+  for (std::size_t slot = 0; slot < 8; ++slot) {
+    rows.push_back({.slot = slot, .position = slot});
+  }
+  // Rows of a full block each, at most two per range
+  const auto ranges = plan_reads(rows, 0, block, block, 2 * block);
+  ASSERT_EQ(ranges.size(), 4);
+  for (const auto& range : ranges) {
+    EXPECT_EQ(range.length, 2 * block);
+    EXPECT_EQ(range.count, 2);
+  }
+
+  // A row larger than the limit is still read, on its own
+  const auto large = plan_reads(rows, 0, 3 * block, block, 2 * block);
+  EXPECT_EQ(large.size(), rows.size());
+}
@@ -0,0 +1,129 @@
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "common/row_cache.h"
+#include "ggb/core.h"
+
+// Third-party
+#include <gtest/gtest.h>
+
+using ggb::CachePolicy;
+using ggb::Key;
+using ggb::detail::RowCache;
+
+namespace {
+
+constexpr std::size_t tensor_size = 4;
+constexpr std::size_t row_bytes = tensor_size * sizeof(float);
+
+auto row_of(std::uint64_t id) -> std::vector<float> {
+  return std::vector<float>(tensor_size, static_cast<float>(id));
+}
+
+auto contains(RowCache& cache, std::uint64_t id) -> bool {
+  std::vector<float> out(tensor_size);
+  return cache.lookup({id}, out.data());
+}
+
+}  // namespace
+
+class RowCachePolicyTest : public ::testing::TestWithParam<CachePolicy> {};
+
+TEST_P(RowCachePolicyTest, ServesInsertedRowsWithinCapacity) {
+  RowCache cache(64 * row_bytes, tensor_size, GetParam(), 4);
+  EXPECT_EQ(cache.capacity(), 64);
+
+  for (std::uint64_t id = 0; id < 1000; ++id) {
+    std::vector<float> out(tensor_size);
+    if (!cache.lookup({id % 100}, out.data())) {
+      cache.insert({id % 100}, row_of(id % 100).data());
+    } else {
+      EXPECT_EQ(out, row_of(id % 100));
+    }
+  }
+
+  const auto stats = cache.stats();
+  EXPECT_EQ(stats.hits + stats.misses, 1000);
+  EXPECT_EQ(stats.insertions, stats.misses);
+  EXPECT_LE(stats.insertions - stats.evictions, 64);
+  EXPECT_GT(stats.evictions, 0);
+}
+
+TEST_P(RowCachePolicyTest, ZeroCapacityCachesNothing) {
+  RowCache cache(row_bytes - 1, tensor_size, GetParam(), 8);
+  cache.insert({1}, row_of(1).data());
+  EXPECT_FALSE(contains(cache, 1));
+  EXPECT_EQ(cache.stats().insertions, 0);
+}
+
+TEST_P(RowCachePolicyTest, ConcurrentAccess) {
+  RowCache cache(128 * row_bytes, tensor_size, GetParam(), 8);
+  std::vector<std::thread> threads;
+  for (std::uint64_t t = 0; t < 4; ++t) {
+    threads.emplace_back([&cache, t] {
+      std::vector<float> out(tensor_size);
+      for (std::uint64_t i = 0; i < 5000; ++i) {
+        const Key key{(i * 7 + t) % 512};
+        if (cache.lookup(key, out.data())) {
+          EXPECT_EQ(out, row_of(key.NodeID));
+        } else {
+          cache.insert(key, row_of(key.NodeID).data());
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(cache.stats().hits + cache.stats().misses, 4 * 5000);
+}
+
+INSTANTIATE_TEST_SUITE_P(RowCache, RowCachePolicyTest,
+                         ::testing::Values(CachePolicy::Clock,
+                                           CachePolicy::S3Fifo,
+                                           CachePolicy::Lru));
+
+TEST(RowCache, LruEvictsLeastRecentlyUsed) {
+  RowCache cache(3 * row_bytes, tensor_size, CachePolicy::Lru, 1);
+  for (const std::uint64_t id : {1, 2, 3}) {
+    cache.insert({id}, row_of(id).data());
+  }
+  EXPECT_TRUE(contains(cache, 1));  // 2 is now the least recent
+  cache.insert({4}, row_of(4).data());
+  EXPECT_FALSE(contains(cache, 2));
+  EXPECT_TRUE(contains(cache, 1));
+  EXPECT_TRUE(contains(cache, 3));
+}
+
+TEST(RowCache, ClockGivesReferencedRowsASecondChance) {
+  RowCache cache(3 * row_bytes, tensor_size, CachePolicy::Clock, 1);
+  for (const std::uint64_t id : {1, 2, 3}) {
+    cache.insert({id}, row_of(id).data());
+  }
+  EXPECT_TRUE(contains(cache, 1));
+  cache.insert({4}, row_of(4).data());  // Skips referenced 1, evicts 2
+  EXPECT_FALSE(contains(cache, 2));
+  EXPECT_TRUE(contains(cache, 1));
+}
+
+TEST(RowCache, S3FifoScanDoesNotFlushHotRows) {
+  RowCache cache(20 * row_bytes, tensor_size, CachePolicy::S3Fifo, 1);
+
+  // Make rows 0..9 hot enough to be promoted to the main queue
+  for (int round = 0; round < 3; ++round) {
+    for (std::uint64_t id = 0; id < 10; ++id) {
+      if (!contains(cache, id)) {
+        cache.insert({id}, row_of(id).data());
+      }
+    }
+  }
+  // A long scan of one-off rows only cycles through the small queue
+  for (std::uint64_t id = 1000; id < 1200; ++id) {
+    cache.insert({id}, row_of(id).data());
+  }
+  for (std::uint64_t id = 0; id < 10; ++id) {
+    EXPECT_TRUE(contains(cache, id)) << id;
+  }
+}
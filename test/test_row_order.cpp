@@ -0,0 +1,83 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "common/row_order.h"
+#include "ggb/core.h"
+
+// Third-party
+#include <gtest/gtest.h>
+
+using ggb::GraphTopology;
+using ggb::NodeID;
+using ggb::RowOrder;
+using ggb::detail::plan_row_order;
+
+namespace {
+
+// Keys 100 + i inserted at slot i
+auto make_entries(std::size_t n)
+    -> std::vector<std::pair<NodeID, std::size_t>> {
+  std::vector<std::pair<NodeID, std::size_t>> entries;
+  for (std::size_t i = 0; i < n; ++i) {
+    entries.emplace_back(100 + i, i);
+  }
+  return entries;
+}
+
+auto is_permutation_of_slots(std::vector<std::size_t> order, std::size_t n)
+    -> bool {
+  std::ranges::sort(order);
+  for (std::size_t i = 0; i < n; ++i) {
+    if (order.size() != n || order[i] != i) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+TEST(RowOrder, InsertionKeepsSlots) {
+  const std::vector<std::pair<NodeID, std::size_t>> entries = {
+      {1, 2}, {5, 0}, {9, 1}};
+  const auto order = plan_row_order(RowOrder::Insertion, entries, {});
+  EXPECT_EQ(order, (std::vector<std::size_t>{0, 1, 2}));
+}
+
+TEST(RowOrder, DegreeOrderPutsHubsFirst) {
+  const auto entries = make_entries(5);
+  // Slot 3 has degree 3, slot 1 degree 2, the rest degree 1 or 0
+  const std::vector<std::pair<NodeID, NodeID>> edges = {
+      {103, 100}, {103, 101}, {103, 102}, {101, 104}};
+  const auto order = plan_row_order(
+      RowOrder::Degree, entries, GraphTopology{.edges = std::span(edges)});
+  EXPECT_EQ(order, (std::vector<std::size_t>{3, 1, 0, 2, 4}));
+}
+
+TEST(RowOrder, RcmPlacesPathNeighboursAdjacent) {
+  // A path visiting slots in a scrambled order, plus unknown endpoints
+  const std::vector<std::size_t> path = {7, 2, 9, 0, 5, 3, 8, 1, 6, 4};
+  const auto entries = make_entries(path.size());
+  std::vector<std::pair<NodeID, NodeID>> edges;
+  for (std::size_t i = 0; i + 1 < path.size(); ++i) {
+    edges.emplace_back(100 + path[i], 100 + path[i + 1]);
+  }
+  edges.emplace_back(100, 12345);
+
+  const auto order = plan_row_order(RowOrder::Rcm, entries,
+                                    GraphTopology{.edges = std::span(edges)});
+  ASSERT_TRUE(is_permutation_of_slots(order, path.size()));
+
+  std::vector<std::size_t> position(path.size());
+  for (std::size_t i = 0; i < order.size(); ++i) {
+    position[order[i]] = i;
+  }
+  for (std::size_t i = 0; i + 1 < path.size(); ++i) {
+    const auto a = position[path[i]];
+    const auto b = position[path[i + 1]];
+    EXPECT_EQ(std::max(a, b) - std::min(a, b), 1) << path[i];
+  }
+}